@@ -3,14 +3,22 @@
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
 #include "av/sdl2/window.h"
+#include "os/c.h"
+#include "os/mutex.h"
 #include "tiles/client-conf.h"
 #include "tiles/log.h"
 #include "tiles/resources.h"
+#include "tiles/world.h"
 #include "util/assert.h"
+#include "util/atlas.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
+#include "util/image-decode.h"
 #include "util/int.h"
+#include "util/jobs.h"
+#include "util/math2.h"
 #include "util/measure.h"
+#include "util/new.h"
+#include "util/rect-packer.h"
 #include "util/string-view.h"
 #include "util/string.h"
 #include "util/transform.h"
@@ -55,13 +63,18 @@ typedef float GLfloat;
 typedef float GLclampf;
 typedef double GLdouble;
 typedef int GLsizei;
+typedef SSize GLintptr;
 typedef SSize GLsizeiptr;
+typedef struct __GLsync* GLsync;
 typedef U8 GLubyte;
 typedef unsigned GLuint;
+typedef U64 GLuint64;
 
 typedef GLint Attribute;
 typedef GLuint Buffer;
+typedef GLuint Framebuffer;
 typedef GLuint Program;
+typedef GLuint Renderbuffer;
 typedef GLuint Shader;
 typedef GLuint Texture;
 typedef GLint Uniform;
@@ -111,6 +124,14 @@ static APICALL GlGetErrorProc glGetError;
         checkError(#fn);                               \
     }
 
+#define GLFN_VOID_5(rt, fn, t1, t2, t3, t4, t5)                \
+    typedef rt(APIENTRY* fn##Proc)(t1, t2, t3, t4, t5);        \
+    static APICALL fn##Proc fn;                                \
+    static rt fn##_(t1 a, t2 b, t3 c, t4 d, t5 e) noexcept {   \
+        fn(a, b, c, d, e);                                     \
+        checkError(#fn);                                       \
+    }
+
 #define GLFN_VOID_6(rt, fn, t1, t2, t3, t4, t5, t6)                \
     typedef rt(APIENTRY* fn##Proc)(t1, t2, t3, t4, t5, t6);        \
     static APICALL fn##Proc fn;                                    \
@@ -155,25 +176,59 @@ static APICALL GlGetErrorProc glGetError;
         return x;                           \
     }
 
+#define GLFN_RETURN_3(rt, fn, t1, t2, t3)        \
+    typedef rt(APIENTRY* fn##Proc)(t1, t2, t3);  \
+    static APICALL fn##Proc fn;                  \
+    static rt fn##_(t1 a, t2 b, t3 c) noexcept { \
+        rt x = fn(a, b, c);                      \
+        checkError(#fn);                         \
+        return x;                                \
+    }
+
+#define GLFN_RETURN_4(rt, fn, t1, t2, t3, t4)          \
+    typedef rt(APIENTRY* fn##Proc)(t1, t2, t3, t4);    \
+    static APICALL fn##Proc fn;                        \
+    static rt fn##_(t1 a, t2 b, t3 c, t4 d) noexcept { \
+        rt x = fn(a, b, c, d);                         \
+        checkError(#fn);                               \
+        return x;                                      \
+    }
+
 GLFN_VOID_1(void, glActiveTexture, GLenum)
 GLFN_VOID_2(void, glAlphaFunc, GLenum, GLclampf)
 GLFN_VOID_2(void, glAttachShader, Program, Shader)
 GLFN_VOID_2(void, glBindBuffer, GLenum, Buffer)
+GLFN_VOID_2(void, glBindFramebuffer, GLenum, Framebuffer)
+GLFN_VOID_2(void, glBindRenderbuffer, GLenum, Renderbuffer)
 GLFN_VOID_2(void, glBindTexture, GLenum, Texture)
 GLFN_VOID_2(void, glBlendFunc, GLenum, GLenum)
 GLFN_VOID_4(void, glBufferData, GLenum, GLsizeiptr, const void*, GLenum)
+GLFN_VOID_4(void, glBufferStorage, GLenum, GLsizeiptr, const void*, GLbitfield)
+GLFN_VOID_4(void, glBufferSubData, GLenum, GLintptr, GLsizeiptr, const void*)
+GLFN_RETURN_1(GLenum, glCheckFramebufferStatus, GLenum)
 GLFN_VOID_1(void, glClear, GLbitfield)
 GLFN_VOID_4(void, glClearColor, GLfloat, GLfloat, GLfloat, GLfloat)
+GLFN_RETURN_3(GLenum, glClientWaitSync, GLsync, GLbitfield, GLuint64)
 GLFN_VOID_1(void, glCompileShader, Shader)
 GLFN_RETURN_0(Program, glCreateProgram)
 GLFN_RETURN_1(Shader, glCreateShader, GLenum)
+GLFN_VOID_1(void, glDeleteSync, GLsync)
+GLFN_VOID_2(void, glDeleteTextures, GLsizei, const Texture*)
 GLFN_VOID_1(void, glDisable, GLenum)
-GLFN_VOID_3(void, glDrawArrays, GLenum, GLint, GLsizei)
+GLFN_VOID_4(void, glDrawElements, GLenum, GLsizei, GLenum, const void*)
 GLFN_VOID_1(void, glEnable, GLenum)
 GLFN_VOID_1(void, glEnableVertexAttribArray, Attribute)
+GLFN_RETURN_2(GLsync, glFenceSync, GLenum, GLbitfield)
+GLFN_VOID_4(void, glFramebufferRenderbuffer, GLenum, GLenum, GLenum,
+            Renderbuffer)
+GLFN_VOID_5(void, glFramebufferTexture2D, GLenum, GLenum, GLenum, Texture,
+            GLint)
 GLFN_VOID_2(void, glGenBuffers, GLsizei, Buffer*)
+GLFN_VOID_2(void, glGenFramebuffers, GLsizei, Framebuffer*)
+GLFN_VOID_2(void, glGenRenderbuffers, GLsizei, Renderbuffer*)
 GLFN_VOID_2(void, glGenTextures, GLsizei, Texture*)
 GLFN_RETURN_2(Attribute, glGetAttribLocation, Program, const GLchar*)
+GLFN_VOID_2(void, glGetIntegerv, GLenum, GLint*)
 GLFN_VOID_4(void, glGetProgramInfoLog, Program, GLsizei, GLsizei*, GLchar*)
 GLFN_VOID_3(void, glGetProgramiv, Program, GLenum, GLint*)
 GLFN_VOID_4(void, glGetShaderInfoLog, Shader, GLsizei, GLsizei*, GLchar*)
@@ -181,6 +236,10 @@ GLFN_VOID_3(void, glGetShaderiv, Shader, GLenum, GLint*)
 GLFN_RETURN_1(const GLubyte*, glGetString, GLenum)
 GLFN_RETURN_2(Uniform, glGetUniformLocation, Program, const GLchar*)
 GLFN_VOID_1(void, glLinkProgram, Program)
+GLFN_RETURN_4(void*, glMapBufferRange, GLenum, GLintptr, GLsizeiptr,
+              GLbitfield)
+GLFN_VOID_4(void, glRenderbufferStorage, GLenum, GLenum, GLsizei, GLsizei)
+GLFN_VOID_4(void, glScissor, GLint, GLint, GLsizei, GLsizei)
 GLFN_VOID_4(void, glShaderSource, Shader, GLsizei, const GLchar* const*,
             const GLint*)
 GLFN_VOID_9(void, glTexImage2D, GLenum, GLint, GLint, GLsizei, GLsizei, GLint,
@@ -191,6 +250,7 @@ GLFN_VOID_9(void, glTexSubImage2D, GLenum, GLint, GLint, GLint, GLsizei,
 GLFN_VOID_2(void, glUniform1i, Uniform, GLint)
 GLFN_VOID_4(void, glUniformMatrix4fv, Uniform, GLsizei, GLboolean,
             const GLfloat*)
+GLFN_RETURN_1(GLboolean, glUnmapBuffer, GLenum)
 GLFN_VOID_1(void, glUseProgram, Program)
 GLFN_VOID_6(void, glVertexAttribPointer, Buffer, GLint, GLenum, GLboolean,
             GLsizei, const void*)
@@ -198,8 +258,13 @@ GLFN_VOID_4(void, glViewport, GLint, GLint, GLsizei, GLsizei)
 
 #define GL_FALSE                         0x0000
 #define GL_NO_ERROR                      0x0000
+#define GL_SYNC_FLUSH_COMMANDS_BIT       0x0001
+#define GL_MAP_WRITE_BIT                 0x0002
 #define GL_TRIANGLES                     0x0004
 #define GL_TRIANGLE_STRIP                0x0005
+#define GL_MAP_INVALIDATE_BUFFER_BIT     0x0008
+#define GL_MAP_PERSISTENT_BIT            0x0040
+#define GL_MAP_COHERENT_BIT              0x0080
 #define GL_DEPTH_BUFFER_BIT              0x0100
 #define GL_NOTEQUAL                      0x0205
 #define GL_SRC_ALPHA                     0x0302
@@ -210,10 +275,13 @@ GLFN_VOID_4(void, glViewport, GLint, GLint, GLsizei, GLsizei)
 #define GL_OUT_OF_MEMORY                 0x0505
 #define GL_INVALID_FRAMEBUFFER_OPERATION 0x0506
 #define GL_DEPTH_TEST                    0x0B71
+#define GL_VIEWPORT                      0x0BA2
+#define GL_SCISSOR_TEST                  0x0C11
 #define GL_ALPHA_TEST                    0x0BC0
 #define GL_BLEND                         0x0BE2
 #define GL_TEXTURE_2D                    0x0DE1
 #define GL_UNSIGNED_BYTE                 0x1401
+#define GL_UNSIGNED_SHORT                0x1403
 #define GL_UNSIGNED_INT                  0x1405
 #define GL_FLOAT                         0x1406
 #define GL_PROJECTION                    0x1701
@@ -231,14 +299,25 @@ GLFN_VOID_4(void, glViewport, GLint, GLint, GLsizei, GLsizei)
 #define GL_COLOR_BUFFER_BIT              0x4000
 #define GL_BGRA                          0x80E1
 #define GL_CLAMP_TO_EDGE                 0x812F
+#define GL_DEPTH_COMPONENT16             0x81A5
 #define GL_TEXTURE0                      0x84C0
 #define GL_ARRAY_BUFFER                  0x8892
+#define GL_ELEMENT_ARRAY_BUFFER          0x8893
+#define GL_STREAM_DRAW                   0x88E0
 #define GL_STATIC_DRAW                   0x88E4
+#define GL_PIXEL_UNPACK_BUFFER           0x88EC
 #define GL_FRAGMENT_SHADER               0x8B30
 #define GL_VERTEX_SHADER                 0x8B31
 #define GL_COMPILE_STATUS                0x8B81
 #define GL_LINK_STATUS                   0x8B82
 #define GL_SHADING_LANGUAGE_VERSION      0x8B8C
+#define GL_FRAMEBUFFER_COMPLETE          0x8CD5
+#define GL_COLOR_ATTACHMENT0             0x8CE0
+#define GL_DEPTH_ATTACHMENT              0x8D00
+#define GL_FRAMEBUFFER                   0x8D40
+#define GL_RENDERBUFFER                  0x8D41
+#define GL_SYNC_GPU_COMMANDS_COMPLETE    0x9117
+#define GL_TIMEOUT_EXPIRED               0x911B
 
 static const StringView
 getErrorName(GLenum error) noexcept {
@@ -281,6 +360,13 @@ getProcAddress(void** fnAddr, const char* symbolName) noexcept {
         logFatal("GL", String() << "Couldn't load GL function: " << symbolName);
 }
 
+// Returns false if the function is not available.
+static bool
+tryProcAddress(void** fnAddr, const char* symbolName) noexcept {
+    *fnAddr = SDL_GL_GetProcAddress(symbolName);
+    return *fnAddr != 0;
+}
+
 static void
 compileShader(Shader shader) noexcept {
     glCompileShader_(shader);
@@ -352,13 +438,104 @@ makeProgram(const char* vertexSource, const char* fragmentSource) noexcept {
 // Carob-specific code
 //
 
-#define ATLAS_WIDTH  2048
-#define ATLAS_HEIGHT 512
+// Images are loaded and baked on the main thread, but frames may be presented
+// on a render thread that holds the context. So Images name their texture by
+// a handle, and what needs the context is queued as work that the frame
+// runs before it is drawn.
+//
+// Handles are given out on the main thread and are one more than an index
+// into handleTextures, which only the thread presenting frames touches.
+
+// The GL texture behind a handle, and its size.
+struct HandleTexture {
+    Texture texture;
+    U32 width;
+    U32 height;
+};
 
-static HashVector<TiledImage> images;
-static Size atlasUsed = 0;
+enum WorkType {
+    // Make a texture of rect's size for the handle.
+    WORK_MAKE,
+    // Delete the handle's texture.
+    WORK_DESTROY,
+    // Clear rect of the texture to transparent.
+    WORK_CLEAR,
+    // Copy pixels into rect of the texture, and free them.
+    WORK_UPLOAD,
+    // Draw items into the texture.
+    WORK_BAKE,
+};
 
-Texture tAtlas;
+struct Work {
+    WorkType type;
+    U32 handle;
+    PackedRect rect;
+    U32* pixels;
+
+    // For WORK_BAKE, where its items start in WorkList::items and how many
+    // there are.
+    Size firstItem;
+    Size numItems;
+};
+
+struct WorkList {
+    Vector<Work> work;
+    Vector<BakeItem> items;
+
+    // Whether images arrive with it, which may have been skipped anywhere on
+    // the screen.
+    bool arrived;
+};
+
+static Vector<HandleTexture> handleTextures;
+
+// Handles given back, to be given out again.
+static Vector<U32> freeHandles;
+static U32 numHandles = 0;
+
+// Work queued since the last imagesPublish().
+static WorkList queued;
+
+// Work published with each of the two frames that may be in flight, and how
+// many have been published and started. The window does not publish a frame
+// until the one two before it, which had the same list, is presented.
+static WorkList published[2];
+static U32 numPublished = 0;
+static U32 numStarted = 0;
+
+// An image is given its place in the atlas as soon as it is loaded, but is
+// decoded by a worker and copied into the atlas page on a later frame. Until
+// then, draws of it are skipped.
+struct Upload {
+    String path;
+    String file;
+    U32 width;
+    U32 height;
+
+    // Written by the worker. Zero if the image could not be decoded.
+    U32* pixels;
+
+    // Handle of its atlas page.
+    void* texture;
+    PackedRect rect;
+    // Whether the worker is done with it.
+    bool decoded;
+    // Whether the image was evicted before it arrived.
+    bool cancelled;
+};
+
+// Uploads not yet in their atlas page, in the order they were loaded.
+static Vector<Upload*> uploads;
+
+// Access to uploadsFinished.
+static Mutex uploadsMutex;
+
+// Uploads decoded by workers and not yet seen by the main thread.
+static Vector<Upload*> uploadsFinished;
+
+// Zero if pixel buffer objects are not supported. Otherwise, pixels are
+// copied into it and the driver moves them to the texture in the background.
+static Buffer uploadBuffer = 0;
 
 #define Z_NEAR_MAX "1024.0"
 #define Z_FAR_MAX  "-1024.0"
@@ -399,6 +576,12 @@ struct ImageVertex {
 struct ImageProgram {
     Program program;
     Uniform uAtlas;
+
+    // Texture the vertices in attributes sample from, and its size.
+    Texture texture;
+    float textureWidth;
+    float textureHeight;
+
     Uniform uProjection;
     Attribute aPosition;
     Attribute aTexCoord;
@@ -450,10 +633,71 @@ struct RectProgram {
     Vector<RectVertex> attributes;
 };
 
-static VertexBuffer vertexBuffer = 1;
 static ImageProgram ip;
 static RectProgram rp;
 
+// Quads are drawn as four vertices that share this many indices each.
+#define QUAD_VERTICES 4
+#define QUAD_INDICES  6
+
+// Most quads drawn by one glDrawElements(), as limited by 16-bit indices.
+#define QUADS_PER_DRAW 16384
+
+// Vertices for each draw are streamed into one ring buffer. The ring is split
+// into segments, each of which fits the largest draw.
+#define STREAM_SEGMENTS      3
+#define STREAM_SEGMENT_BYTES (QUADS_PER_DRAW * QUAD_VERTICES * 32)
+#define STREAM_BYTES         (STREAM_SEGMENT_BYTES * STREAM_SEGMENTS)
+
+// Indices for QUADS_PER_DRAW quads, never changed.
+static Buffer quadBuffer = 0;
+
+static Buffer streamBuffer = 0;
+static Size streamOffset = STREAM_BYTES;
+
+// With GL_ARB_buffer_storage the ring is mapped once and written directly.
+// A fence is placed on each segment as we move on from it, and waited on
+// before we write to it again on the next trip around the ring.
+//
+// Otherwise, we write with glBufferSubData() and orphan the buffer with
+// glBufferData() each time we wrap around, so the driver can hand us fresh
+// storage while the GPU still reads from the old.
+static U8* streamMapping = 0;
+static GLsync streamFences[STREAM_SEGMENTS];
+static Size streamSegment = 0;
+
+// Time spent submitting each frame, summed over FRAME_STATS_PERIOD frames.
+#define FRAME_STATS_PERIOD 1000
+static Nanoseconds frameStart = 0;
+static Nanoseconds frameTotal = 0;
+static Nanoseconds frameWorst = 0;
+static Size frameCount = 0;
+static Size frameQuads = 0;
+
+// Current on the thread that presents frames.
+static SDL_GLContext context = 0;
+
+// For baking and clearing places in atlas pages. Zero if framebuffer objects
+// are not supported. Set before the first frame and not changed after.
+static Framebuffer bakeFramebuffer = 0;
+
+// Framebuffer that frames are drawn to, the canvas or the window.
+static Framebuffer screenFramebuffer = 0;
+
+// Frames are drawn into canvasTexture and then copied to the window, so that
+// a frame can redraw only the parts that changed and keep the rest. The
+// window's own contents are undefined after a swap. Zero if framebuffer
+// objects are not supported.
+static Framebuffer canvasFramebuffer = 0;
+static Texture canvasTexture = 0;
+static Renderbuffer canvasDepth = 0;
+static GLsizei canvasWidth = 0;
+static GLsizei canvasHeight = 0;
+// Whether the canvas holds the previous frame.
+static bool canvasKept = false;
+// The window's viewport, while drawing to the canvas.
+static GLint windowViewport[4];
+
 static bool printed = false;
 
 static void
@@ -472,11 +716,173 @@ printVersion() noexcept {
 
 #define loadFunction(fn) getProcAddress((void**)&fn, #fn)
 
+#define tryLoadCoreFunction(fn) tryProcAddress((void**)&fn, #fn)
+
+// Core in OpenGL 3.0 and OpenGL ES 2, and an extension before that.
+#define tryLoadFunction(fn)                     \
+    (tryProcAddress((void**)&fn, #fn) ||        \
+     tryProcAddress((void**)&fn, #fn "EXT"))
+
+static void
+initStream() noexcept {
+    U16* indices =
+        static_cast<U16*>(malloc(QUADS_PER_DRAW * QUAD_INDICES * sizeof(U16)));
+    for (U16 i = 0; i < QUADS_PER_DRAW; i++) {
+        // Vertices go bottom left, bottom right, top left, top right.
+        U16* quad = indices + i * QUAD_INDICES;
+        U16 first = i * QUAD_VERTICES;
+        quad[0] = first + 0;
+        quad[1] = first + 1;
+        quad[2] = first + 2;
+        quad[3] = first + 1;
+        quad[4] = first + 2;
+        quad[5] = first + 3;
+    }
+
+    // Without vertex array objects, the element array binding is global, so
+    // it only needs to be bound once.
+    glGenBuffers_(1, &quadBuffer);
+    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, quadBuffer);
+    glBufferData_(GL_ELEMENT_ARRAY_BUFFER,
+                  QUADS_PER_DRAW * QUAD_INDICES * sizeof(U16), indices,
+                  GL_STATIC_DRAW);
+    free(indices);
+
+    glGenBuffers_(1, &streamBuffer);
+    glBindBuffer_(GL_ARRAY_BUFFER, streamBuffer);
+
+    // SDL_GL_GetProcAddress() can return functions the driver does not
+    // support, so ask about the extension first.
+    if (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage") &&
+        tryLoadCoreFunction(glBufferStorage) &&
+        tryLoadCoreFunction(glClientWaitSync) &&
+        tryLoadCoreFunction(glDeleteSync) &&
+        tryLoadCoreFunction(glFenceSync) &&
+        tryLoadCoreFunction(glMapBufferRange)) {
+        GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage_(GL_ARRAY_BUFFER, STREAM_BYTES, 0, flags);
+        streamMapping = static_cast<U8*>(
+            glMapBufferRange_(GL_ARRAY_BUFFER, 0, STREAM_BYTES, flags));
+
+        if (streamMapping == 0) {
+            // Storage is immutable now, so orphaning needs another buffer.
+            glGenBuffers_(1, &streamBuffer);
+            glBindBuffer_(GL_ARRAY_BUFFER, streamBuffer);
+        }
+    }
+
+    if (streamMapping) {
+        logInfo("GL", "Streaming vertices through a persistent mapping");
+    }
+    else {
+        loadFunction(glBufferSubData);
+        logInfo("GL", "Streaming vertices through buffer orphaning");
+    }
+
+    for (Size i = 0; i < STREAM_SEGMENTS; i++)
+        streamFences[i] = 0;
+}
+
+static void
+initUploads() noexcept {
+    if (SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object") &&
+        SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range") &&
+        tryLoadCoreFunction(glMapBufferRange) &&
+        tryLoadCoreFunction(glUnmapBuffer)) {
+        glGenBuffers_(1, &uploadBuffer);
+        logInfo("GL", "Uploading images through pixel buffer objects");
+    }
+    else {
+        logInfo("GL", "Uploading images directly");
+    }
+}
+
+static void
+waitFence(Size segment) noexcept {
+    GLsync& fence = streamFences[segment];
+    if (fence == 0)
+        return;
+
+    // Wait one second at a time.
+    while (glClientWaitSync_(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) ==
+           GL_TIMEOUT_EXPIRED)
+        ;
+
+    glDeleteSync_(fence);
+    fence = 0;
+}
+
+// Copy vertices for one draw into the ring buffer and leave it bound to
+// GL_ARRAY_BUFFER. Returns the offset the vertices start at.
+static Size
+streamVertices(const void* data, Size bytes) noexcept {
+    assert_(bytes <= STREAM_SEGMENT_BYTES);
+
+    Size offset = streamOffset;
+    bool wrapped = offset + bytes > STREAM_BYTES;
+    if (wrapped)
+        offset = 0;
+
+    glBindBuffer_(GL_ARRAY_BUFFER, streamBuffer);
+
+    if (streamMapping) {
+        Size last = (offset + bytes - 1) / STREAM_SEGMENT_BYTES;
+        while (streamSegment != last) {
+            streamFences[streamSegment] =
+                glFenceSync_(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            streamSegment = (streamSegment + 1) % STREAM_SEGMENTS;
+            waitFence(streamSegment);
+        }
+        memcpy(streamMapping + offset, data, bytes);
+    }
+    else {
+        if (wrapped)
+            glBufferData_(GL_ARRAY_BUFFER, STREAM_BYTES, 0, GL_STREAM_DRAW);
+        glBufferSubData_(GL_ARRAY_BUFFER, offset, bytes, data);
+    }
+
+    // Keep vertices aligned for the attribute pointers.
+    streamOffset = offset + ((bytes + 15) & ~static_cast<Size>(15));
+    return offset;
+}
+
+static Texture
+makeTexture(U32 width, U32 height) noexcept {
+    Texture texture;
+    glGenTextures_(1, &texture);
+    glBindTexture_(GL_TEXTURE_2D, texture);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D_(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                  GL_UNSIGNED_BYTE, 0);
+    return texture;
+}
+
+// Every texture is made the same way, so if one can be drawn to, all can.
+static bool
+canDrawToTextures() noexcept {
+    Texture texture = makeTexture(1, 1);
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, bakeFramebuffer);
+    glFramebufferTexture2D_(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_TEXTURE_2D, texture, 0);
+    bool complete =
+        glCheckFramebufferStatus_(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer_(GL_FRAMEBUFFER, 0);
+
+    glDeleteTextures_(1, &texture);
+    return complete;
+}
+
 void
 imageInit() noexcept {
     TimeMeasure m("Constructed OpenGL renderer");
 
-    if (SDL_GL_CreateContext(sdl2Window) == 0)
+    context = SDL_GL_CreateContext(sdl2Window);
+    if (context == 0)
         sdlDie("SDL", "SDL_GL_CreateContext");
 
     loadFunction(glActiveTexture);
@@ -491,14 +897,15 @@ imageInit() noexcept {
     loadFunction(glCompileShader);
     loadFunction(glCreateProgram);
     loadFunction(glCreateShader);
+    loadFunction(glDeleteTextures);
     loadFunction(glDisable);
-    loadFunction(glDrawArrays);
     loadFunction(glEnable);
     loadFunction(glEnableVertexAttribArray);
     loadFunction(glGenBuffers);
     loadFunction(glGenTextures);
     loadFunction(glGetAttribLocation);
     loadFunction(glGetError);
+    loadFunction(glGetIntegerv);
     loadFunction(glGetProgramInfoLog);
     loadFunction(glGetProgramiv);
     loadFunction(glGetShaderInfoLog);
@@ -527,15 +934,7 @@ imageInit() noexcept {
     glEnable_(GL_ALPHA_TEST);
     glAlphaFunc_(GL_NOTEQUAL, 0.0f);
 
-    glGenTextures_(1, &tAtlas);
     glActiveTexture_(GL_TEXTURE0);
-    glBindTexture_(GL_TEXTURE_2D, tAtlas);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexImage2D_(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_WIDTH, ATLAS_HEIGHT, 0,
-                  GL_RGBA, GL_UNSIGNED_BYTE, 0);
 
     ip.program = makeProgram(imageVertexSource, imageFragmentSource);
     ip.uAtlas = glGetUniformLocation_(ip.program, "uAtlas");
@@ -545,126 +944,334 @@ imageInit() noexcept {
     glUseProgram_(ip.program);
     glUniform1i_(ip.uAtlas, 0);
 
+    ip.texture = 0;
+
     rp.program = makeProgram(rectVertexSource, rectFragmentSource);
     rp.aColor = glGetAttribLocation_(rp.program, "aColor");
     rp.aPosition = glGetAttribLocation_(rp.program, "aPosition");
     rp.uProjection = glGetUniformLocation_(rp.program, "uProjection");
+
+    initStream();
+    initUploads();
+
+    if (tryLoadFunction(glBindFramebuffer) &&
+        tryLoadFunction(glCheckFramebufferStatus) &&
+        tryLoadFunction(glFramebufferTexture2D) &&
+        tryLoadFunction(glGenFramebuffers)) {
+        glGenFramebuffers_(1, &bakeFramebuffer);
+        if (!canDrawToTextures()) {
+            logErr("GL", "Cannot render to textures, tiles will not be baked");
+            bakeFramebuffer = 0;
+        }
+    }
+    else {
+        logInfo("GL", "No framebuffer objects, tiles will not be baked");
+    }
+
+    loadFunction(glScissor);
+
+    if (bakeFramebuffer && tryLoadFunction(glBindRenderbuffer) &&
+        tryLoadFunction(glFramebufferRenderbuffer) &&
+        tryLoadFunction(glGenRenderbuffers) &&
+        tryLoadFunction(glRenderbufferStorage)) {
+        glGenFramebuffers_(1, &canvasFramebuffer);
+        glGenRenderbuffers_(1, &canvasDepth);
+    }
+    else {
+        logInfo("GL", "No canvas, every frame will be drawn in full");
+    }
 }
 
-static TiledImage*
-load(StringView path) noexcept {
-    TiledImage& tiles = images.allocate(hash_(path));
-    tiles = {};
+static void*
+handleImage(U32 handle) noexcept {
+    return reinterpret_cast<void*>(static_cast<Size>(handle));
+}
 
-    String r;
-    if (!resourceLoad(path, r)) {
-        // Error logged.
-        return 0;
+static U32
+imageHandle(void* texture) noexcept {
+    return static_cast<U32>(reinterpret_cast<Size>(texture));
+}
+
+// Give out a handle and queue a texture for it.
+static U32
+makeHandle(U32 width, U32 height) noexcept {
+    U32 handle;
+    if (freeHandles.size) {
+        handle = freeHandles[freeHandles.size - 1];
+        freeHandles.pop();
     }
+    else {
+        handle = ++numHandles;
+    }
+
+    Work work = {WORK_MAKE, handle, {0, 0, width, height}, 0, 0, 0};
+    queued.work.push(work);
+    return handle;
+}
 
-    SDL_RWops* ops =
-        SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                      static_cast<int>(r.size));
+// Queue a handle's texture for deletion and give the handle back. Frames
+// published before now may still draw it.
+static void
+destroyHandle(U32 handle) noexcept {
+    Work work = {WORK_DESTROY, handle, {0, 0, 0, 0}, 0, 0, 0};
+    queued.work.push(work);
+    freeHandles.push(handle);
+}
 
-    int x = atlasUsed;
-    int y = 0;
-    int width;
-    int height;
+static void*
+makePage(U32 width, U32 height) noexcept {
+    logInfo("GL", String() << "Adding " << width << "x" << height
+                           << " atlas page");
+    return handleImage(makeHandle(width, height));
+}
 
+static void
+destroyPage(void* texture) noexcept {
+    destroyHandle(imageHandle(texture));
+}
+
+// Find the upload still on its way to the part of the atlas an image shows.
+// Returns uploads.size if there is none.
+static Size
+findUpload(Image image) noexcept {
+    for (Size i = 0; i < uploads.size; i++) {
+        Upload* upload = uploads[i];
+        const PackedRect& rect = upload->rect;
+        if (!upload->cancelled && upload->texture == image.texture &&
+            image.x >= rect.x && image.x < rect.x + rect.width &&
+            image.y >= rect.y && image.y < rect.y + rect.height)
+            return i;
+    }
+    return uploads.size;
+}
+
+static Image
+imageOf(const AtlasImage& entry) noexcept {
+    Image image = {entry.texture, entry.x, entry.y, entry.width, entry.height};
+    return image;
+}
+
+static void
+evicted(StringView path, const AtlasImage& entry, AtlasPage& page) noexcept {
+    // Its space may be given to another image before the worker is done, so
+    // the pixels must not arrive.
+    Size i = findUpload(imageOf(entry));
+    if (i < uploads.size) {
+        uploads[i]->cancelled = true;
+        page.numPending -= 1;
+    }
+
+    logInfo("GL", String() << "Evicted " << path << " from the atlas");
+}
+
+static const AtlasHooks atlasHooks = {makePage, destroyPage, evicted};
+
+static Atlas atlas(atlasHooks);
+
+static void
+decodeUpload(void* data) noexcept {
+    Upload* upload = static_cast<Upload*>(data);
+
+    {
+        TimeMeasure m(String() << "Constructed " << upload->path
+                               << " as image");
+
+        const U8* bytes = reinterpret_cast<const U8*>(upload->file.data);
+        upload->pixels =
+            xmalloc(U32, static_cast<Size>(upload->width) * upload->height);
+        if (!decodeImage(bytes, upload->file.size, upload->pixels,
+                         upload->width, PIXELS_ARGB)) {
+            free(upload->pixels);
+            upload->pixels = 0;
+        }
+    }
+
+    LockGuard lock(uploadsMutex);
+    uploadsFinished.push(upload);
+}
+
+// Take note of the uploads workers have finished decoding.
+static void
+collectUploads() noexcept {
+    Vector<Upload*> finished;
     {
-        TimeMeasure m(String() << "Constructed " << path << " as image");
+        LockGuard lock(uploadsMutex);
+        if (uploadsFinished.size == 0)
+            return;
+        finished = static_cast<Vector<Upload*>&&>(uploadsFinished);
+    }
 
-        //SDL_Surface* surface = IMG_Load_RW(ops, 1);
-        SDL_Surface* surface = SDL_LoadBMP_RW(ops, 1);
-        if (!surface) {
-            logFatal("SDL2", String() << "Invalid image: " << path);
-            return 0;
+    for (Upload** upload = finished.begin(); upload != finished.end();
+         upload++)
+        (*upload)->decoded = true;
+}
+
+// Queue a decoded upload's pixels for its atlas page and forget it.
+static void
+finishUpload(Size i) noexcept {
+    Upload* upload = uploads[i];
+    assert_(upload->decoded);
+
+    if (!upload->cancelled) {
+        if (upload->pixels == 0)
+            logFatal("SDL2", String() << "Invalid image: " << upload->path);
+
+        atlas.findPage(upload->texture)->numPending -= 1;
+
+        Work work = {WORK_UPLOAD, imageHandle(upload->texture), upload->rect,
+                     upload->pixels, 0, 0};
+        queued.work.push(work);
+    }
+    else {
+        free(upload->pixels);
+    }
+
+    delete upload;
+    uploads.erase(i);
+}
+
+// Queue decoded uploads for the atlas, oldest first, up to confUploadBudget.
+// At least one is queued each frame so that images larger than the budget
+// arrive too.
+static void
+finishUploads() noexcept {
+    collectUploads();
+
+    Size budget = static_cast<Size>(confUploadBudget) << 10;
+    Size spent = 0;
+
+    for (Size i = 0; i < uploads.size;) {
+        Upload* upload = uploads[i];
+        if (!upload->decoded) {
+            i++;
+            continue;
         }
 
-        width = surface->w;
-        height = surface->h;
-
-        // Rectangle packing algorithm:
-        //
-        // Copy surface into the atlas to the right of the previous image,
-        // or at the left edge, if there was no previous image.
-        glTexSubImage2D_(GL_TEXTURE_2D,     // target
-                         0,                 // level
-                         x,                 // xoffset
-                         y,                 // yoffset
-                         width,             // width
-                         height,            // height
-                         GL_BGRA,           // format
-                         GL_UNSIGNED_BYTE,  // type
-                         surface->pixels    // data
-        );
-        /*
-        glTexImage2D_(
-            GL_TEXTURE_2D,
-            0,
-            GL_RGBA,
-            width,
-            height,
-            0,
-            GL_RGBA,
-            GL_UNSIGNED_BYTE,
-            surface->pixels
-        );
-        */
-
-        SDL_FreeSurface(surface);
-    }
-
-    tiles.image = {
-        reinterpret_cast<void*>(tAtlas),
-        static_cast<U32>(x),
-        static_cast<U32>(y),
-        static_cast<U32>(width),
-        static_cast<U32>(height),
-    };
+        if (!upload->cancelled) {
+            Size bytes = static_cast<Size>(upload->width) * upload->height * 4;
+            if (spent > 0 && spent + bytes > budget)
+                break;
+            spent += bytes;
+            queued.arrived = true;
+        }
+
+        finishUpload(i);
+    }
+}
+
+// Make an image resident. Its pixels follow on a later frame. Returns false
+// if it could not be loaded.
+static bool
+load(StringView path, AtlasImage& entry) noexcept {
+    Upload* upload = new Upload;
+    if (!resourceLoad(path, upload->file)) {
+        // Error logged.
+        delete upload;
+        return false;
+    }
 
-    atlasUsed += static_cast<U32>(width);
+    U32 width;
+    U32 height;
 
-    return &tiles;
+    const U8* bytes = reinterpret_cast<const U8*>(upload->file.data);
+    if (!decodeImageSize(bytes, upload->file.size, &width, &height)) {
+        logFatal("SDL2", String() << "Invalid image: " << path);
+        delete upload;
+        return false;
+    }
+
+    Size budget = static_cast<Size>(confTextureBudget) << 20;
+    if (!atlas.place(entry, width, height, budget, worldTime()))
+        logInfo("GL", "Texture budget exceeded by images in use");
+
+    PackedRect rect = {entry.x, entry.y, width, height};
+
+    // Its place is cleared to transparent, which the alpha test discards, so
+    // that it is drawn as nothing until its pixels arrive without a check on
+    // each draw. Unless pages cannot be drawn to, in which case draws check.
+    atlas.findPage(entry.texture)->numPending += 1;
+    if (bakeFramebuffer) {
+        Work work = {WORK_CLEAR, imageHandle(entry.texture), rect, 0, 0, 0};
+        queued.work.push(work);
+    }
+
+    upload->path = path;
+    upload->width = width;
+    upload->height = height;
+    upload->pixels = 0;
+    upload->texture = entry.texture;
+    upload->rect = rect;
+    upload->decoded = false;
+    upload->cancelled = false;
+    uploads.push(upload);
+
+    Function fn = {decodeUpload, upload};
+    JobsEnqueue(fn);
+
+    return true;
 }
 
 Image
 imageLoad(StringView path) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
-
-    if (!tiles)
-        tiles = load(path);
+    AtlasImage& entry = atlas.image(path);
 
-    assert_(tiles);
+    if (entry.texture == 0 && !load(path, entry))
+        return imageOf(entry);
 
-    return tiles->image;
+    entry.numUsers += 1;
+    return imageOf(entry);
 }
 
 void
-imageRelease(Image image) noexcept { }
+imageRelease(Image image) noexcept {
+    if (!IMAGE_VALID(image))
+        return;
 
-void
-imageDraw(Image image, float x, float y, float z) noexcept {
-    fvec2 trans = sdl2Translation;
-    fvec2 scale = sdl2Scaling;
+    AtlasImage* entry = atlas.find(image.texture, image.x, image.y);
+    assert_(entry);
 
-    float yTop = scale.y * (trans.y + y);
-    float yBottom = scale.y * (trans.y + y + image.height);
-    float xLeft = scale.x * (trans.x + x);
-    float xRight = scale.x * (trans.x + x + image.width);
+    entry->numUsers -= 1;
+    assert_(entry->numUsers >= 0);
 
-    Size offset = ip.attributes.size;
+    if (entry->numUsers == 0)
+        entry->lastUse = worldTime();
+}
+
+static void
+drawImages(Transform projection) noexcept;
+
+// Start sampling from a texture. Whatever was queued for the previous texture
+// must already be drawn.
+static void
+useTexture(Texture texture, U32 width, U32 height) noexcept {
+    assert_(ip.attributes.size == 0);
 
-    const Size QUAD_COORDS = 6;
+    ip.texture = texture;
+    ip.textureWidth = static_cast<float>(width);
+    ip.textureHeight = static_cast<float>(height);
+}
+
+// The texture behind an image's handle.
+static const HandleTexture&
+textureOf(Image image) noexcept {
+    return handleTextures[imageHandle(image.texture) - 1];
+}
+
+// Append a quad showing an image to ip.attributes. Coordinates are in the
+// same space as the projection that will be used to draw it.
+static void
+pushImage(Image image, float xLeft, float xRight, float yTop, float yBottom,
+          float z) noexcept {
+    Size offset = ip.attributes.size;
 
     if (ip.attributes.capacity == 0)
-        ip.attributes.reserve(QUAD_COORDS * 8);
-    else if (ip.attributes.size + QUAD_COORDS > ip.attributes.capacity)
+        ip.attributes.reserve(QUAD_VERTICES * 8);
+    else if (ip.attributes.size + QUAD_VERTICES > ip.attributes.capacity)
         ip.attributes.reserve(ip.attributes.capacity * 2);
-    ip.attributes.size += QUAD_COORDS;
+    ip.attributes.size += QUAD_VERTICES;
 
-    float tWidth = ATLAS_WIDTH;
-    float tHeight = ATLAS_HEIGHT;
+    float tWidth = ip.textureWidth;
+    float tHeight = ip.textureHeight;
 
     float vTop = image.y / tHeight;
     float vBottom = (image.y + image.height) / tHeight;
@@ -683,42 +1290,262 @@ imageDraw(Image image, float x, float y, float z) noexcept {
         {xLeft, yTop, z},
         {uLeft, vTop}
     };
-
     ip.attributes[offset + 3] = {
-        {xRight, yBottom, z},
-        {uRight, vBottom}
-    };
-    ip.attributes[offset + 4] = {
-        {xLeft, yTop, z},
-        {uLeft, vTop}
-    };
-    ip.attributes[offset + 5] = {
         {xRight, yTop, z},
         {uRight, vTop}
     };
 }
 
+bool
+imageReady(Image image) noexcept {
+    if (uploads.size == 0)
+        return true;
+
+    // Baked images are not in the atlas.
+    AtlasPage* page = atlas.findPage(image.texture);
+    if (page == 0 || page->numPending == 0)
+        return true;
+
+    return findUpload(image) == uploads.size;
+}
+
+void
+imageDraw(Image image, float x, float y, float z) noexcept {
+    // Until its pixels arrive, an image is drawn as nothing. Its place is
+    // cleared for that, unless pages cannot be drawn to, in which case frames
+    // are presented on the main thread and it can be asked.
+    if (bakeFramebuffer == 0 && !imageReady(image))
+        return;
+
+    const HandleTexture& t = textureOf(image);
+    if (t.texture != ip.texture) {
+        // Each batch samples from one texture, so a new batch starts only
+        // when drawing moves to another atlas page or a baked image.
+        imageFlushImages();
+        useTexture(t.texture, t.width, t.height);
+    }
+
+    fvec2 trans = sdl2Translation;
+    fvec2 scale = sdl2Scaling;
+
+    float yTop = scale.y * (trans.y + y);
+    float yBottom = scale.y * (trans.y + y + image.height);
+    float xLeft = scale.x * (trans.x + x);
+    float xRight = scale.x * (trans.x + x + image.width);
+
+    pushImage(image, xLeft, xRight, yTop, yBottom, z);
+}
+
+Image
+imageBake(U32 width, U32 height, const BakeItem* items, Size count) noexcept {
+    Image baked = {0, 0, 0, 0, 0};
+    if (bakeFramebuffer == 0)
+        return baked;
+
+    U32 handle = makeHandle(width, height);
+
+    Work work = {WORK_BAKE, handle, {0, 0, width, height}, 0,
+                 queued.items.size, count};
+    queued.work.push(work);
+    for (Size i = 0; i < count; i++)
+        queued.items.push(items[i]);
+
+    baked.texture = handleImage(handle);
+    baked.width = width;
+    baked.height = height;
+    return baked;
+}
+
+void
+imageBakeRelease(Image image) noexcept {
+    destroyHandle(imageHandle(image.texture));
+}
+
+//
+// Work, on the thread that presents frames
+//
+
+static void
+makeHandleTexture(const Work& work) noexcept {
+    if (handleTextures.size < work.handle)
+        handleTextures.resize(work.handle);
+
+    HandleTexture& t = handleTextures[work.handle - 1];
+    t.texture = makeTexture(work.rect.width, work.rect.height);
+    t.width = work.rect.width;
+    t.height = work.rect.height;
+}
+
+static void
+destroyHandleTexture(const Work& work) noexcept {
+    HandleTexture& t = handleTextures[work.handle - 1];
+    if (t.texture == ip.texture) {
+        imageFlushImages();
+        ip.texture = 0;
+    }
+
+    glDeleteTextures_(1, &t.texture);
+    t.texture = 0;
+}
+
+static void
+clearPlace(const Work& work) noexcept {
+    const PackedRect& rect = work.rect;
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, bakeFramebuffer);
+    glFramebufferTexture2D_(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_TEXTURE_2D,
+                            handleTextures[work.handle - 1].texture, 0);
+
+    glEnable_(GL_SCISSOR_TEST);
+    glScissor_(rect.x, rect.y, rect.width, rect.height);
+    glClearColor_(0, 0, 0, 0);
+    glClear_(GL_COLOR_BUFFER_BIT);
+    glDisable_(GL_SCISSOR_TEST);
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, screenFramebuffer);
+}
+
+static void
+uploadPixels(const Work& work) noexcept {
+    const PackedRect& rect = work.rect;
+    Size bytes = static_cast<Size>(rect.width) * rect.height * 4;
+    const void* pixels = work.pixels;
+
+    if (uploadBuffer) {
+        // Orphan the previous upload's storage, which the driver may still be
+        // reading from.
+        glBindBuffer_(GL_PIXEL_UNPACK_BUFFER, uploadBuffer);
+        glBufferData_(GL_PIXEL_UNPACK_BUFFER, bytes, 0, GL_STREAM_DRAW);
+        void* mapping = glMapBufferRange_(
+            GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapping) {
+            memcpy(mapping, work.pixels, bytes);
+            // Pixels now come from offset zero of the buffer, unless its
+            // contents were lost while mapped.
+            if (glUnmapBuffer_(GL_PIXEL_UNPACK_BUFFER))
+                pixels = 0;
+        }
+        if (pixels)
+            glBindBuffer_(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glBindTexture_(GL_TEXTURE_2D, handleTextures[work.handle - 1].texture);
+    glTexSubImage2D_(GL_TEXTURE_2D,                      // target
+                     0,                                  // level
+                     rect.x,                             // xoffset
+                     rect.y,                             // yoffset
+                     static_cast<GLsizei>(rect.width),   // width
+                     static_cast<GLsizei>(rect.height),  // height
+                     GL_BGRA,                            // format
+                     GL_UNSIGNED_BYTE,                   // type
+                     pixels                              // data
+    );
+
+    // Other pixel transfers, such as making textures, read from memory.
+    if (pixels == 0)
+        glBindBuffer_(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    free(work.pixels);
+}
+
+static void
+bake(const Work& work, const BakeItem* items) noexcept {
+    glBindFramebuffer_(GL_FRAMEBUFFER, bakeFramebuffer);
+    glFramebufferTexture2D_(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_TEXTURE_2D,
+                            handleTextures[work.handle - 1].texture, 0);
+
+    GLint viewport[4];
+    glGetIntegerv_(GL_VIEWPORT, viewport);
+    glViewport_(0, 0, work.rect.width, work.rect.height);
+
+    glClearColor_(0, 0, 0, 0);
+    glClear_(GL_COLOR_BUFFER_BIT);
+
+    // Rows of the texture run bottom to top in framebuffer space, so map y
+    // upward to store the top row first, as images in the atlas are.
+    float w = static_cast<float>(work.rect.width);
+    float h = static_cast<float>(work.rect.height);
+    Transform projection = transformMultiply(transformScale(2.0f / w, 2.0f / h),
+                                             transformTranslate(-1, -1));
+
+    // Items do not overlap, so copy them as they are.
+    glDisable_(GL_BLEND);
+    glDisable_(GL_DEPTH_TEST);
+
+    for (Size i = 0; i < work.numItems; i++) {
+        const BakeItem& item = items[i];
+        const HandleTexture& t = textureOf(item.image);
+        if (t.texture != ip.texture) {
+            // Items can come from several atlas pages.
+            if (ip.attributes.size)
+                drawImages(projection);
+            useTexture(t.texture, t.width, t.height);
+        }
+        pushImage(item.image, item.x, item.x + item.image.width, item.y,
+                  item.y + item.image.height, 0.0f);
+    }
+    if (ip.attributes.size)
+        drawImages(projection);
+
+    glEnable_(GL_BLEND);
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, screenFramebuffer);
+    glViewport_(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+// Carry out the work published with the frame being started, in the order it
+// was queued. Returns whether any images arrived.
+static bool
+runWork(WorkList& list) noexcept {
+    for (Work* work = list.work.begin(); work != list.work.end(); work++) {
+        switch (work->type) {
+        case WORK_MAKE: makeHandleTexture(*work); break;
+        case WORK_DESTROY: destroyHandleTexture(*work); break;
+        case WORK_CLEAR: clearPlace(*work); break;
+        case WORK_UPLOAD: uploadPixels(*work); break;
+        case WORK_BAKE: bake(*work, list.items.data + work->firstItem); break;
+        }
+    }
+
+    bool arrived = list.arrived;
+    list.work.clear();
+    list.items.clear();
+    list.arrived = false;
+    return arrived;
+}
+
 TiledImage
 tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
           U32 numHigh) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    AtlasImage& entry = atlas.image(path);
 
-    if (!tiles) {
-        tiles = load(path);
+    TiledImage tiles;
+    tiles.tileWidth = tileWidth;
+    tiles.tileHeight = tileHeight;
+    tiles.numTiles = numAcross * numHigh;
 
-        assert_(tiles->image.width == tileWidth * numAcross);
-        assert_(tiles->image.height == tileHeight * numHigh);
+    if (entry.texture == 0) {
+        if (!load(path, entry)) {
+            tiles.image = imageOf(entry);
+            return tiles;
+        }
 
-        tiles->tileWidth = tileWidth;
-        tiles->tileHeight = tileHeight;
-        tiles->numTiles = numAcross * numHigh;
+        assert_(entry.width == tileWidth * numAcross);
+        assert_(entry.height == tileHeight * numHigh);
     }
 
-    return *tiles;
+    entry.numUsers += 1;
+    tiles.image = imageOf(entry);
+    return tiles;
 }
 
 void
-tilesRelease(TiledImage tiles) noexcept { }
+tilesRelease(TiledImage tiles) noexcept {
+    imageRelease(tiles.image);
+}
 
 Image
 tileAt(TiledImage tiles, U32 index) noexcept {
@@ -736,7 +1563,9 @@ tileAt(TiledImage tiles, U32 index) noexcept {
 }
 
 void
-imagesPrune(Time latestPermissibleUse) noexcept { }
+imagesPrune(Time latestPermissibleUse) noexcept {
+    atlas.prune(latestPermissibleUse);
+}
 
 void
 imageDrawRect(float left, float right, float top, float bottom, float z,
@@ -751,13 +1580,11 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
 
     Size offset = rp.attributes.size;
 
-    const Size QUAD_COORDS = 6;
-
     if (rp.attributes.capacity == 0)
-        rp.attributes.reserve(QUAD_COORDS * 8);
-    else if (rp.attributes.size + QUAD_COORDS > rp.attributes.capacity)
+        rp.attributes.reserve(QUAD_VERTICES * 8);
+    else if (rp.attributes.size + QUAD_VERTICES > rp.attributes.capacity)
         rp.attributes.reserve(rp.attributes.capacity * 2);
-    rp.attributes.size += QUAD_COORDS;
+    rp.attributes.size += QUAD_VERTICES;
 
     U8 a = (argb >> 24) & 0xFF;
     U8 r = (argb >> 16) & 0xFF;
@@ -785,22 +1612,7 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
         b,
         a
     };
-
     rp.attributes[offset + 3] = {
-        {xRight, yBottom, z},
-        r,
-        g,
-        b,
-        a
-    };
-    rp.attributes[offset + 4] = {
-        {xLeft, yTop, z},
-        r,
-        g,
-        b,
-        a
-    };
-    rp.attributes[offset + 5] = {
         {xRight, yTop, z},
         r,
         g,
@@ -809,12 +1621,121 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
     };
 }
 
+// Make the canvas the size of the window. Returns false if there is no canvas.
+static bool
+sizeCanvas() noexcept {
+    if (canvasFramebuffer == 0)
+        return false;
+
+    GLsizei width = confWindowSize.x;
+    GLsizei height = confWindowSize.y;
+    if (width == canvasWidth && height == canvasHeight)
+        return true;
+
+    if (canvasTexture)
+        glDeleteTextures_(1, &canvasTexture);
+    canvasTexture = makeTexture(width, height);
+    canvasWidth = width;
+    canvasHeight = height;
+    canvasKept = false;
+
+    glBindRenderbuffer_(GL_RENDERBUFFER, canvasDepth);
+    glRenderbufferStorage_(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width,
+                           height);
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, canvasFramebuffer);
+    glFramebufferTexture2D_(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_TEXTURE_2D, canvasTexture, 0);
+    glFramebufferRenderbuffer_(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                               GL_RENDERBUFFER, canvasDepth);
+    bool complete =
+        glCheckFramebufferStatus_(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer_(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        logErr("GL", "Cannot draw to a canvas, every frame will be drawn in "
+                     "full");
+        glDeleteTextures_(1, &canvasTexture);
+        canvasFramebuffer = 0;
+        canvasTexture = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+imagesNeedRedraw() noexcept {
+    collectUploads();
+
+    for (Upload** upload = uploads.begin(); upload != uploads.end(); upload++)
+        if ((*upload)->decoded && !(*upload)->cancelled)
+            return true;
+    return false;
+}
+
 void
-imageStartFrame() noexcept {
-    // FIXME: Uses lots of CPU on macOS. Replace with adding black borders
-    //        around play area.
-    glClearColor_(0, 0, 0, 1);
-    glClear_(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+imagesPublish() noexcept {
+    finishUploads();
+
+    WorkList& list = published[numPublished % 2];
+    list.work = static_cast<Vector<Work>&&>(queued.work);
+    list.items = static_cast<Vector<BakeItem>&&>(queued.items);
+    list.arrived = queued.arrived;
+    queued.arrived = false;
+
+    numPublished += 1;
+}
+
+// Frames can be presented elsewhere only if no draw needs to ask whether its
+// image has arrived, which only the main thread knows.
+bool
+imagesDetachThread() noexcept {
+    if (bakeFramebuffer == 0) {
+        logInfo("GL", "No framebuffer objects, frames will be presented on "
+                      "the main thread");
+        return false;
+    }
+
+    if (SDL_GL_MakeCurrent(sdl2Window, 0) < 0) {
+        sdlError("GL", "SDL_GL_MakeCurrent");
+        return false;
+    }
+    return true;
+}
+
+void
+imagesAttachThread() noexcept {
+    if (SDL_GL_MakeCurrent(sdl2Window, context) < 0)
+        sdlDie("GL", "SDL_GL_MakeCurrent");
+}
+
+bool
+imageStartFrame(bool keep) noexcept {
+    frameStart = chronoNow();
+
+    if (runWork(published[numStarted % 2]))
+        keep = false;
+    numStarted += 1;
+
+    if (sizeCanvas()) {
+        screenFramebuffer = canvasFramebuffer;
+        glBindFramebuffer_(GL_FRAMEBUFFER, canvasFramebuffer);
+        glGetIntegerv_(GL_VIEWPORT, windowViewport);
+        glViewport_(0, 0, canvasWidth, canvasHeight);
+    }
+
+    keep = keep && canvasKept;
+    canvasKept = canvasFramebuffer != 0;
+
+    if (!keep) {
+        // FIXME: Uses lots of CPU on macOS. Replace with adding black
+        //        borders around play area.
+        glClearColor_(0, 0, 0, 1);
+        glClear_(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    return keep;
 }
 
 static struct Transform
@@ -826,35 +1747,47 @@ getOrtho() noexcept {
                              transformTranslate(-1, 1));
 }
 
-void
-imageFlushImages() noexcept {
-    if (ip.attributes.size == 0)
-        return;
-
+static void
+drawImages(Transform projection) noexcept {
     glUseProgram_(ip.program);
-
-    glBindBuffer_(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData_(GL_ARRAY_BUFFER, ip.attributes.size * sizeof(ImageVertex),
-                  ip.attributes.data, GL_STATIC_DRAW);
+    glBindTexture_(GL_TEXTURE_2D, ip.texture);
 
     glEnableVertexAttribArray_(ip.aPosition);
     glEnableVertexAttribArray_(ip.aTexCoord);
 
-    glVertexAttribPointer_(ip.aPosition, 3, GL_FLOAT, false,
-                           sizeof(ImageVertex),
-                           &static_cast<ImageVertex*>(0)->position);
-    glVertexAttribPointer_(ip.aTexCoord, 2, GL_FLOAT, false,
-                           sizeof(ImageVertex),
-                           &static_cast<ImageVertex*>(0)->texCoord);
+    glUniformMatrix4fv_(ip.uProjection, 1, false, projection.m);
 
-    glUniformMatrix4fv_(ip.uProjection, 1, false, getOrtho().m);
+    Size quads = ip.attributes.size / QUAD_VERTICES;
+    frameQuads += quads;
 
-    glEnable_(GL_DEPTH_TEST);
-    glDrawArrays_(GL_TRIANGLES, 0, ip.attributes.size);
+    for (Size first = 0; first < quads; first += QUADS_PER_DRAW) {
+        Size count = min(quads - first, static_cast<Size>(QUADS_PER_DRAW));
+        Size offset = streamVertices(
+            ip.attributes.data + first * QUAD_VERTICES,
+            count * QUAD_VERTICES * sizeof(ImageVertex));
+
+        ImageVertex* vertices = reinterpret_cast<ImageVertex*>(offset);
+        glVertexAttribPointer_(ip.aPosition, 3, GL_FLOAT, false,
+                               sizeof(ImageVertex), &vertices->position);
+        glVertexAttribPointer_(ip.aTexCoord, 2, GL_FLOAT, false,
+                               sizeof(ImageVertex), &vertices->texCoord);
+
+        glDrawElements_(GL_TRIANGLES, count * QUAD_INDICES, GL_UNSIGNED_SHORT,
+                        0);
+    }
 
     ip.attributes.size = 0;
 }
 
+void
+imageFlushImages() noexcept {
+    if (ip.attributes.size == 0)
+        return;
+
+    glEnable_(GL_DEPTH_TEST);
+    drawImages(getOrtho());
+}
+
 void
 imageFlushRects() noexcept {
     if (rp.attributes.size == 0)
@@ -862,27 +1795,111 @@ imageFlushRects() noexcept {
 
     glUseProgram_(rp.program);
 
-    glBindBuffer_(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData_(GL_ARRAY_BUFFER, rp.attributes.size * sizeof(RectVertex),
-                  rp.attributes.data, GL_STATIC_DRAW);
-
     glEnableVertexAttribArray_(rp.aPosition);
     glEnableVertexAttribArray_(rp.aColor);
 
-    glVertexAttribPointer_(rp.aPosition, 3, GL_FLOAT, false, sizeof(RectVertex),
-                           &static_cast<RectVertex*>(0)->position);
-    glVertexAttribPointer_(rp.aColor, 4, GL_UNSIGNED_BYTE, true,
-                           sizeof(RectVertex), &static_cast<RectVertex*>(0)->r);
-
     glUniformMatrix4fv_(rp.uProjection, 1, false, getOrtho().m);
 
     glDisable_(GL_DEPTH_TEST);
-    glDrawArrays_(GL_TRIANGLES, 0, rp.attributes.size);
+
+    Size quads = rp.attributes.size / QUAD_VERTICES;
+    frameQuads += quads;
+
+    for (Size first = 0; first < quads; first += QUADS_PER_DRAW) {
+        Size count = min(quads - first, static_cast<Size>(QUADS_PER_DRAW));
+        Size offset =
+            streamVertices(rp.attributes.data + first * QUAD_VERTICES,
+                           count * QUAD_VERTICES * sizeof(RectVertex));
+
+        RectVertex* vertices = reinterpret_cast<RectVertex*>(offset);
+        glVertexAttribPointer_(rp.aPosition, 3, GL_FLOAT, false,
+                               sizeof(RectVertex), &vertices->position);
+        glVertexAttribPointer_(rp.aColor, 4, GL_UNSIGNED_BYTE, true,
+                               sizeof(RectVertex), &vertices->r);
+
+        glDrawElements_(GL_TRIANGLES, count * QUAD_INDICES, GL_UNSIGNED_SHORT,
+                        0);
+    }
 
     rp.attributes.size = 0;
 }
 
+void
+imageBeginRegion(I32 x, I32 y, I32 width, I32 height) noexcept {
+    imageFlushImages();
+    imageFlushRects();
+
+    // Framebuffer rows run bottom to top.
+    glEnable_(GL_SCISSOR_TEST);
+    glScissor_(x, canvasHeight - y - height, width, height);
+
+    glClearColor_(0, 0, 0, 1);
+    glClear_(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void
+imageEndRegion() noexcept {
+    imageFlushImages();
+    imageFlushRects();
+
+    glDisable_(GL_SCISSOR_TEST);
+}
+
+// Copy the canvas to the window.
+static void
+drawCanvas() noexcept {
+    imageFlushImages();
+    imageFlushRects();
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, 0);
+    glViewport_(windowViewport[0], windowViewport[1], windowViewport[2],
+                windowViewport[3]);
+    screenFramebuffer = 0;
+
+    // Not a handle, but pushImage() only needs its size.
+    Image canvas = {0, 0, 0, static_cast<U32>(canvasWidth),
+                    static_cast<U32>(canvasHeight)};
+    useTexture(canvasTexture, canvas.width, canvas.height);
+
+    // As with baked images, the canvas's rows run bottom to top, so map y
+    // upward.
+    float w = static_cast<float>(canvasWidth);
+    float h = static_cast<float>(canvasHeight);
+    Transform projection = transformMultiply(transformScale(2.0f / w, 2.0f / h),
+                                             transformTranslate(-1, -1));
+
+    glDisable_(GL_BLEND);
+    glDisable_(GL_DEPTH_TEST);
+
+    pushImage(canvas, 0, w, 0, h, 0.0f);
+    drawImages(projection);
+
+    glEnable_(GL_BLEND);
+}
+
 void
 imageEndFrame() noexcept {
+    if (screenFramebuffer)
+        drawCanvas();
+
+    // Measured before the swap, which may wait for vsync.
+    Nanoseconds taken = chronoNow() - frameStart;
+    frameTotal += taken;
+    frameWorst = max(frameWorst, taken);
+    frameCount += 1;
+
+    if (frameCount == FRAME_STATS_PERIOD) {
+        logInfo("GL", String() << "Frame submission: "
+                               << ns_to_s_d(frameTotal / frameCount) * 1000
+                               << " ms average, "
+                               << ns_to_s_d(frameWorst) * 1000 << " ms worst, "
+                               << frameQuads / frameCount
+                               << " quads per frame");
+        frameTotal = 0;
+        frameWorst = 0;
+        frameCount = 0;
+        frameQuads = 0;
+    }
+
     SDL_GL_SwapWindow(sdl2Window);
 }
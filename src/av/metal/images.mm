@@ -150,6 +150,20 @@ imageDraw(Image image, float x, float y, float z) noexcept { }
 void
 imageRelease(Image image) noexcept { }
 
+bool
+imageReady(Image image) noexcept {
+    return true;
+}
+
+Image
+imageBake(U32 width, U32 height, const BakeItem* items, Size count) noexcept {
+    Image image = {0, 0, 0, 0, 0};
+    return image;
+}
+
+void
+imageBakeRelease(Image image) noexcept { }
+
 TiledImage
 tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
           U32 numWide) noexcept {
@@ -174,8 +188,26 @@ tileAt(TiledImage tiles, U32 index) noexcept {
 void
 imagesPrune(Time latestPermissibleUse) noexcept { }
 
+bool
+imagesNeedRedraw() noexcept {
+    return false;
+}
+
 void
-imageStartFrame(void) noexcept { }
+imagesPublish() noexcept { }
+
+bool
+imagesDetachThread() noexcept {
+    return false;
+}
+
+void
+imagesAttachThread() noexcept { }
+
+bool
+imageStartFrame(bool keep) noexcept {
+    return false;
+}
 
 void
 imageEndFrame(void) noexcept {
@@ -206,6 +238,12 @@ imageFlushRects(void) noexcept { }
 void
 imageFlushImages(void) noexcept { }
 
+void
+imageBeginRegion(I32 x, I32 y, I32 width, I32 height) noexcept { }
+
+void
+imageEndRegion(void) noexcept { }
+
 void
 imageDrawRect(float left, float right, float top, float bottom, float z,
               U32 argb) noexcept { }
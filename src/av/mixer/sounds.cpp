@@ -0,0 +1,284 @@
+#include "av/mixer/sounds.h"
+
+#include "tiles/client-conf.h"
+#include "tiles/sounds.h"
+#include "tiles/world.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/hashtable.h"
+#include "util/int.h"
+#include "util/markable.h"
+#include "util/mixer.h"
+#include "util/new.h"
+#include "util/pool.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// A SoundID is handed out once per path and stays valid while it has users,
+// so that playing a sound needs no lookup. Its decoded PCM stays resident
+// while within confSoundBudget, least recently played evicted first, and is
+// decoded again if played after that.
+struct MixedSound {
+    int numUsers;
+    Time lastUse;
+    int playing;  // Voices playing it.
+
+    String path;
+    SoundPCM pcm;  // pcm.frames is zero if not resident.
+};
+
+struct MixedPlayingSound {
+    bool inUse;
+    bool stopped;
+
+    I32 voice;  // -1 once the mixer has finished with it.
+};
+
+Mixer soundMixer;
+
+static Hashmap<String, SoundID> soundIDs;
+static Pool<MixedSound> soundPool;
+static Pool<MixedPlayingSound> playingSoundPool;
+
+// Every sound that has been loaded, for eviction to look through.
+static Vector<int> sounds;
+// Bytes of PCM resident.
+static Size soundBytes = 0;
+
+// The PlayingSoundID and SoundID of each voice.
+static I32 voicePlayingSounds[MIXER_VOICES];
+static I32 voiceSounds[MIXER_VOICES];
+
+static bool
+init() noexcept {
+    static bool initialized = false;
+    static bool on = false;
+
+    if (!initialized) {
+        initialized = true;
+        on = soundsOpen();
+    }
+    return on;
+}
+
+// Learn which voices have finished.
+static void
+collect() noexcept {
+    I32 voice;
+    while (soundMixer.finished(voice)) {
+        soundPool[voiceSounds[voice]].playing -= 1;
+
+        int psid = voicePlayingSounds[voice];
+        MixedPlayingSound& ps = playingSoundPool[psid];
+        ps.voice = -1;
+        if (!ps.inUse)
+            playingSoundPool.release(psid);
+    }
+}
+
+static void
+evict(MixedSound& sound) noexcept {
+    soundBytes -= static_cast<Size>(sound.pcm.numFrames) * 4;
+    soundFree(sound.pcm);
+    sound.pcm.frames = 0;
+}
+
+// Evict the least recently played sound that is resident and not playing,
+// other than keep. Returns false if there is nothing to evict.
+static bool
+evictOldest(MixedSound* keep) noexcept {
+    MixedSound* oldest = 0;
+    for (int* sid = sounds.begin(); sid != sounds.end(); sid++) {
+        MixedSound& sound = soundPool[*sid];
+        if (sound.pcm.frames == 0 || &sound == keep || sound.playing)
+            continue;
+        if (oldest == 0 || sound.lastUse < oldest->lastUse)
+            oldest = &sound;
+    }
+
+    if (oldest == 0)
+        return false;
+
+    evict(*oldest);
+    return true;
+}
+
+// Make a sound's PCM resident, evicting others to stay within budget. Returns
+// false if it could not be decoded.
+static bool
+makeResident(MixedSound& sound) noexcept {
+    if (sound.pcm.frames)
+        return true;
+
+    if (!soundDecode(sound.path, sound.pcm)) {
+        sound.pcm.frames = 0;
+        return false;
+    }
+
+    soundBytes += static_cast<Size>(sound.pcm.numFrames) * 4;
+
+    Size budget = static_cast<Size>(confSoundBudget) << 20;
+    while (soundBytes > budget && evictOldest(&sound))
+        ;
+
+    return true;
+}
+
+SoundID
+soundLoad(StringView path) noexcept {
+    if (!init())
+        return mark;
+
+    collect();
+
+    SoundID* cachedId = soundIDs.tryAt(path);
+    if (cachedId) {
+        if (!*cachedId)
+            return mark;
+        int sid = **cachedId;
+        soundPool[sid].numUsers += 1;
+        return SoundID(sid);
+    }
+
+    int sid = soundPool.allocate();
+    MixedSound& sound = soundPool[sid];
+    new (&sound.path) String(path);
+    sound.numUsers = 1;
+    sound.lastUse = worldTime();
+    sound.playing = 0;
+    sound.pcm.frames = 0;
+
+    if (!makeResident(sound)) {
+        sound.path.~String();
+        soundPool.release(sid);
+        soundIDs[path] = mark;
+        return mark;
+    }
+
+    sounds.push(sid);
+    soundIDs[path] = sid;
+
+    return SoundID(sid);
+}
+
+void
+soundsPrune(Time latestPermissibleUse) noexcept {
+    collect();
+
+    for (int* sid = sounds.begin(); sid != sounds.end(); sid++) {
+        MixedSound& sound = soundPool[*sid];
+        if (sound.numUsers == 0 && sound.pcm.frames &&
+            sound.lastUse < latestPermissibleUse && !sound.playing)
+            evict(sound);
+    }
+}
+
+PlayingSoundID
+soundPlay(SoundID sid) noexcept {
+    if (!sid)
+        return mark;
+
+    collect();
+
+    MixedSound& sound = soundPool[*sid];
+    if (!makeResident(sound))
+        return mark;
+    sound.lastUse = worldTime();
+
+    I32 voice = soundMixer.play(sound.pcm.frames, sound.pcm.numFrames,
+                                sound.pcm.rate);
+    if (voice == -1) {
+        // Maybe there are too many sounds playing at once right now.
+        return mark;
+    }
+
+    sound.playing += 1;
+
+    int psid = playingSoundPool.allocate();
+    MixedPlayingSound ps;
+    ps.inUse = true;
+    ps.stopped = false;
+    ps.voice = voice;
+    playingSoundPool[psid] = ps;
+
+    voicePlayingSounds[voice] = psid;
+    voiceSounds[voice] = *sid;
+
+    return PlayingSoundID(psid);
+}
+
+void
+soundRelease(SoundID sid) noexcept {
+    if (!sid)
+        return;
+
+    MixedSound& sound = soundPool[*sid];
+
+    sound.numUsers -= 1;
+    assert_(sound.numUsers >= 0);
+
+    if (sound.numUsers == 0)
+        sound.lastUse = worldTime();
+}
+
+bool
+playingSoundIsPlaying(PlayingSoundID psid) noexcept {
+    if (!psid)
+        return false;
+
+    collect();
+
+    MixedPlayingSound ps = playingSoundPool[*psid];
+    return ps.voice != -1 && !ps.stopped;
+}
+
+void
+playingSoundStop(PlayingSoundID psid) noexcept {
+    if (!psid)
+        return;
+
+    MixedPlayingSound& ps = playingSoundPool[*psid];
+
+    if (ps.voice == -1 || ps.stopped)
+        return;
+    ps.stopped = true;
+
+    soundMixer.stop(ps.voice);
+}
+
+void
+playingSoundVolume(PlayingSoundID psid, float volume) noexcept {
+    if (!psid)
+        return;
+
+    MixedPlayingSound ps = playingSoundPool[*psid];
+
+    if (ps.voice != -1)
+        soundMixer.volume(ps.voice, volume);
+}
+
+void
+playingSoundSpeed(PlayingSoundID psid, float speed) noexcept {
+    if (!psid)
+        return;
+
+    MixedPlayingSound ps = playingSoundPool[*psid];
+
+    if (ps.voice != -1)
+        soundMixer.speed(ps.voice, speed);
+}
+
+void
+playingSoundRelease(PlayingSoundID psid) noexcept {
+    if (!psid)
+        return;
+
+    MixedPlayingSound& ps = playingSoundPool[*psid];
+
+    assert_(ps.inUse);
+    ps.inUse = false;
+
+    if (ps.voice == -1)
+        playingSoundPool.release(*psid);
+}
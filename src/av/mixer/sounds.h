@@ -0,0 +1,38 @@
+#ifndef SRC_AV_MIXER_SOUNDS_H_
+#define SRC_AV_MIXER_SOUNDS_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/mixer.h"
+#include "util/string-view.h"
+
+// Sounds played by the in-tree mixer. The handles, voices, and resident PCM
+// are kept in av/mixer/sounds.cpp. A backend decodes sounds and feeds
+// soundMixer's output to a device or a file with the functions below.
+
+// A sound decoded to interleaved 16-bit stereo frames.
+struct SoundPCM {
+    const I16* frames;
+    U32 numFrames;
+    U32 rate;
+
+    // The backend's own, for soundFree().
+    void* data;
+};
+
+extern Mixer soundMixer;
+
+// Open whatever sounds are mixed into and reset soundMixer to its rate.
+// Called before the first sound is loaded. Returns false if sounds are off.
+bool
+soundsOpen() noexcept;
+
+// Returns false if the sound could not be decoded. Errors are logged.
+bool
+soundDecode(StringView path, SoundPCM& pcm) noexcept;
+
+// Free a sound from soundDecode() that no voice is playing.
+void
+soundFree(SoundPCM& pcm) noexcept;
+
+#endif  // SRC_AV_MIXER_SOUNDS_H_
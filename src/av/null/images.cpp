@@ -19,6 +19,20 @@ imageDraw(Image image, float x, float y, float z) noexcept { }
 void
 imageRelease(Image image) noexcept { }
 
+bool
+imageReady(Image image) noexcept {
+    return true;
+}
+
+Image
+imageBake(U32 width, U32 height, const BakeItem* items, Size count) noexcept {
+    Image image = {0, 0, 0, 0, 0};
+    return image;
+}
+
+void
+imageBakeRelease(Image image) noexcept { }
+
 TiledImage
 tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
           U32 numWide) noexcept {
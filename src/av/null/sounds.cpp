@@ -1,32 +1,107 @@
 #include "tiles/sounds.h"
 
+#include "av/mixer/sounds.h"
+#include "os/io.h"
+#include "tiles/client-conf.h"
+#include "tiles/log.h"
+#include "tiles/resources.h"
 #include "util/compiler.h"
 #include "util/int.h"
+#include "util/mixer.h"
+#include "util/new.h"
 #include "util/string-view.h"
+#include "util/string.h"
+#include "util/wav.h"
 
-SoundID
-soundLoad(StringView path) noexcept {
-    return mark;
-}
-void
-soundsPrune(Time latestPermissibleUse) noexcept { }
+// Without an audio device, sounds are silent unless confSoundOutput names a
+// WAV file. Then they are decoded in-tree, mixed as world time passes, and
+// written there, so that audio can be checked without a device.
+
+#define RATE 44100
+
+static FileWriter* output = 0;
+static U32 outputFrames = 0;
+// Thousandths of a frame not yet mixed.
+static U32 outputRemainder = 0;
+
+bool
+soundsOpen() noexcept {
+    if (confSoundOutput.size == 0)
+        return false;
+
+    output = new FileWriter(confSoundOutput);
+    if (!*output) {
+        logErr("Sounds", String() << "Could not open " << confSoundOutput);
+        delete output;
+        output = 0;
+        return false;
+    }
 
-PlayingSoundID
-soundPlay(SoundID id) noexcept {
-    return mark;
+    soundMixer.reset(RATE);
+
+    U8 header[WAV_HEADER_SIZE];
+    encodeWavHeader(header, 0, RATE);
+    output->writeOffset(header, sizeof(header), 0);
+
+    return true;
 }
-void
-soundRelease(SoundID id) noexcept { }
 
 bool
-playingSoundIsPlaying(PlayingSoundID id) noexcept {
-    return false;
+soundDecode(StringView path, SoundPCM& pcm) noexcept {
+    String r;
+    if (!resourceLoad(path, r)) {
+        // Error logged.
+        return false;
+    }
+
+    const U8* data = reinterpret_cast<const U8*>(r.data);
+    if (!decodeWavSize(data, r.size, &pcm.numFrames, &pcm.rate)) {
+        logErr("Sounds", String() << path << ": not a 16-bit WAV file");
+        return false;
+    }
+
+    I16* frames = xmalloc(I16, pcm.numFrames * 2);
+    if (!decodeWav(data, r.size, frames)) {
+        free(frames);
+        return false;
+    }
+
+    pcm.frames = frames;
+    pcm.data = frames;
+    return true;
 }
+
 void
-playingSoundStop(PlayingSoundID id) noexcept { }
-void
-playingSoundVolume(PlayingSoundID id, float volume) noexcept { }
-void
-playingSoundSpeed(PlayingSoundID id, float speed) noexcept { }
+soundFree(SoundPCM& pcm) noexcept {
+    free(pcm.data);
+}
+
 void
-playingSoundRelease(PlayingSoundID id) noexcept { }
+soundsTick(Time dt) noexcept {
+    if (!output)
+        return;
+
+    static I16 block[MIXER_BLOCK * 2];
+
+    U32 thousandths = outputRemainder + static_cast<U32>(dt) * RATE;
+    U32 n = thousandths / 1000;
+    outputRemainder = thousandths % 1000;
+
+    while (n > 0) {
+        U32 count = n < MIXER_BLOCK ? n : MIXER_BLOCK;
+
+        for (U32 i = 0; i < count * 2; i++)
+            block[i] = 0;
+        soundMixer.mix(block, count);
+
+        output->writeOffset(block, count * 4,
+                            WAV_HEADER_SIZE + outputFrames * 4);
+        outputFrames += count;
+        n -= count;
+    }
+
+    // Keep the file whole in case this is the last tick.
+    U8 header[WAV_HEADER_SIZE];
+    encodeWavHeader(header, outputFrames, RATE);
+    output->writeOffset(header, sizeof(header), 0);
+}
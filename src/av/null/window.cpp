@@ -6,10 +6,15 @@
 #include "tiles/client-conf.h"
 #include "tiles/display-list.h"
 #include "tiles/log.h"
+#include "tiles/replay.h"
 #include "tiles/world.h"
+#include "util/allocations.h"
 #include "util/compiler.h"
+#include "util/int.h"
+#include "util/sort.h"
 #include "util/string-view.h"
 #include "util/string.h"
+#include "util/vector.h"
 
 void
 windowCreate(void) noexcept { }
@@ -19,6 +24,152 @@ windowTime(void) noexcept {
     return ns_to_ms(chronoNow());
 }
 
+struct BenchPhase {
+    StringView name;
+    Vector<Nanoseconds> times;
+};
+
+static void
+reportPhase(BenchPhase& phase) noexcept {
+    Vector<Nanoseconds>& times = phase.times;
+    sortA(times);
+
+    Size n = times.size;
+    float min = times[0] / 1000.0f;
+    float median = times[n / 2] / 1000.0f;
+    float p99 = times[n * 99 / 100] / 1000.0f;
+
+    logInfo("Bench", String() << phase.name << ": min " << min
+                              << " us, median " << median << " us, p99 "
+                              << p99 << " us");
+}
+
+// Run confBenchFrames frames as fast as possible, each advancing game time by
+// confBenchDt in fixed steps as a real frame would, pressing and releasing
+// keys as confBenchKeys says, then report how long each part of a frame took.
+static void
+runBench(void) noexcept {
+    DisplayList dl = {};
+
+    BenchPhase advance = {"advance", Vector<Nanoseconds>()};
+    BenchPhase needsRedraw = {"needsRedraw", Vector<Nanoseconds>()};
+    BenchPhase draw = {"draw", Vector<Nanoseconds>()};
+    Vector<Size> frameAllocations;
+
+    Size nextKey = 0;
+    Size frames = static_cast<Size>(confBenchFrames);
+    advance.times.reserve(frames);
+    needsRedraw.times.reserve(frames);
+    draw.times.reserve(frames);
+    frameAllocations.reserve(frames);
+
+    // Loading the world allocated, unless nothing is counted.
+    bool counting = allocationsCount() != 0;
+
+    for (I32 frame = 0; frame < confBenchFrames; frame++) {
+        while (nextKey < confBenchKeys.size &&
+               confBenchKeys[nextKey].frame <= frame) {
+            BenchKey& event = confBenchKeys[nextKey++];
+            if (event.down)
+                windowEmitKeyDown(event.key);
+            else
+                windowEmitKeyUp(event.key);
+        }
+
+        Size allocationsBefore = allocationsCount();
+
+        Nanoseconds start = chronoNow();
+        worldAdvance(static_cast<Nanoseconds>(confBenchDt) * 1000000);
+        Nanoseconds advanced = chronoNow();
+        bool redraw = worldNeedsRedraw();
+        Nanoseconds checked = chronoNow();
+
+        advance.times.push(advanced - start);
+        needsRedraw.times.push(checked - advanced);
+
+        if (redraw) {
+            worldDraw(&dl);
+            draw.times.push(chronoNow() - checked);
+
+            dl.items.clear();
+            dl.damage.clear();
+        }
+
+        if (counting)
+            frameAllocations.push(allocationsCount() - allocationsBefore);
+    }
+
+    logInfo("Bench", String() << confBenchFrames << " frames of "
+                              << confBenchDt << " ms, " << draw.times.size
+                              << " drawn");
+
+    reportPhase(advance);
+    reportPhase(needsRedraw);
+    if (draw.times.size)
+        reportPhase(draw);
+
+    if (frameAllocations.size) {
+        sortA(frameAllocations);
+
+        Size n = frameAllocations.size;
+        Size total = 0;
+        for (Size i = 0; i < n; i++)
+            total += frameAllocations[i];
+
+        logInfo("Bench", String() << "allocations per frame: min "
+                                  << frameAllocations[0] << ", median "
+                                  << frameAllocations[n / 2] << ", p99 "
+                                  << frameAllocations[n * 99 / 100]
+                                  << ", total " << total);
+    }
+
+    exitProcess(0);
+}
+
+// Replay confReplayPlay as fast as possible, checking that each step leaves
+// the game as it was when recorded, then report how long each part of a step
+// took. Exits with 1 if the game strayed from the recording.
+static void
+runReplay(void) noexcept {
+    DisplayList dl = {};
+
+    BenchPhase advance = {"advance", Vector<Nanoseconds>()};
+    BenchPhase draw = {"draw", Vector<Nanoseconds>()};
+
+    ReplayStep step;
+    while (replayNext(step)) {
+        Nanoseconds start = chronoNow();
+        if (step.tick)
+            worldTick(step.dt);
+        else
+            worldAdvance(step.elapsed);
+        Nanoseconds advanced = chronoNow();
+
+        advance.times.push(advanced - start);
+
+        replayCheck();
+
+        if (worldNeedsRedraw()) {
+            Nanoseconds drawStart = chronoNow();
+            worldDraw(&dl);
+            draw.times.push(chronoNow() - drawStart);
+
+            dl.items.clear();
+            dl.damage.clear();
+        }
+    }
+
+    logInfo("Bench", String() << advance.times.size << " steps replayed, "
+                              << draw.times.size << " drawn");
+
+    if (advance.times.size)
+        reportPhase(advance);
+    if (draw.times.size)
+        reportPhase(draw);
+
+    exitProcess(replayInStep() ? 0 : 1);
+}
+
 I32
 windowWidth(void) noexcept {
     return confWindowSize.x;
@@ -34,6 +185,11 @@ windowSetCaption(StringView) noexcept { }
 
 void
 windowMainLoop(void) noexcept {
+    if (replaying())
+        runReplay();
+    if (confBenchFrames)
+        runBench();
+
     DisplayList dl = {};
 
     const Nanoseconds idealFrameTime = s_to_ns(1) / 60;
@@ -64,9 +220,7 @@ windowMainLoop(void) noexcept {
         //
         // Simulate world and draw frame.
         //
-        Time dt = ns_to_ms(frameStart - previousFrameStart);
-
-        worldTick(dt);
+        worldAdvance(frameStart - previousFrameStart);
 
         if (worldNeedsRedraw()) {
             worldDraw(&dl);
@@ -75,6 +229,7 @@ windowMainLoop(void) noexcept {
             // audio/video backend.
 
             dl.items.clear();
+            dl.damage.clear();
         }
 
         Nanoseconds frameEnd = chronoNow();
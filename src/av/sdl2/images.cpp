@@ -3,24 +3,49 @@
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
 #include "av/sdl2/window.h"
+#include "tiles/client-conf.h"
 #include "tiles/log.h"
 #include "tiles/resources.h"
+#include "tiles/world.h"
 #include "util/assert.h"
+#include "util/atlas.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
+#include "util/image-decode.h"
 #include "util/int.h"
 #include "util/measure.h"
 #include "util/string-view.h"
 #include "util/string.h"
-
-#define ATLAS_WIDTH  2048
-#define ATLAS_HEIGHT 512
+#include "util/vector.h"
 
 static SDL_Renderer* renderer = 0;
-static SDL_Texture* atlas = 0;
-static U32 atlasUsed = 0;
 
-static HashVector<TiledImage> images;
+// Images drawn since the last flush, all from one texture, to be submitted
+// with a single SDL_RenderGeometry().
+static SDL_Texture* batchTexture = 0;
+static float batchWidth = 0;
+static float batchHeight = 0;
+static Vector<SDL_Vertex> batchVertices;
+
+// Two triangles for each quad in batchVertices. Grows as needed.
+static Vector<int> quadIndices;
+
+// Pixels of the image being loaded, on their way into an atlas page.
+static Vector<U32> staging;
+
+// Frames are drawn into the canvas and then copied to the window, so that a
+// frame can redraw only the parts that changed and keep the rest. The
+// window's own contents are undefined after SDL_RenderPresent(). Zero if the
+// renderer cannot draw to textures.
+static SDL_Texture* canvas = 0;
+static int canvasWidth = 0;
+static int canvasHeight = 0;
+static bool canvasFailed = false;
+// Whether the canvas holds the previous frame.
+static bool canvasKept = false;
+
+// The part of the canvas being redrawn, if any.
+static SDL_Rect region;
+static bool inRegion = false;
 
 void
 imageInit() noexcept {
@@ -53,17 +78,116 @@ imageInit() noexcept {
     //SDL_RenderPresent(renderer);
 }
 
+// Make the canvas the size of the window. Returns false if there is no canvas.
+static bool
+sizeCanvas() noexcept {
+    if (canvasFailed)
+        return false;
+
+    int width;
+    int height;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    if (canvas && width == canvasWidth && height == canvasHeight)
+        return true;
+
+    if (canvas)
+        SDL_DestroyTexture(canvas);
+    canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                               SDL_TEXTUREACCESS_TARGET, width, height);
+    canvasWidth = width;
+    canvasHeight = height;
+    canvasKept = false;
+
+    if (canvas == 0) {
+        logErr("SDL2", "Cannot draw to a canvas, every frame will be drawn in "
+                       "full");
+        canvasFailed = true;
+        return false;
+    }
+
+    SDL_SetTextureBlendMode(canvas, SDL_BLENDMODE_NONE);
+    return true;
+}
+
+bool
+imagesNeedRedraw() noexcept {
+    return false;
+}
+
+// Atlas pages are written as images load, on the main thread.
 void
-imageStartFrame() noexcept {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+imagesPublish() noexcept { }
+
+// An SDL_Renderer can only be used on the thread that made it.
+bool
+imagesDetachThread() noexcept {
+    return false;
+}
+
+void
+imagesAttachThread() noexcept { }
+
+bool
+imageStartFrame(bool keep) noexcept {
+    SDL_SetRenderTarget(renderer, sizeCanvas() ? canvas : 0);
+
+    keep = keep && canvasKept;
+    canvasKept = canvas != 0;
+
+    if (!keep) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+    }
+
+    return keep;
 }
 
 void
 imageEndFrame() noexcept {
+    imageFlushImages();
+
+    if (canvas) {
+        SDL_SetRenderTarget(renderer, 0);
+        SDL_RenderCopy(renderer, canvas, 0, 0);
+    }
+
     SDL_RenderPresent(renderer);
 }
 
+// Go back to drawing the frame after drawing to an atlas page, which can
+// happen in the middle of a frame. Changing the target resets the clip
+// rectangle.
+static void
+restoreTarget() noexcept {
+    SDL_SetRenderTarget(renderer, canvas);
+    if (inRegion)
+        SDL_RenderSetClipRect(renderer, &region);
+}
+
+void
+imageBeginRegion(I32 x, I32 y, I32 width, I32 height) noexcept {
+    imageFlushImages();
+
+    region.x = x;
+    region.y = y;
+    region.w = width;
+    region.h = height;
+    inRegion = true;
+
+    SDL_RenderSetClipRect(renderer, &region);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_RenderFillRect(renderer, &region);
+}
+
+void
+imageEndRegion() noexcept {
+    imageFlushImages();
+
+    inRegion = false;
+    SDL_RenderSetClipRect(renderer, 0);
+}
+
 void
 imageDrawRect(float left, float right, float top, float bottom, float z,
               U32 argb) noexcept {
@@ -72,6 +196,9 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
     U8 g = static_cast<U8>((argb >> 8) & 0xFF);
     U8 b = static_cast<U8>((argb >> 0) & 0xFF);
 
+    // Draw in the order we were asked to.
+    imageFlushImages();
+
     SDL_Rect rect = {static_cast<int>(left), static_cast<int>(top),
                      static_cast<int>(right - left),
                      static_cast<int>(bottom - top)};
@@ -81,111 +208,139 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
     SDL_RenderFillRect(renderer, &rect);
 }
 
+static void*
+makePage(U32 width, U32 height) noexcept {
+    logInfo("SDL2", String() << "Adding " << width << "x" << height
+                             << " atlas page");
+
+    SDL_Texture* texture = SDL_CreateTexture(
+        renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+        static_cast<int>(width), static_cast<int>(height));
+    if (texture == 0)
+        logFatal("SDL2", "Failed to create texture");
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 0);
+    SDL_RenderClear(renderer);
+    restoreTarget();
+
+    return texture;
+}
+
 static void
-initAtlas() noexcept {
-    if (atlas == 0) {
-        atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
-                                  SDL_TEXTUREACCESS_TARGET, ATLAS_WIDTH,
-                                  ATLAS_HEIGHT);
-        if (atlas == 0)
-            logFatal("SDL2", "Failed to create texture");
-
-        SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
-
-        SDL_SetRenderTarget(renderer, atlas);
-        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 0);
-        SDL_RenderClear(renderer);
-        SDL_SetRenderTarget(renderer, 0);
+destroyPage(void* texture) noexcept {
+    if (texture == batchTexture) {
+        imageFlushImages();
+        batchTexture = 0;
     }
+
+    SDL_DestroyTexture(static_cast<SDL_Texture*>(texture));
 }
 
-static TiledImage*
-load(StringView path) noexcept {
-    TiledImage& tiles = images.allocate(hash_(path));
-    Image& image = tiles.image;
-    image.texture = 0;
-    image.x = image.y = image.width = image.height = 0;
-    tiles.tileWidth = tiles.tileHeight = tiles.numTiles = 0;
+static void
+evicted(StringView path, const AtlasImage&, AtlasPage&) noexcept {
+    logInfo("SDL2", String() << "Evicted " << path << " from the atlas");
+}
+
+static const AtlasHooks atlasHooks = {makePage, destroyPage, evicted};
+
+static Atlas atlas(atlasHooks);
+
+static Image
+imageOf(const AtlasImage& entry) noexcept {
+    Image image = {entry.texture, entry.x, entry.y, entry.width, entry.height};
+    return image;
+}
 
+// Make an image resident. Returns false if it could not be loaded.
+static bool
+load(StringView path, AtlasImage& entry) noexcept {
     String r;
     if (!resourceLoad(path, r)) {
         // Error logged.
-        return 0;
+        return false;
     }
 
-    SDL_RWops* ops =
-        SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                      static_cast<int>(r.size));
-
-    int x = atlasUsed;
-    int y = 0;
-    int width;
-    int height;
+    U32 width;
+    U32 height;
 
     {
         TimeMeasure m(String() << "Constructed " << path << " as image");
 
-        //SDL_Surface* surface = IMG_Load_RW(ops, 1);
-        SDL_Surface* surface = SDL_LoadBMP_RW(ops, 1);
-        if (!surface) {
+        const U8* bytes = reinterpret_cast<const U8*>(r.data);
+        if (!decodeImageSize(bytes, r.size, &width, &height)) {
             logFatal("SDL2", String() << "Invalid image: " << path);
-            return 0;
+            return false;
         }
 
-        width = surface->w;
-        height = surface->h;
-
-        initAtlas();
+        Size count = static_cast<Size>(width) * height;
+        if (staging.size < count)
+            staging.resize(count);
 
-        // Rectangle packing algorithm:
-        //
-        // Copy surface into the atlas to the right of the previous image,
-        // or at the left edge, if there was no previous image.
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_FreeSurface(surface);
+        if (!decodeImage(bytes, r.size, staging.data, width, PIXELS_ABGR)) {
+            logFatal("SDL2", String() << "Invalid image: " << path);
+            return false;
+        }
 
-        if (!texture) {
-            logFatal("SDL2", String() << "Failed to create texture: " << path);
-            return 0;
+        Size budget = static_cast<Size>(confTextureBudget) << 20;
+        if (!atlas.place(entry, width, height, budget, worldTime()))
+            logInfo("SDL2", "Texture budget exceeded by images in use");
+
+        // Copy the pixels straight into the atlas texture.
+        SDL_Rect dst = {static_cast<int>(entry.x), static_cast<int>(entry.y),
+                        static_cast<int>(width), static_cast<int>(height)};
+        if (SDL_UpdateTexture(static_cast<SDL_Texture*>(entry.texture), &dst,
+                              staging.data,
+                              static_cast<int>(width * 4)) != 0) {
+            logFatal("SDL2", String() << "Failed to update texture: " << path);
+            return false;
         }
+    }
 
-        // Copy this texture's data into the atlas texture.
-        SDL_Rect src = {0, 0, width, height};
-        SDL_Rect dst = {x, y, width, height};
+    return true;
+}
 
-        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+Image
+imageLoad(StringView path) noexcept {
+    AtlasImage& entry = atlas.image(path);
 
-        SDL_SetRenderTarget(renderer, atlas);
-        SDL_RenderCopy(renderer, texture, &src, &dst);
-        SDL_SetRenderTarget(renderer, 0);
+    if (entry.texture == 0 && !load(path, entry))
+        return imageOf(entry);
 
-        // Done with this texture.
-        SDL_DestroyTexture(texture);
-    }
+    entry.numUsers += 1;
+    return imageOf(entry);
+}
 
-    image.texture = atlas;
-    image.x = static_cast<U32>(x);
-    image.y = static_cast<U32>(y);
-    image.width = static_cast<U32>(width);
-    image.height = static_cast<U32>(height);
+void
+imageRelease(Image image) noexcept {
+    if (!IMAGE_VALID(image))
+        return;
 
-    atlasUsed += static_cast<U32>(width);
+    AtlasImage* entry = atlas.find(image.texture, image.x, image.y);
+    assert_(entry);
 
-    return &tiles;
-}
+    entry->numUsers -= 1;
+    assert_(entry->numUsers >= 0);
 
-Image
-imageLoad(StringView path) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    if (entry->numUsers == 0)
+        entry->lastUse = worldTime();
+}
 
-    if (!tiles)
-        tiles = load(path);
+bool
+imageReady(Image image) noexcept {
+    return true;
+}
 
-    return tiles->image;
+Image
+imageBake(U32 width, U32 height, const BakeItem* items, Size count) noexcept {
+    Image image = {0, 0, 0, 0, 0};
+    return image;
 }
 
 void
-imageRelease(Image image) noexcept { }
+imageBakeRelease(Image image) noexcept { }
 
 void
 imageDraw(Image image, float x, float y, float z) noexcept {
@@ -195,41 +350,70 @@ imageDraw(Image image, float x, float y, float z) noexcept {
     fvec2 scaling = sdl2Scaling;
 
     SDL_Texture* texture = static_cast<SDL_Texture*>(image.texture);
-    SDL_Rect src;
-    src.x = static_cast<int>(image.x);
-    src.y = static_cast<int>(image.y);
-    src.w = static_cast<int>(image.width);
-    src.h = static_cast<int>(image.height);
-    SDL_Rect dst;
-    dst.x = static_cast<int>((x + translation.x) * scaling.x);
-    dst.y = static_cast<int>((y + translation.y) * scaling.y);
-    dst.w = static_cast<int>(image.width * scaling.x);
-    dst.h = static_cast<int>(image.height * scaling.y);
-    SDL_SetRenderTarget(renderer, 0);
-    SDL_RenderCopy(renderer, texture, &src, &dst);
+    if (texture != batchTexture) {
+        imageFlushImages();
+
+        AtlasPage* page = atlas.findPage(texture);
+        assert_(page);
+
+        batchTexture = texture;
+        batchWidth = static_cast<float>(page->packer.width);
+        batchHeight = static_cast<float>(page->packer.height);
+    }
+
+    // Snap to whole pixels, as SDL_RenderCopy() would.
+    float left = static_cast<float>(static_cast<int>((x + translation.x) *
+                                                     scaling.x));
+    float top = static_cast<float>(static_cast<int>((y + translation.y) *
+                                                    scaling.y));
+    float right = left + static_cast<int>(image.width * scaling.x);
+    float bottom = top + static_cast<int>(image.height * scaling.y);
+
+    float uLeft = image.x / batchWidth;
+    float uRight = (image.x + image.width) / batchWidth;
+    float vTop = image.y / batchHeight;
+    float vBottom = (image.y + image.height) / batchHeight;
+
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Vertex quad[4] = {
+        {{left, top}, white, {uLeft, vTop}},
+        {{right, top}, white, {uRight, vTop}},
+        {{left, bottom}, white, {uLeft, vBottom}},
+        {{right, bottom}, white, {uRight, vBottom}},
+    };
+    for (Size i = 0; i < 4; i++)
+        batchVertices.push(quad[i]);
 }
 
 TiledImage
 tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
           U32 numHigh) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    AtlasImage& entry = atlas.image(path);
 
-    if (!tiles) {
-        tiles = load(path);
+    TiledImage tiles;
+    tiles.tileWidth = tileWidth;
+    tiles.tileHeight = tileHeight;
+    tiles.numTiles = numAcross * numHigh;
 
-        assert_(tiles->image.width == tileWidth * numAcross);
-        assert_(tiles->image.height == tileHeight * numHigh);
+    if (entry.texture == 0) {
+        if (!load(path, entry)) {
+            tiles.image = imageOf(entry);
+            return tiles;
+        }
 
-        tiles->tileWidth = tileWidth;
-        tiles->tileHeight = tileHeight;
-        tiles->numTiles = numAcross * numHigh;
+        assert_(entry.width == tileWidth * numAcross);
+        assert_(entry.height == tileHeight * numHigh);
     }
 
-    return *tiles;
+    entry.numUsers += 1;
+    tiles.image = imageOf(entry);
+    return tiles;
 }
 
 void
-tilesRelease(TiledImage tiles) noexcept { }
+tilesRelease(TiledImage tiles) noexcept {
+    imageRelease(tiles.image);
+}
 
 Image
 tileAt(TiledImage tiles, U32 index) noexcept {
@@ -247,10 +431,31 @@ tileAt(TiledImage tiles, U32 index) noexcept {
 }
 
 void
-imagesPrune(Time latestPermissibleUse) noexcept { }
+imagesPrune(Time latestPermissibleUse) noexcept {
+    atlas.prune(latestPermissibleUse);
+}
 
 void
-imageFlushImages() noexcept { }
+imageFlushImages() noexcept {
+    Size numVertices = batchVertices.size;
+    if (numVertices == 0)
+        return;
+
+    Size numIndices = numVertices / 4 * 6;
+    while (quadIndices.size < numIndices) {
+        int first = static_cast<int>(quadIndices.size / 6 * 4);
+        int quad[6] = {first, first + 1, first + 2,
+                       first + 1, first + 3, first + 2};
+        for (Size i = 0; i < 6; i++)
+            quadIndices.push(quad[i]);
+    }
+
+    SDL_RenderGeometry(renderer, batchTexture, batchVertices.data,
+                       static_cast<int>(numVertices), quadIndices.data,
+                       static_cast<int>(numIndices));
+
+    batchVertices.clear();
+}
 
 void
 imageFlushRects() noexcept { }
@@ -1,41 +1,249 @@
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
+#include "os/c.h"
+#include "os/condition-variable.h"
+#include "os/mutex.h"
 #include "tiles/music-worker.h"
 #include "tiles/resources.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
+#include "util/function.h"
+#include "util/hash.h"
 #include "util/int.h"
+#include "util/jobs.h"
+#include "util/math2.h"
 #include "util/measure.h"
 #include "util/string-view.h"
 #include "util/string.h"
 
-struct Song {
-    // The Mix_Music needs the music data to be kept around for its lifetime.
-    String fileContent;
+// Bytes of a song kept in memory while it plays.
+#define STREAM_SIZE (256 * 1024)
 
-    Mix_Music* mix;
+// A song read from the world's data a piece at a time. SDL2_mixer reads it
+// through an SDL_RWops, on the audio thread while it plays, and a job reads
+// ahead into a ring buffer once half of it has been used.
+struct Stream {
+    Resource resource;
+
+    // Owned by the reader.
+    U32 position;
+
+    Mutex mutex;
+    ConditionVariable filled;
+
+    // Guarded by mutex. Bytes [start, end) of the song are in the ring, byte
+    // i at ring[i % STREAM_SIZE].
+    U32 start;
+    U32 end;
+    bool filling;  // A job is reading into the ring.
+    bool failed;
+    bool closed;  // Whether the job should free the stream when it is done.
+
+    U8 ring[STREAM_SIZE];
 };
 
-static bool initalized = false;
-static int paused = 0;
-static HashVector<Song> songs;
-static U32 songHash = 0;
-static Song* song = 0;
+static void
+fill(void* data) noexcept {
+    Stream* s = static_cast<Stream*>(data);
+
+    U32 from;
+    U32 count;
+    {
+        LockGuard lock(s->mutex);
+        from = s->end;
+        count = min(s->start + STREAM_SIZE, s->resource.size) - from;
+        // Up to the end of the ring. The rest is read next time.
+        count = min(count, STREAM_SIZE - from % STREAM_SIZE);
+    }
 
-static Song*
-load(StringView path) noexcept {
-    Song& newSong = songs.allocate(hash_(path));
-    newSong.mix = 0;
+    // The reader does not look past end, so the ring can be written to
+    // without the lock.
+    bool ok = resourceRead(s->resource, s->ring + from % STREAM_SIZE, from,
+                           count);
+
+    bool closed;
+    {
+        LockGuard lock(s->mutex);
+        if (ok)
+            s->end += count;
+        else
+            s->failed = true;
+        s->filling = false;
+        closed = s->closed;
+        s->filled.notifyAll();
+    }
+
+    if (closed)
+        delete s;
+}
+
+// Call with the mutex held.
+static void
+startFill(Stream* s) noexcept {
+    s->filling = true;
+    Function fn = {fill, s};
+    JobsEnqueue(fn);
+}
+
+static I64
+streamSize(SDL_RWops* ops) noexcept {
+    Stream* s = static_cast<Stream*>(ops->hidden.unknown.data1);
+    return s->resource.size;
+}
+
+static I64
+streamSeek(SDL_RWops* ops, I64 offset, int whence) noexcept {
+    Stream* s = static_cast<Stream*>(ops->hidden.unknown.data1);
+
+    I64 base = 0;
+    if (whence == RW_SEEK_CUR)
+        base = s->position;
+    else if (whence == RW_SEEK_END)
+        base = s->resource.size;
+
+    I64 position = base + offset;
+    if (position < 0 || position > s->resource.size)
+        return -1;
+
+    s->position = static_cast<U32>(position);
+    return position;
+}
+
+static Size
+streamRead(SDL_RWops* ops, void* ptr, Size size, Size maxnum) noexcept {
+    Stream* s = static_cast<Stream*>(ops->hidden.unknown.data1);
+    if (size == 0)
+        return 0;
+
+    U8* out = static_cast<U8*>(ptr);
+    U32 want = static_cast<U32>(min(size * maxnum,
+                                    static_cast<Size>(s->resource.size -
+                                                      s->position)));
+    U32 done = 0;
+
+    LockGuard lock(s->mutex);
+
+    if (s->position < s->start || s->position > s->end) {
+        // Seeked away from what is in the ring.
+        while (s->filling)
+            s->filled.wait(lock);
+        s->start = s->position;
+        s->end = s->position;
+        s->failed = false;
+    }
+
+    while (done < want) {
+        if (s->position == s->end) {
+            if (s->failed)
+                break;
+            s->start = s->position;
+            if (!s->filling)
+                startFill(s);
+            s->filled.wait(lock);
+            continue;
+        }
+
+        U32 offset = s->position % STREAM_SIZE;
+        U32 n = min(min(want - done, s->end - s->position),
+                    STREAM_SIZE - offset);
+        memcpy(out + done, s->ring + offset, n);
+        s->position += n;
+        done += n;
+    }
+
+    s->start = s->position;
+
+    if (!s->filling && s->end < s->resource.size &&
+        s->end - s->position < STREAM_SIZE / 2)
+        startFill(s);
+
+    return done / size;
+}
+
+static Size
+streamWrite(SDL_RWops*, const void*, Size, Size) noexcept {
+    return 0;
+}
+
+static int
+streamClose(SDL_RWops* ops) noexcept {
+    Stream* s = static_cast<Stream*>(ops->hidden.unknown.data1);
+
+    bool filling;
+    {
+        LockGuard lock(s->mutex);
+        filling = s->filling;
+        s->closed = true;
+    }
+
+    // Otherwise the job frees it.
+    if (!filling)
+        delete s;
+
+    SDL_FreeRW(ops);
+    return 0;
+}
 
-    String r;
-    if (!resourceLoad(path, r)) {
+static SDL_RWops*
+openStream(StringView path) noexcept {
+    Resource resource;
+    if (!resourceFind(path, resource)) {
         // Error logged.
         return 0;
     }
 
-    SDL_RWops* ops =
-        SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                      static_cast<int>(r.size));
+    SDL_RWops* ops = SDL_AllocRW();
+    if (!ops) {
+        sdlError("SDL2Music", "SDL_AllocRW");
+        return 0;
+    }
+
+    Stream* s = new Stream;
+    s->resource = resource;
+    s->position = 0;
+    s->start = 0;
+    s->end = 0;
+    s->failed = false;
+    s->closed = false;
+
+    {
+        LockGuard lock(s->mutex);
+        startFill(s);
+    }
+
+    ops->size = streamSize;
+    ops->seek = streamSeek;
+    ops->read = streamRead;
+    ops->write = streamWrite;
+    ops->close = streamClose;
+    ops->type = 0;  // SDL_RWOPS_UNKNOWN
+    ops->hidden.unknown.data1 = s;
+
+    return ops;
+}
+
+static bool initalized = false;
+static int paused = 0;
+static U32 songHash = 0;
+static Mix_Music* song = 0;
+
+// Only the song playing is kept. Its stream is closed with it.
+static void
+freeSong() noexcept {
+    if (!song)
+        return;
+
+    Mix_HaltMusic();
+    Mix_FreeMusic(song);
+
+    songHash = 0;
+    song = 0;
+}
+
+static Mix_Music*
+load(StringView path) noexcept {
+    SDL_RWops* ops = openStream(path);
+    if (!ops)
+        return 0;
 
     TimeMeasure m(String() << "Constructed " << path << " as music");
     Mix_Music* mix = Mix_LoadMUS_RW(ops, 1);
@@ -45,11 +253,7 @@ load(StringView path) noexcept {
         return 0;
     }
 
-    // We need to keep the memory around, so put it in a struct.
-    newSong.fileContent = static_cast<String&&>(r);
-    newSong.mix = mix;
-
-    return &newSong;
+    return mix;
 }
 
 static void
@@ -90,29 +294,19 @@ musicWorkerPlay(StringView path) noexcept {
 
     paused = 0;
 
-    if (song && !Mix_PausedMusic())
-        Mix_HaltMusic();
+    freeSong();
 
-    if (path.size == 0) {
-        songHash = 0;
-        song = 0;
+    if (path.size == 0)
         return;
-    }
 
-    song = songs.find(hash_(path));
+    song = load(path);
     if (!song)
-        song = load(path);
-    if (!song || !song->mix) {
-        songHash = 0;
-        song = 0;
         return;
-    }
 
     songHash = pathHash;
-    song = song;
 
     TimeMeasure m(String() << "Playing " << path);
-    Mix_PlayMusic(song->mix, -1);
+    Mix_PlayMusic(song, -1);
 }
 
 void
@@ -121,11 +315,7 @@ musicWorkerStop() noexcept {
 
     paused = 0;
 
-    if (song) {
-        songHash = 0;
-        song = 0;
-        Mix_HaltMusic();
-    }
+    freeSong();
 }
 
 void
@@ -82,16 +82,44 @@ SDL_Metal_GetLayer(void*) noexcept;
 #define SDL_PIXELFORMAT_RGBA8888 373694468
 #define SDL_PIXELFORMAT_ABGR8888 376840196
 #define SDL_PIXELFORMAT_RGBA32   SDL_PIXELFORMAT_ABGR8888  // When little endian
+typedef struct {
+    U8 r, g, b, a;
+} SDL_Color;
 
 // SDL_rect.h
+typedef struct {
+    float x, y;
+} SDL_FPoint;
 typedef struct {
     int x, y, w, h;
 } SDL_Rect;
 
 // SDL_rwops.h
-typedef struct SDL_RWops SDL_RWops;
+typedef struct SDL_RWops {
+    I64 (*size)(struct SDL_RWops*);
+    I64 (*seek)(struct SDL_RWops*, I64, int);
+    Size (*read)(struct SDL_RWops*, void*, Size, Size);
+    Size (*write)(struct SDL_RWops*, const void*, Size, Size);
+    int (*close)(struct SDL_RWops*);
+    U32 type;
+    // Only the member we use of a larger union. SDL_AllocRW() allocates the
+    // whole thing.
+    union {
+        struct {
+            void* data1;
+            void* data2;
+        } unknown;
+    } hidden;
+} SDL_RWops;
+SDL_RWops*
+SDL_AllocRW() noexcept;
+void
+SDL_FreeRW(SDL_RWops*) noexcept;
 SDL_RWops*
 SDL_RWFromMem(void*, int) noexcept;
+#define RW_SEEK_SET 0
+#define RW_SEEK_CUR 1
+#define RW_SEEK_END 2
 
 // SDL_surface.h
 struct SDL_Surface {
@@ -106,6 +134,10 @@ SDL_FreeSurface(SDL_Surface*) noexcept;
 SDL_Surface*
 SDL_LoadBMP_RW(SDL_RWops*, int) noexcept;
 
+// SDL_timer.h
+U32
+SDL_GetTicks(void) noexcept;
+
 // SDL_video.h
 typedef struct SDL_Window SDL_Window;
 typedef struct {
@@ -132,8 +164,12 @@ void
 SDL_ShowWindow(SDL_Window*) noexcept;
 void*
 SDL_GL_GetProcAddress(const char*) noexcept;
+int
+SDL_GL_ExtensionSupported(const char*) noexcept;
 SDL_GLContext
 SDL_GL_CreateContext(SDL_Window*) noexcept;
+int
+SDL_GL_MakeCurrent(SDL_Window*, SDL_GLContext) noexcept;
 void
 SDL_GL_SwapWindow(SDL_Window*) noexcept;
 #define SDL_WINDOW_FULLSCREEN              0x00000001
@@ -147,6 +183,11 @@ SDL_GL_SwapWindow(SDL_Window*) noexcept;
 // SDL_render.h
 typedef struct SDL_Renderer SDL_Renderer;
 typedef struct SDL_Texture SDL_Texture;
+typedef struct {
+    SDL_FPoint position;
+    SDL_Color color;
+    SDL_FPoint tex_coord;
+} SDL_Vertex;
 typedef struct SDL_RendererInfo {
     const char* name;
     U32 flags;
@@ -166,21 +207,30 @@ SDL_DestroyTexture(SDL_Texture*) noexcept;
 int
 SDL_GetRendererInfo(SDL_Renderer*, SDL_RendererInfo*) noexcept;
 int
+SDL_GetRendererOutputSize(SDL_Renderer*, int*, int*) noexcept;
+int
 SDL_QueryTexture(SDL_Texture*, U32*, int*, int*, int*) noexcept;
 int
 SDL_SetRenderTarget(SDL_Renderer*, SDL_Texture*) noexcept;
 int
 SDL_SetTextureBlendMode(SDL_Texture*, SDL_BlendMode) noexcept;
 int
+SDL_UpdateTexture(SDL_Texture*, const SDL_Rect*, const void*, int) noexcept;
+int
 SDL_RenderClear(SDL_Renderer*) noexcept;
 int
 SDL_RenderCopy(SDL_Renderer*, SDL_Texture*, const SDL_Rect*,
                const SDL_Rect*) noexcept;
 int
 SDL_RenderFillRect(SDL_Renderer*, const SDL_Rect*) noexcept;
+int
+SDL_RenderGeometry(SDL_Renderer*, SDL_Texture*, const SDL_Vertex*, int,
+                   const int*, int) noexcept;  // Since 2.0.18.
 void
 SDL_RenderPresent(SDL_Renderer*) noexcept;
 int
+SDL_RenderSetClipRect(SDL_Renderer*, const SDL_Rect*) noexcept;
+int
 SDL_SetRenderDrawBlendMode(SDL_Renderer*, SDL_BlendMode) noexcept;
 int
 SDL_SetRenderDrawColor(SDL_Renderer*, U8, U8, U8, U8) noexcept;
@@ -196,7 +246,12 @@ IMG_Load_RW(SDL_RWops*, int) noexcept;
 
 // SDL_mixer library
 // SDL_mixer.h
-typedef struct Mix_Chunk Mix_Chunk;
+typedef struct Mix_Chunk {
+    int allocated;
+    U8* abuf;
+    U32 alen;
+    U8 volume;
+} Mix_Chunk;
 typedef struct Mix_Music Mix_Music;
 int
 Mix_AllocateChannels(int) noexcept;
@@ -228,12 +283,16 @@ int
 Mix_PlayChannelTimed(int, Mix_Chunk*, int, int) noexcept;
 int
 Mix_PlayMusic(Mix_Music*, int) noexcept;
+int
+Mix_QuerySpec(int*, U16*, int*) noexcept;
 void
 Mix_Resume(int) noexcept;
 void
 Mix_ResumeMusic() noexcept;
 int
 Mix_SetPosition(int, I16, U8) noexcept;
+void
+Mix_SetPostMix(void (*)(void*, U8*, int), void*) noexcept;
 int
 Mix_Volume(int, int) noexcept;
 int
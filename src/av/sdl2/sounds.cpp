@@ -1,67 +1,26 @@
 #include "tiles/sounds.h"
 
+#include "av/mixer/sounds.h"
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
-#include "os/mutex.h"
+#include "tiles/log.h"
 #include "tiles/resources.h"
-#include "tiles/world.h"
 #include "util/compiler.h"
-#include "util/hashtable.h"
 #include "util/int.h"
-#include "util/markable.h"
 #include "util/measure.h"
-#include "util/pool.h"
-#include "util/vector.h"
-
-struct SDL2Sound {
-    int numUsers;
-    Time lastUse;
-
-    String frames;     // Audio frames.
-    Mix_Chunk* chunk;  // Decoding configuration.
-};
-
-static bool
-operator==(SDL2Sound a, SDL2Sound b) noexcept {
-    return a.numUsers == b.numUsers && a.lastUse == b.lastUse &&
-           a.frames == b.frames && a.chunk == b.chunk;
-}
-
-struct SDL2PlayingSound {
-    bool playing;
-    bool inUse;
-
-    int channel;
-};
-
-static Hashmap<String, SoundID> soundIDs;
-static Pool<SDL2Sound> soundPool;
-static Pool<SDL2PlayingSound> playingSoundPool;
-
-// Map from SDL2 channel to PlayingSoundID for SDL2_mixer callbacks.
-static Vector<int> playingChannels;
-
-static Mutex channelMutex;
+#include "util/mixer.h"
+#include "util/string-view.h"
+#include "util/string.h"
 
+// Sounds are mixed by our own mixer, on SDL2's audio thread, after SDL2_mixer
+// has mixed the music.
 static void
-channelFinished(int channel) noexcept {
-    LockGuard guard(channelMutex);
-
-    int psid = playingChannels[channel];
-    SDL2PlayingSound& ps = playingSoundPool[psid];
-    ps.playing = false;
-    if (!ps.inUse)
-        playingSoundPool.release(psid);
+postMix(void*, U8* stream, int len) noexcept {
+    soundMixer.mix(reinterpret_cast<I16*>(stream), static_cast<U32>(len) / 4);
 }
 
-static void
-init() noexcept {
-    static bool initialized = false;
-
-    if (initialized)
-        return;
-    initialized = true;
-
+bool
+soundsOpen() noexcept {
     if (SDL_WasInit(SDL_INIT_AUDIO) == 0) {
         {
             TimeMeasure m("Initialized the SDL2 audio subsystem");
@@ -76,17 +35,29 @@ init() noexcept {
         }
     }
 
-    Mix_ChannelFinished(channelFinished);
+    int rate;
+    U16 format;
+    int channels;
+    if (Mix_QuerySpec(&rate, &format, &channels) == 0) {
+        sdlError("Sounds", "Mix_QuerySpec");
+        return false;
+    }
+    if (format != AUDIO_S16LSB || channels != 2) {
+        logErr("Sounds", "Audio device is not 16-bit stereo, sounds are off");
+        return false;
+    }
 
-    playingChannels.resize(Mix_AllocateChannels(-1));
+    soundMixer.reset(static_cast<U32>(rate));
+    Mix_SetPostMix(postMix, 0);
+    return true;
 }
 
-static SDL2Sound
-makeSound(StringView path) noexcept {
+bool
+soundDecode(StringView path, SoundPCM& pcm) noexcept {
     String r;
     if (!resourceLoad(path, r)) {
         // Error logged.
-        return SDL2Sound();
+        return false;
     }
 
     SDL_RWops* ops =
@@ -102,145 +73,24 @@ makeSound(StringView path) noexcept {
 
     if (chunk == 0) {
         sdlError("Sounds", String() << "Mix_LoadWAV(" << path << ")");
-        return SDL2Sound();
-    }
-
-    SDL2Sound s;
-    s.numUsers = 1;
-    s.lastUse = 0;
-    s.frames = static_cast<String&&>(r);
-    s.chunk = chunk;
-    return s;
-}
-
-SoundID
-soundLoad(StringView path) noexcept {
-    init();
-
-    SoundID* cachedId = soundIDs.tryAt(path);
-    if (cachedId) {
-        int sid = **cachedId;
-        SDL2Sound& sound = soundPool[sid];
-        sound.numUsers += 1;
-        return SoundID(sid);
-    }
-
-    SDL2Sound sound = makeSound(path);
-    if (sound == SDL2Sound()) {
-        soundIDs[path] = mark;
-        return mark;
-    }
-
-    int sid = soundPool.allocate();
-    new (&soundPool[sid].frames) String();
-    soundPool[sid] = sound;
-
-    soundIDs[path] = sid;
-
-    return SoundID(sid);
-}
-
-void
-soundsPrune(Time latestPermissibleUse) noexcept {
-    // Mix_FreeChunk(chunk);
-}
-
-PlayingSoundID
-soundPlay(SoundID sid) noexcept {
-    if (!sid)
-        return mark;
-
-    SDL2Sound sound = soundPool[*sid];
-
-    int channel = Mix_PlayChannel(-1, sound.chunk, 0);
-    if (channel == -1) {
-        // Maybe there are too many sounds playing at once right now.
-        return mark;
-    }
-
-    (void)Mix_Volume(channel, 255);
-
-    LockGuard guard(channelMutex);
-
-    int psid = playingSoundPool.allocate();
-    SDL2PlayingSound ps;
-    ps.playing = true;
-    ps.inUse = true;
-    ps.channel = channel;
-    playingSoundPool[psid] = ps;
-    playingChannels[channel] = psid;
-    return PlayingSoundID(psid);
-}
-
-void
-soundRelease(SoundID sid) noexcept {
-    if (!sid)
-        return;
-
-    SDL2Sound& sound = soundPool[*sid];
-
-    sound.numUsers -= 1;
-    assert_(sound.numUsers >= 0);
-
-    if (sound.numUsers == 0)
-        sound.lastUse = worldTime();
-}
-
-bool
-playingSoundIsPlaying(PlayingSoundID psid) noexcept {
-    if (!psid)
         return false;
+    }
 
-    LockGuard guard(channelMutex);
-
-    SDL2PlayingSound ps = playingSoundPool[*psid];
-    return ps.playing;
-}
-
-void
-playingSoundStop(PlayingSoundID psid) noexcept {
-    if (!psid)
-        return;
-
-    SDL2PlayingSound& ps = playingSoundPool[*psid];
-
-    LockGuard guard(channelMutex);
-
-    assert_(ps.playing);
-    ps.playing = false;
-
-    (void)Mix_HaltChannel(ps.channel);
-}
-
-void
-playingSoundVolume(PlayingSoundID psid, float volume) noexcept {
-    if (!psid)
-        return;
-
-    LockGuard guard(channelMutex);
-
-    SDL2PlayingSound ps = playingSoundPool[*psid];
-
-    (void)Mix_Volume(ps.channel, static_cast<int>(volume * 128));
+    // The device is 16-bit stereo, which Mix_LoadWAV_RW() converted the
+    // sound to.
+    pcm.frames = reinterpret_cast<I16*>(chunk->abuf);
+    pcm.numFrames = chunk->alen / 4;
+    pcm.rate = soundMixer.rate;
+    pcm.data = chunk;
+    return true;
 }
 
 void
-playingSoundSpeed(PlayingSoundID psid, float speed) noexcept {
-    // No-op. SDL2 doesn't support changing playback rate.
+soundFree(SoundPCM& pcm) noexcept {
+    Mix_FreeChunk(static_cast<Mix_Chunk*>(pcm.data));
 }
 
 void
-playingSoundRelease(PlayingSoundID psid) noexcept {
-    if (!psid)
-        return;
-
-    LockGuard guard(channelMutex);
-
-    SDL2PlayingSound& ps = playingSoundPool[*psid];
-
-    assert_(ps.inUse);
-    ps.inUse = false;
-
-    if (!ps.playing)
-        playingSoundPool.release(*psid);
+soundsTick(Time) noexcept {
+    // Mixed on SDL2's audio thread.
 }
@@ -4,13 +4,18 @@
 #include "av/sdl2/sdl2.h"
 #include "os/chrono.h"
 #include "os/os.h"
+#include "os/thread.h"
 #include "tiles/client-conf.h"
 #include "tiles/display-list.h"
 #include "tiles/log.h"
 #include "tiles/window.h"
 #include "tiles/world.h"
+#include "util/atomic.h"
 #include "util/compiler.h"
+#include "util/function.h"
+#include "util/math2.h"
 #include "util/measure.h"
+#include "util/new.h"
 #include "util/transform.h"
 
 SDL_Window* sdl2Window = 0;
@@ -19,6 +24,19 @@ fvec2 sdl2Scaling = {0.0, 0.0};
 
 static Nanoseconds start = 0;
 
+static bool closed = false;
+
+// Milliseconds from a key being pressed or released to the end of the next
+// frame presented, by SDL's event timestamps, summed over LATENCY_STATS_PERIOD
+// inputs. The frame ends when the swap returns, which is when it goes to the
+// display if vsync is on.
+#define LATENCY_STATS_PERIOD 20
+static bool inputPending = false;
+static U32 inputTimestamp = 0;
+static U32 latencyTotal = 0;
+static U32 latencyWorst = 0;
+static U32 latencyCount = 0;
+
 static struct Transform transformStack[10];
 static Size transformTop = 0;
 
@@ -57,6 +75,10 @@ handleEvent(const SDL_Event& event) noexcept {
         case SDLK_DOWN: key = KEY_DOWN_ARROW; break;
         default: return;
         }
+        if (!inputPending) {
+            inputPending = true;
+            inputTimestamp = event.key.timestamp;
+        }
         if (event.type == SDL_KEYUP)
             windowEmitKeyUp(key);
         else if (event.type == SDL_KEYDOWN)
@@ -80,6 +102,45 @@ handleEvents(void) noexcept {
         handleEvent(event);
 }
 
+// A frame drawn on the main thread, to be presented there or on the render
+// thread.
+struct Frame {
+    DisplayList display;
+
+    // Whether it is the first frame drawn since an input, and the input's
+    // timestamp.
+    bool input;
+    U32 inputTimestamp;
+};
+
+// While pipelining, frame framesPublished is drawn into one while the frame
+// before it is presented from the other. Otherwise only the first is used.
+static Frame frames[2];
+static U32 framesPublished = 0;
+static U32 framesPresented = 0;
+
+// Set once the render thread has presented every frame it will be given.
+static bool finished = false;
+
+static void
+measureLatency(U32 timestamp) noexcept {
+    U32 latency = SDL_GetTicks() - timestamp;
+
+    latencyTotal += latency;
+    latencyWorst = max(latencyWorst, latency);
+    latencyCount += 1;
+
+    if (latencyCount == LATENCY_STATS_PERIOD) {
+        logInfo("SDL2", String() << "Input latency: "
+                                 << latencyTotal / latencyCount
+                                 << " ms average, " << latencyWorst
+                                 << " ms worst");
+        latencyTotal = 0;
+        latencyWorst = 0;
+        latencyCount = 0;
+    }
+}
+
 static void
 updateTransform(void) noexcept {
     int w, h;
@@ -164,11 +225,86 @@ windowSetCaption(StringView caption) noexcept {
     SDL_SetWindowTitle(sdl2Window, String(caption).null());
 }
 
+// Draw the world into a frame, on the main thread.
+static void
+draw(Frame& frame) noexcept {
+    worldDraw(&frame.display);
+    imagesPublish();
+
+    frame.input = inputPending;
+    frame.inputTimestamp = inputTimestamp;
+    inputPending = false;
+}
+
+static void
+present(Frame& frame) noexcept {
+    DisplayList& display = frame.display;
+
+    if (!imageStartFrame(display.damage.size > 0))
+        display.damage.clear();
+    displayListPresent(&display);
+    imageEndFrame();
+
+    if (frame.input)
+        measureLatency(frame.inputTimestamp);
+
+    display.items.clear();
+    display.damage.clear();
+}
+
+// Frames take a few milliseconds, so a thread waiting for the other spins a
+// little before it starts sleeping.
+static void
+backOff(U32& spins) noexcept {
+    if (spins++ >= 64)
+        chronoSleep(100000);
+}
+
+static void
+render(void*) noexcept {
+    imagesAttachThread();
+
+    for (U32 frame = 0;; frame++) {
+        U32 spins = 0;
+        while (atomicLoad(&framesPublished) == frame) {
+            if (atomicLoad(&finished))
+                return;
+            backOff(spins);
+        }
+
+        present(frames[frame % 2]);
+
+        atomicStore(&framesPresented, frame + 1);
+    }
+}
+
+// Draw a frame and hand it to the render thread. The frame two before it used
+// the same Frame, so it waits for that one to be presented, which keeps the
+// frame on screen at most one behind the one being drawn.
+static void
+publish() noexcept {
+    U32 published = framesPublished;
+
+    U32 spins = 0;
+    while (atomicLoad(&framesPresented) + 1 < published)
+        backOff(spins);
+
+    draw(frames[published % 2]);
+    atomicStore(&framesPublished, published + 1);
+}
+
 void
 windowMainLoop(void) noexcept {
     SDL_ShowWindow(sdl2Window);
 
-    DisplayList display = {};
+    // While pipelining, the render thread presents each frame while the next
+    // is ticked and drawn here.
+    Thread* renderer = 0;
+    if (confWindowPipeline && imagesDetachThread()) {
+        logInfo("SDL2", "Presenting frames on a render thread");
+        Function fn = {render, 0};
+        renderer = new Thread(fn);
+    }
 
     int refreshRate = getRefreshRate(sdl2Window);
     const Nanoseconds idealFrameTime = s_to_ns(1) / refreshRate;
@@ -179,36 +315,27 @@ windowMainLoop(void) noexcept {
 
     Nanoseconds nextFrameStart = frameStart + idealFrameTime;
 
-    while (sdl2Window != 0) {
-        handleEvents();
-
+    while (!closed) {
         //
         // Simulate world and draw frame.
         //
-        Time dt = ns_to_ms(frameStart - previousFrameStart);
-
-        assert_(dt >= 0);
 
-        if (dt > 0) {
-            worldTick(dt);
-        }
-        else {
-            // FIXME: Why does this happen and what should be done when it
-            //        occurs?
-            // logInfo("SDL2", "dt == 0");
-        }
+        // Input is read as late as it can be, right before the steps it
+        // affects.
+        handleEvents();
+        worldAdvance(frameStart - previousFrameStart);
 
         //bool drew = false;
-        if (worldNeedsRedraw()) {
+        if (worldNeedsRedraw() || imagesNeedRedraw()) {
             //drew = true;
 
-            worldDraw(&display);
-
-            imageStartFrame();
-            displayListPresent(&display);
-            imageEndFrame();
-
-            display.items.clear();
+            if (renderer) {
+                publish();
+            }
+            else {
+                draw(frames[0]);
+                present(frames[0]);
+            }
         }
 
         Nanoseconds frameEnd = chronoNow();
@@ -253,6 +380,18 @@ windowMainLoop(void) noexcept {
                                 << "Dropped " << framesDropped << " frames");
         }
     }
+
+    if (renderer) {
+        U32 spins = 0;
+        while (atomicLoad(&framesPresented) < framesPublished)
+            backOff(spins);
+
+        atomicStore(&finished, true);
+        renderer->join();
+        delete renderer;
+    }
+
+    sdl2Window = 0;
 }
 
 void
@@ -297,5 +436,5 @@ windowPopClip(void) noexcept { }
 void
 windowClose(void) noexcept {
     SDL_HideWindow(sdl2Window);
-    sdl2Window = 0;
+    closed = true;
 }
@@ -9,8 +9,31 @@ extern SDL_Window* sdl2Window;
 extern fvec2 sdl2Translation;
 extern fvec2 sdl2Scaling;
 
+// Whether images loaded in the background are ready to be shown, in which
+// case a frame should be drawn even if the world has not changed.
+bool
+imagesNeedRedraw() noexcept;
+
+// Hand the frame about to be presented whatever was loaded, baked, and freed
+// on the main thread since the last one. Called on the main thread once the
+// frame's DisplayList is drawn, before the frame is started.
+void
+imagesPublish() noexcept;
+
+// Give up the renderer on the main thread so that frames can be presented on
+// another, which then calls imagesAttachThread() before its first frame.
+// Returns false if the renderer must stay where it was made, in which case
+// nothing changes.
+bool
+imagesDetachThread() noexcept;
 void
-imageStartFrame() noexcept;
+imagesAttachThread() noexcept;
+
+// Start a frame. If keep is true, try to keep the previous frame so that only
+// parts of it need be redrawn. Returns whether it was kept. If not, the whole
+// frame must be drawn.
+bool
+imageStartFrame(bool keep) noexcept;
 void
 imageEndFrame() noexcept;
 
@@ -0,0 +1,177 @@
+#include "av/soft/blit.h"
+
+#include "os/c.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+#if (GCC || CLANG) && defined(__AVX2__)
+#    define VECTOR_BYTES 32
+#elif (GCC || CLANG) && \
+    (defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#    define VECTOR_BYTES 16
+#else
+#    define VECTOR_BYTES 0
+#endif
+
+#if VECTOR_BYTES == 32
+const char* const softBlitTarget = "AVX2";
+#elif VECTOR_BYTES == 16 && defined(__SSE2__)
+const char* const softBlitTarget = "SSE2";
+#elif VECTOR_BYTES == 16
+const char* const softBlitTarget = "NEON";
+#else
+const char* const softBlitTarget = "scalar";
+#endif
+
+#if VECTOR_BYTES
+// https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+typedef U32 Pixels __attribute__((vector_size(VECTOR_BYTES)));
+typedef U16 Channels __attribute__((vector_size(VECTOR_BYTES)));
+
+#    define LANES (VECTOR_BYTES / 4)
+
+#    if CLANG
+#        define SHUFFLE(v, ...) __builtin_shufflevector(v, v, __VA_ARGS__)
+#    else
+#        define SHUFFLE(v, ...) __builtin_shuffle(v, Pixels{__VA_ARGS__})
+#    endif
+
+// Rows need not be aligned to the vector size.
+static inline Pixels
+load(const U32* p) noexcept {
+    Pixels v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void
+store(U32* p, Pixels v) noexcept {
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline Pixels
+splat(U32 x) noexcept {
+    Pixels v = {};
+    return v + x;
+}
+#endif
+
+void
+softBlitOpaque(U32* dst, const U32* src, Size n) noexcept {
+    // Already vectorized by the C library.
+    memcpy(dst, src, n * sizeof(U32));
+}
+
+void
+softBlitAlphaTest(U32* dst, const U32* src, Size n) noexcept {
+    Size i = 0;
+
+#if VECTOR_BYTES
+    Pixels zero = {};
+    for (; i + LANES <= n; i += LANES) {
+        Pixels s = load(src + i);
+        Pixels d = load(dst + i);
+        // All ones in lanes where the source is transparent.
+        Pixels clear = (Pixels)((s >> 24) == zero);
+        store(dst + i, (d & clear) | (s & ~clear));
+    }
+#endif
+
+    for (; i < n; i++)
+        if (src[i] >> 24)
+            dst[i] = src[i];
+}
+
+// Color channels are blended two at a time, red with blue and alpha with
+// green, in 16-bit lanes. Each lane holds at most 255 * 255 + 128, so lanes
+// never carry into each other, and (x + (x >> 8)) >> 8 divides by 255 with
+// rounding.
+void
+softBlendColor(U32* dst, Size n, U32 argb) noexcept {
+    U32 a = argb >> 24;
+    U32 inv = 255 - a;
+    U32 rb = (argb & 0x00FF00FF) * a + 0x00800080;
+    U32 ag = ((argb >> 8) & 0x00FF00FF) * a + 0x00800080;
+
+    Size i = 0;
+
+#if VECTOR_BYTES
+    Pixels mask = splat(0x00FF00FF);
+    Pixels opaque = splat(0xFF000000);
+    Channels vinv = (Channels)splat(inv | inv << 16);
+    Channels vrb = (Channels)splat(rb);
+    Channels vag = (Channels)splat(ag);
+
+    for (; i + LANES <= n; i += LANES) {
+        Pixels d = load(dst + i);
+        Channels x = (Channels)(d & mask) * vinv + vrb;
+        Channels y = (Channels)((d >> 8) & mask) * vinv + vag;
+        x = (x + (x >> 8)) >> 8;
+        y = (y + (y >> 8)) >> 8;
+        store(dst + i, (Pixels)x | ((Pixels)y << 8) | opaque);
+    }
+#endif
+
+    for (; i < n; i++) {
+        U32 d = dst[i];
+        U32 x = (d & 0x00FF00FF) * inv + rb;
+        U32 y = ((d >> 8) & 0x00FF00FF) * inv + ag;
+        x = ((x + ((x >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+        y = ((y + ((y >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+        dst[i] = 0xFF000000 | x | (y << 8);
+    }
+}
+
+void
+softScaleRow(U32* dst, const U32* src, Size n, U32 factor) noexcept {
+    Size i = 0;
+
+#if VECTOR_BYTES
+    // Small factors shuffle a vector of pixels into factor vectors. Factors
+    // of at least a vector's width store each pixel a vector at a time, the
+    // last store overlapping the one before.
+    if (factor == 2) {
+        for (; i + LANES <= n; i += LANES) {
+            Pixels s = load(src + i);
+            U32* out = dst + i * 2;
+#    if LANES == 4
+            store(out, SHUFFLE(s, 0, 0, 1, 1));
+            store(out + 4, SHUFFLE(s, 2, 2, 3, 3));
+#    else
+            store(out, SHUFFLE(s, 0, 0, 1, 1, 2, 2, 3, 3));
+            store(out + 8, SHUFFLE(s, 4, 4, 5, 5, 6, 6, 7, 7));
+#    endif
+        }
+    }
+    else if (factor == 3) {
+        for (; i + LANES <= n; i += LANES) {
+            Pixels s = load(src + i);
+            U32* out = dst + i * 3;
+#    if LANES == 4
+            store(out, SHUFFLE(s, 0, 0, 0, 1));
+            store(out + 4, SHUFFLE(s, 1, 1, 2, 2));
+            store(out + 8, SHUFFLE(s, 2, 3, 3, 3));
+#    else
+            store(out, SHUFFLE(s, 0, 0, 0, 1, 1, 1, 2, 2));
+            store(out + 8, SHUFFLE(s, 2, 3, 3, 3, 4, 4, 4, 5));
+            store(out + 16, SHUFFLE(s, 5, 5, 6, 6, 6, 7, 7, 7));
+#    endif
+        }
+    }
+    else if (factor >= LANES) {
+        for (; i < n; i++) {
+            Pixels p = splat(src[i]);
+            U32* out = dst + i * factor;
+            for (U32 j = 0; j + LANES <= factor; j += LANES)
+                store(out + j, p);
+            store(out + factor - LANES, p);
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        U32* out = dst + i * factor;
+        for (U32 j = 0; j < factor; j++)
+            out[j] = src[i];
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef SRC_AV_SOFT_BLIT_H_
+#define SRC_AV_SOFT_BLIT_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Row kernels for the software renderer. Pixels are 0xAARRGGBB.
+//
+// Each kernel uses the widest vectors the build targets: AVX2 when compiled
+// with it enabled, else SSE2 or NEON, which every AMD64 and ARM64 target has.
+// Other targets and compilers without vector extensions get scalar loops.
+
+// Name of the vector instruction set the kernels were built for.
+extern const char* const softBlitTarget;
+
+// Copy n pixels.
+void
+softBlitOpaque(U32* dst, const U32* src, Size n) noexcept;
+
+// Copy the n pixels that are not fully transparent.
+void
+softBlitAlphaTest(U32* dst, const U32* src, Size n) noexcept;
+
+// Blend a color over n pixels by its alpha. The results are opaque.
+void
+softBlendColor(U32* dst, Size n, U32 argb) noexcept;
+
+// Repeat each of n pixels factor times, writing n * factor pixels.
+void
+softScaleRow(U32* dst, const U32* src, Size n, U32 factor) noexcept;
+
+#endif  // SRC_AV_SOFT_BLIT_H_
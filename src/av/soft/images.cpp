@@ -0,0 +1,503 @@
+#include "tiles/images.h"
+
+#include "av/soft/blit.h"
+#include "av/soft/window.h"
+#include "os/os.h"
+#include "tiles/client-conf.h"
+#include "tiles/log.h"
+#include "tiles/resources.h"
+#include "tiles/vec.h"
+#include "tiles/world.h"
+#include "util/assert.h"
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/hashtable.h"
+#include "util/image-decode.h"
+#include "util/int.h"
+#include "util/math2.h"
+#include "util/measure.h"
+#include "util/new.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+struct SoftTexture {
+    U32* pixels;
+    U32 width;
+    U32 height;
+    // Whether every pixel has full alpha, so that it can be copied without
+    // testing each one.
+    bool opaque;
+};
+
+// Images stay loaded while anything uses them, and after that until
+// imagesPrune().
+struct SoftImage {
+    // tiles.image.texture is zero while not loaded.
+    TiledImage tiles;
+    int numUsers;
+    Time lastUse;
+};
+
+static Hashmap<String, SoftImage> images;
+
+// A texture that frames published before it was released might still draw.
+struct Retired {
+    SoftTexture* texture;
+    U32 frame;
+};
+
+static Vector<Retired> retired;
+
+// Whether softPixels holds the previous frame.
+static bool frameKept = false;
+static I32 frameNumber = 0;
+
+// Drawing is limited to this rectangle of the frame, in pixels.
+static irect clip = {0, 0, 0, 0};
+
+// An image's row after scaling, for the part of it that is drawn.
+static Vector<U32> scratch;
+
+void
+imageInit() noexcept {
+    clip.x2 = softWidth;
+    clip.y2 = softHeight;
+}
+
+static SoftTexture*
+newTexture(U32 width, U32 height) noexcept {
+    Size count = static_cast<Size>(width) * height;
+
+    SoftTexture* texture = xmalloc(SoftTexture, 1);
+    texture->pixels = xmalloc(U32, count);
+    texture->width = width;
+    texture->height = height;
+    texture->opaque = false;
+
+    for (Size i = 0; i < count; i++)
+        texture->pixels[i] = 0;
+
+    return texture;
+}
+
+static void
+freeTexture(SoftTexture* texture) noexcept {
+    free(texture->pixels);
+    free(texture);
+}
+
+// Free a texture once every frame that has been published is presented.
+static void
+retire(SoftTexture* texture) noexcept {
+    if (atomicLoad(&softFramesPresented) == softFramesPublished) {
+        freeTexture(texture);
+        return;
+    }
+
+    Retired r = {texture, softFramesPublished};
+    retired.push(r);
+}
+
+static bool
+isOpaque(SoftTexture* texture) noexcept {
+    Size count = static_cast<Size>(texture->width) * texture->height;
+    for (Size i = 0; i < count; i++)
+        if (texture->pixels[i] >> 24 != 0xFF)
+            return false;
+    return true;
+}
+
+//
+// Frames.
+//
+
+static void
+put16(U8* p, U32 x) noexcept {
+    p[0] = static_cast<U8>(x);
+    p[1] = static_cast<U8>(x >> 8);
+}
+
+static void
+put32(U8* p, U32 x) noexcept {
+    put16(p, x);
+    put16(p + 2, x >> 16);
+}
+
+#define BI_RGB 0
+
+// Write the frame as a top-down 32-bit BMP.
+static void
+writeFrame(StringView path) noexcept {
+    U32 pixelsSize = static_cast<U32>(softWidth) * softHeight * 4;
+
+    U8 header[54] = {};
+    header[0] = 'B';
+    header[1] = 'M';
+    put32(header + 2, sizeof(header) + pixelsSize);
+    put32(header + 10, sizeof(header));
+    put32(header + 14, 40);
+    put32(header + 18, static_cast<U32>(softWidth));
+    put32(header + 22, static_cast<U32>(-softHeight));
+    put16(header + 26, 1);
+    put16(header + 28, 32);
+    put32(header + 30, BI_RGB);
+    put32(header + 34, pixelsSize);
+
+    U32 lengths[2] = {sizeof(header), pixelsSize};
+    void* datas[2] = {header, softPixels};
+
+    if (!writeFileVec(path, 2, lengths, datas))
+        logErr("Soft", String() << "Could not write " << path);
+}
+
+static void
+fill(irect rect, U32 argb) noexcept {
+    for (I32 y = rect.y1; y < rect.y2; y++)
+        softBlendColor(softPixels + y * softWidth + rect.x1,
+                       static_cast<Size>(rect.x2 - rect.x1), argb);
+}
+
+bool
+imageStartFrame(bool keep) noexcept {
+    keep = keep && frameKept;
+    frameKept = true;
+
+    if (!keep)
+        fill(clip, 0xFF000000);
+
+    return keep;
+}
+
+void
+imageEndFrame() noexcept {
+    if (confSoftOutput.size == 0)
+        return;
+
+    if (frameNumber == 0 && !isDir(confSoftOutput))
+        makeDirectory(confSoftOutput);
+
+    String path = String() << confSoftOutput << "/frame-";
+    for (I32 place = 10000; place > 1 && frameNumber < place; place /= 10)
+        path << '0';
+    path << frameNumber << ".bmp";
+
+    writeFrame(path);
+
+    frameNumber += 1;
+}
+
+void
+imageBeginRegion(I32 x, I32 y, I32 width, I32 height) noexcept {
+    clip.x1 = x;
+    clip.y1 = y;
+    clip.x2 = x + width;
+    clip.y2 = y + height;
+
+    fill(clip, 0xFF000000);
+}
+
+void
+imageEndRegion() noexcept {
+    clip.x1 = 0;
+    clip.y1 = 0;
+    clip.x2 = softWidth;
+    clip.y2 = softHeight;
+}
+
+void
+imageDrawRect(float left, float right, float top, float bottom, float z,
+              U32 argb) noexcept {
+    if ((argb & 0xFF000000) == 0)
+        return;
+
+    irect rect = {
+        max(static_cast<I32>(left), clip.x1),
+        max(static_cast<I32>(top), clip.y1),
+        min(static_cast<I32>(right), clip.x2),
+        min(static_cast<I32>(bottom), clip.y2),
+    };
+    if (rect.x1 >= rect.x2 || rect.y1 >= rect.y2)
+        return;
+
+    fill(rect, argb);
+}
+
+// Scale the columns of an image's row that fall within [x1, x2) of the frame,
+// where the image is drawn from left to left + width.
+static const U32*
+scaleColumns(const U32* row, U32 rowWidth, I32 left, I32 width, I32 x1,
+             I32 x2) noexcept {
+    U32 skip = static_cast<U32>(x1 - left);
+    Size span = static_cast<Size>(x2 - x1);
+
+    if (static_cast<U32>(width) == rowWidth)
+        return row + skip;
+
+    if (static_cast<U32>(width) % rowWidth == 0) {
+        U32 factor = static_cast<U32>(width) / rowWidth;
+        U32 first = skip / factor;
+        U32 last = static_cast<U32>(x2 - 1 - left) / factor;
+
+        Size count = static_cast<Size>(last - first + 1) * factor;
+        if (scratch.size < count)
+            scratch.resize(count);
+
+        softScaleRow(scratch.data, row + first, last - first + 1, factor);
+        return scratch.data + (skip - first * factor);
+    }
+
+    if (scratch.size < span)
+        scratch.resize(span);
+
+    // Nearest neighbor, stepping through the row in 16.16 fixed point.
+    U64 step = (static_cast<U64>(rowWidth) << 16) / static_cast<U64>(width);
+    U64 u = skip * step;
+    for (Size i = 0; i < span; i++, u += step)
+        scratch[i] = row[u >> 16];
+
+    return scratch.data;
+}
+
+void
+imageDraw(Image image, float x, float y, float z) noexcept {
+    assert_(IMAGE_VALID(image));
+
+    SoftTexture* texture = static_cast<SoftTexture*>(image.texture);
+
+    // Snap to whole pixels, as the SDL2 renderer does.
+    I32 left = static_cast<I32>((x + softTranslation.x) * softScaling.x);
+    I32 top = static_cast<I32>((y + softTranslation.y) * softScaling.y);
+    I32 width = static_cast<I32>(image.width * softScaling.x);
+    I32 height = static_cast<I32>(image.height * softScaling.y);
+
+    I32 x1 = max(left, clip.x1);
+    I32 y1 = max(top, clip.y1);
+    I32 x2 = min(left + width, clip.x2);
+    I32 y2 = min(top + height, clip.y2);
+    if (x1 >= x2 || y1 >= y2)
+        return;
+
+    const U32* pixels = texture->pixels + image.y * texture->width + image.x;
+    Size span = static_cast<Size>(x2 - x1);
+
+    // A row repeated several times when scaled up is scaled only once.
+    I64 previous = -1;
+    const U32* row = 0;
+
+    for (I32 dy = y1; dy < y2; dy++) {
+        I64 sy = static_cast<I64>(dy - top) * image.height / height;
+        if (sy != previous) {
+            row = scaleColumns(pixels + sy * texture->width, image.width,
+                               left, width, x1, x2);
+            previous = sy;
+        }
+
+        U32* out = softPixels + dy * softWidth + x1;
+        if (texture->opaque)
+            softBlitOpaque(out, row, span);
+        else
+            softBlitAlphaTest(out, row, span);
+    }
+}
+
+//
+// Loading.
+//
+
+// Make an image loaded. Returns false if it could not be.
+static bool
+load(StringView path, Image& image) noexcept {
+    String r;
+    if (!resourceLoad(path, r)) {
+        // Error logged.
+        return false;
+    }
+
+    TimeMeasure m(String() << "Constructed " << path << " as image");
+
+    const U8* bytes = reinterpret_cast<const U8*>(r.data);
+    U32 width;
+    U32 height;
+    if (!decodeImageSize(bytes, r.size, &width, &height)) {
+        logFatal("Soft", String() << "Invalid image: " << path);
+        return false;
+    }
+
+    SoftTexture* texture = newTexture(width, height);
+    if (!decodeImage(bytes, r.size, texture->pixels, width, PIXELS_ARGB)) {
+        freeTexture(texture);
+        logFatal("Soft", String() << "Invalid image: " << path);
+        return false;
+    }
+    texture->opaque = isOpaque(texture);
+
+    image.texture = texture;
+    image.x = 0;
+    image.y = 0;
+    image.width = texture->width;
+    image.height = texture->height;
+
+    return true;
+}
+
+static SoftImage*
+findImage(Image image) noexcept {
+    for (Hashmap<String, SoftImage>::iterator it = images.begin();
+         it != images.end(); ++it)
+        if (it->value.tiles.image.texture == image.texture)
+            return &it->value;
+    return 0;
+}
+
+Image
+imageLoad(StringView path) noexcept {
+    SoftImage& entry = images[path];
+    Image& image = entry.tiles.image;
+
+    if (!IMAGE_VALID(image) && !load(path, image))
+        return image;
+
+    entry.numUsers += 1;
+    return image;
+}
+
+void
+imageRelease(Image image) noexcept {
+    if (!IMAGE_VALID(image))
+        return;
+
+    SoftImage* entry = findImage(image);
+    assert_(entry);
+
+    entry->numUsers -= 1;
+    assert_(entry->numUsers >= 0);
+
+    if (entry->numUsers == 0)
+        entry->lastUse = worldTime();
+}
+
+// Images are decoded as they are loaded.
+bool
+imageReady(Image image) noexcept {
+    return true;
+}
+
+Image
+imageBake(U32 width, U32 height, const BakeItem* items, Size count) noexcept {
+    SoftTexture* baked = newTexture(width, height);
+
+    for (Size i = 0; i < count; i++) {
+        Image image = items[i].image;
+        SoftTexture* texture = static_cast<SoftTexture*>(image.texture);
+
+        I32 left = static_cast<I32>(items[i].x);
+        I32 top = static_cast<I32>(items[i].y);
+        I32 x1 = max(left, 0);
+        I32 y1 = max(top, 0);
+        I32 x2 = min(left + static_cast<I32>(image.width),
+                     static_cast<I32>(width));
+        I32 y2 = min(top + static_cast<I32>(image.height),
+                     static_cast<I32>(height));
+
+        if (x1 >= x2)
+            continue;
+
+        for (I32 y = y1; y < y2; y++) {
+            const U32* row = texture->pixels +
+                             (image.y + y - top) * texture->width + image.x +
+                             (x1 - left);
+            softBlitOpaque(baked->pixels + y * width + x1, row,
+                           static_cast<Size>(x2 - x1));
+        }
+    }
+
+    baked->opaque = isOpaque(baked);
+
+    Image image = {baked, 0, 0, width, height};
+    return image;
+}
+
+void
+imageBakeRelease(Image image) noexcept {
+    if (IMAGE_VALID(image))
+        retire(static_cast<SoftTexture*>(image.texture));
+}
+
+TiledImage
+tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
+          U32 numHigh) noexcept {
+    SoftImage& entry = images[path];
+    TiledImage& tiles = entry.tiles;
+
+    if (!TILES_VALID(tiles)) {
+        if (!load(path, tiles.image))
+            return tiles;
+
+        assert_(tiles.image.width == tileWidth * numAcross);
+        assert_(tiles.image.height == tileHeight * numHigh);
+
+        tiles.tileWidth = tileWidth;
+        tiles.tileHeight = tileHeight;
+        tiles.numTiles = numAcross * numHigh;
+    }
+
+    entry.numUsers += 1;
+    return tiles;
+}
+
+void
+tilesRelease(TiledImage tiles) noexcept {
+    imageRelease(tiles.image);
+}
+
+Image
+tileAt(TiledImage tiles, U32 index) noexcept {
+    assert_(TILES_VALID(tiles));
+
+    Image image = tiles.image;
+
+    Image i;
+    i.texture = image.texture;
+    i.x = image.x + tiles.tileWidth * index % image.width;
+    i.y = image.y + tiles.tileWidth * index / image.width * tiles.tileHeight;
+    i.width = tiles.tileWidth;
+    i.height = tiles.tileHeight;
+    return i;
+}
+
+void
+imagesPrune(Time latestPermissibleUse) noexcept {
+    for (Hashmap<String, SoftImage>::iterator it = images.begin();
+         it != images.end(); ++it) {
+        SoftImage& entry = it->value;
+        Image& image = entry.tiles.image;
+        if (entry.numUsers == 0 && IMAGE_VALID(image) &&
+            entry.lastUse < latestPermissibleUse) {
+            retire(static_cast<SoftTexture*>(image.texture));
+            image.texture = 0;
+        }
+    }
+}
+
+void
+imagesCollect() noexcept {
+    U32 presented = atomicLoad(&softFramesPresented);
+
+    for (Size i = 0; i < retired.size;) {
+        if (presented >= retired[i].frame) {
+            freeTexture(retired[i].texture);
+            retired.eraseUnordered(i);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+// Images and rectangles are drawn as soon as they are given.
+void
+imageFlushImages() noexcept { }
+
+void
+imageFlushRects() noexcept { }
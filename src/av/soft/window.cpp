@@ -0,0 +1,272 @@
+#include "av/soft/window.h"
+
+#include "av/soft/blit.h"
+#include "os/chrono.h"
+#include "os/os.h"
+#include "os/thread.h"
+#include "tiles/client-conf.h"
+#include "tiles/display-list.h"
+#include "tiles/log.h"
+#include "tiles/window.h"
+#include "tiles/world.h"
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/function.h"
+#include "util/int.h"
+#include "util/new.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/transform.h"
+
+U32* softPixels = 0;
+I32 softWidth = 0;
+I32 softHeight = 0;
+
+fvec2 softTranslation = {0.0, 0.0};
+fvec2 softScaling = {1.0, 1.0};
+
+U32 softFramesPublished = 0;
+U32 softFramesPresented = 0;
+
+// Frames are not shown to anyone, so time is simulated: each frame advances it
+// by a sixtieth of a second no matter how long it took to draw.
+static Time now = 0;
+
+static bool closed = false;
+
+// Frame softFramesPublished is built in one while the frame before it is
+// presented from the other.
+static DisplayList displays[2];
+
+// Set once the render thread has presented every frame it will be given.
+static bool finished = false;
+
+static Nanoseconds total = 0;
+static Nanoseconds worst = 0;
+static I32 drawn = 0;
+
+static struct Transform transformStack[10];
+static Size transformTop = 0;
+
+static void
+updateTransform(void) noexcept {
+    struct Transform transform = transformStack[transformTop];
+
+    float xScale = transform.m[0];
+    float yScale = transform.m[5];
+    float x = transform.m[12];
+    float y = transform.m[13];
+
+    softTranslation.x = x / xScale;
+    softTranslation.y = y / yScale;
+    softScaling.x = xScale;
+    softScaling.y = yScale;
+}
+
+Time
+windowTime(void) noexcept {
+    return now;
+}
+
+void
+windowCreate(void) noexcept {
+    transformStack[0] = transformIdentity();
+
+    softWidth = confWindowSize.x;
+    softHeight = confWindowSize.y;
+    softPixels = xmalloc(U32, static_cast<Size>(softWidth) * softHeight);
+
+    logInfo("Soft", String() << "Rendering " << confSoftFrames << " frames at "
+                             << softWidth << "x" << softHeight << " with "
+                             << softBlitTarget << " kernels"
+                             << (confSoftPipeline ? ", pipelined" : ""));
+}
+
+I32
+windowWidth(void) noexcept {
+    return softWidth;
+}
+
+I32
+windowHeight(void) noexcept {
+    return softHeight;
+}
+
+void
+windowSetCaption(StringView) noexcept { }
+
+// Whole milliseconds that add up to exactly one second every 60 frames.
+static Time
+frameTime(I32 frame) noexcept {
+    return (frame + 1) * 1000 / 60 - frame * 1000 / 60;
+}
+
+static void
+measure(Nanoseconds frameStart) noexcept {
+    Nanoseconds taken = chronoNow() - frameStart;
+    total += taken;
+    if (worst < taken)
+        worst = taken;
+    drawn += 1;
+}
+
+static void
+present(DisplayList* display) noexcept {
+    if (!imageStartFrame(display->damage.size > 0))
+        display->damage.clear();
+    displayListPresent(display);
+
+    display->items.clear();
+    display->damage.clear();
+}
+
+// Frames take about a millisecond, so a thread waiting for the other spins a
+// little before it starts sleeping.
+static void
+backOff(U32& spins) noexcept {
+    if (spins++ >= 64)
+        chronoSleep(20000);
+}
+
+static void
+render(void*) noexcept {
+    for (U32 frame = 0;; frame++) {
+        U32 spins = 0;
+        while (atomicLoad(&softFramesPublished) == frame) {
+            if (atomicLoad(&finished))
+                return;
+            backOff(spins);
+        }
+
+        present(&displays[frame % 2]);
+        imageEndFrame();
+
+        atomicStore(&softFramesPresented, frame + 1);
+    }
+}
+
+static void
+runSerial() noexcept {
+    DisplayList* display = &displays[0];
+
+    for (I32 frame = 0; frame < confSoftFrames && !closed; frame++) {
+        Time dt = frameTime(frame);
+        now += dt;
+
+        Nanoseconds frameStart = chronoNow();
+
+        worldAdvance(dt * 1000000);
+
+        if (worldNeedsRedraw()) {
+            worldDraw(display);
+            present(display);
+            measure(frameStart);
+
+            // Written out after timing, so as not to count the disk.
+            imageEndFrame();
+        }
+    }
+}
+
+// The render thread presents each frame while the next is ticked and drawn
+// here. A frame is timed until it is handed off, so it includes any wait for
+// the render thread to give back the DisplayList it is drawn into, and the
+// disk if frames are written out.
+static void
+runPipelined() noexcept {
+    Function fn = {render, 0};
+    Thread renderer(fn);
+
+    for (I32 frame = 0; frame < confSoftFrames && !closed; frame++) {
+        Time dt = frameTime(frame);
+        now += dt;
+
+        Nanoseconds frameStart = chronoNow();
+
+        worldAdvance(dt * 1000000);
+
+        if (worldNeedsRedraw()) {
+            U32 published = softFramesPublished;
+
+            // The frame two before this one used the same DisplayList.
+            U32 spins = 0;
+            while (atomicLoad(&softFramesPresented) + 1 < published)
+                backOff(spins);
+
+            worldDraw(&displays[published % 2]);
+            atomicStore(&softFramesPublished, published + 1);
+
+            measure(frameStart);
+        }
+
+        imagesCollect();
+    }
+
+    U32 spins = 0;
+    while (atomicLoad(&softFramesPresented) < softFramesPublished)
+        backOff(spins);
+
+    atomicStore(&finished, true);
+    renderer.join();
+
+    imagesCollect();
+}
+
+void
+windowMainLoop(void) noexcept {
+    if (confSoftPipeline)
+        runPipelined();
+    else
+        runSerial();
+
+    if (drawn > 0)
+        logInfo("Soft", String()
+                            << "Drew " << drawn << " of " << confSoftFrames
+                            << " frames, average "
+                            << ns_to_s_d(total / drawn) * 1000.0f
+                            << " ms, worst " << ns_to_s_d(worst) * 1000.0f
+                            << " ms");
+
+    exitProcess(0);
+}
+
+void
+windowPushScale(float x, float y) noexcept {
+    struct Transform transform = transformStack[transformTop];
+
+    transformStack[++transformTop] =
+        transformMultiply(transformScale(x, y), transform);
+    updateTransform();
+}
+
+void
+windowPopScale(void) noexcept {
+    --transformTop;
+    updateTransform();
+}
+
+void
+windowPushTranslate(float x, float y) noexcept {
+    struct Transform transform = transformStack[transformTop];
+
+    transformStack[++transformTop] =
+        transformMultiply(transformTranslate(x, y), transform);
+    updateTransform();
+}
+
+void
+windowPopTranslate(void) noexcept {
+    --transformTop;
+    updateTransform();
+}
+
+void
+windowPushClip(float, float, float, float) noexcept { }
+
+void
+windowPopClip(void) noexcept { }
+
+void
+windowClose(void) noexcept {
+    closed = true;
+}
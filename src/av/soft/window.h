@@ -0,0 +1,35 @@
+#ifndef SRC_AV_SOFT_WINDOW_H_
+#define SRC_AV_SOFT_WINDOW_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// The window is a framebuffer in memory of 0xAARRGGBB pixels, top row first.
+extern U32* softPixels;
+extern I32 softWidth;
+extern I32 softHeight;
+
+extern fvec2 softTranslation;
+extern fvec2 softScaling;
+
+// Frames handed to the render thread, and frames it has finished presenting.
+// The second trails the first by at most one frame, and only while
+// pipelining. Read both with atomicLoad().
+extern U32 softFramesPublished;
+extern U32 softFramesPresented;
+
+// Start a frame. If keep is true, keep the previous frame so that only parts
+// of it need be redrawn. Returns whether it was kept. If not, the whole frame
+// must be drawn.
+bool
+imageStartFrame(bool keep) noexcept;
+void
+imageEndFrame() noexcept;
+
+// Free textures released while a frame that might draw them was still being
+// presented, now that it is not.
+void
+imagesCollect() noexcept;
+
+#endif  // SRC_AV_SOFT_WINDOW_H_
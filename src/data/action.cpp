@@ -92,10 +92,8 @@ soundTick(DataArea*, void* data, Time) noexcept {
 }
 
 struct Action
-makeSoundAction(StringView sound) noexcept {
-    SoundID sid = soundLoad(sound);
-    PlayingSoundID psid = soundPlay(sid);
-    soundRelease(sid);
+makeSoundAction(SoundID sound) noexcept {
+    PlayingSoundID psid = soundPlay(sound);
 
     struct Action action;
     action.tick = soundTick;
@@ -1,6 +1,7 @@
 #ifndef SRC_DATA_ACTION_H_
 #define SRC_DATA_ACTION_H_
 
+#include "tiles/sounds.h"
 #include "util/compiler.h"
 #include "util/int.h"
 #include "util/string-view.h"
@@ -50,7 +51,7 @@ makeDelayAction(Time duration) noexcept;
 
 // An action that plays a sound and waits for it to finish.
 struct Action
-makeSoundAction(StringView sound) noexcept;
+makeSoundAction(SoundID sound) noexcept;
 
 // An action that calls a function each tick through a set duration.
 struct Action
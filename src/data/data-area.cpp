@@ -6,12 +6,10 @@
 #include "util/random.h"
 
 void
-playSoundEffect(StringView sound) noexcept {
-    SoundID sid = soundLoad(sound);
-    PlayingSoundID psid = soundPlay(sid);
+playSoundEffect(SoundID sound) noexcept {
+    PlayingSoundID psid = soundPlay(sound);
     playingSoundSpeed(psid, 1.0f + randFloat(-0.03f, 0.03f));
     playingSoundRelease(psid);
-    soundRelease(sid);
 }
 
 void
@@ -2,6 +2,7 @@
 #define SRC_DATA_DATA_AREA_H_
 
 #include "data/action.h"
+#include "tiles/sounds.h"
 #include "tiles/vec.h"
 #include "util/compiler.h"
 #include "util/hashvector.h"
@@ -12,9 +13,10 @@
 class Area;
 class Entity;
 
-//! Play a sound with a 3% speed variation applied to it.
+//! Play a sound with a 3% speed variation applied to it. The sound is loaded
+//! once with soundLoad() and kept by the caller.
 void
-playSoundEffect(StringView sound) noexcept;
+playSoundEffect(SoundID sound) noexcept;
 
 class DataArea {
  public:
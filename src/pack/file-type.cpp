@@ -5,7 +5,7 @@
 
 static const StringView textExtensions[] = {".json"};
 
-static const StringView mediaExtensions[] = {".bmp", ".oga", ".png"};
+static const StringView mediaExtensions[] = {".bmp", ".oga", ".png", ".qoi"};
 
 FileType
 determineFileType(StringView path) noexcept {
@@ -116,3 +116,17 @@ readerRead(PackReader* r, void* buf, U32 index) noexcept {
 
     return r->file.readOffset(buf, size, offset);
 }
+
+bool
+readerReadRange(PackReader* r, void* buf, U32 index, U32 offset,
+                U32 size) noexcept {
+    BlobMetadata meta = r->metadata[index];
+
+    // Blobs are not compressed, so their bytes can be read from anywhere.
+    if (offset > meta.uncompressedSize ||
+        size > meta.uncompressedSize - offset)
+        return false;
+
+    return r->file.readOffset(buf, size,
+                              r->header.dataOffset + meta.dataOffset + offset);
+}
@@ -28,5 +28,9 @@ readerDetails(PackReader* r, U32 index) noexcept;
 
 bool
 readerRead(PackReader* r, void* buf, U32 index) noexcept;
+// Read size bytes of a blob, starting offset bytes in.
+bool
+readerReadRange(PackReader* r, void* buf, U32 index, U32 offset,
+                U32 size) noexcept;
 
 #endif  // SRC_PACK_PACK_READER_H_
@@ -37,6 +37,44 @@ getFullPath(StringView path) noexcept {
     return String() << dataWorldDatafile << "/" << path;
 }
 
+bool
+resourceExists(StringView path) noexcept {
+    LockGuard lock(mutex);
+
+    if (!openPackFile())
+        return false;
+
+    return readerIndex(pack, path) != BLOB_NOT_FOUND;
+}
+
+bool
+resourceFind(StringView path, Resource& resource) noexcept {
+    LockGuard lock(mutex);
+
+    if (!openPackFile())
+        return false;
+
+    U32 index = readerIndex(pack, path);
+
+    if (index == BLOB_NOT_FOUND) {
+        logErr("PackResources", String()
+                                    << getFullPath(path) << ": file missing");
+        return false;
+    }
+
+    resource.index = index;
+    resource.size = readerDetails(pack, index).size;
+    return true;
+}
+
+bool
+resourceRead(Resource resource, void* buf, U32 offset, U32 size) noexcept {
+    LockGuard lock(mutex);
+
+    // The pack was opened by resourceFind().
+    return readerReadRange(pack, buf, resource.index, offset, size);
+}
+
 bool
 resourceLoad(StringView path, String& data) noexcept {
     LockGuard lock(mutex);
@@ -1,37 +1,108 @@
 #include "tiles/animation.h"
 
+#include "os/c.h"
 #include "util/assert.h"
 #include "util/compiler.h"
-#include "util/pool.h"
+#include "util/int.h"
+#include "util/vector.h"
 
-struct AnimationData {
-    /** List of images in animation. */
-    Vector<Image> frames;
+// Value of an Animation's slot when it has a single frame.
+#define NO_SLOT UINT32_MAX
 
-    /** Length of each frame in animation in milliseconds. */
-    Time frameTime;
+// Animations live in a table with a column for each field, indexed by
+// AnimationID.
 
-    /** Length of one complete cycle through animation in milliseconds. */
-    Time cycleTime;
+/** Image currently displaying on screen. */
+static Vector<Image> images;
 
-    /** Time offset to find current animation frame. */
-    Time offset;
+static Vector<U32> refCnts;
 
-    /** Index of frame currently displaying on screen. */
-    U32 currentIndex;
+/** Where the animation is in the columns below, if it has many frames. */
+static Vector<U32> slots;
 
-    Image currentImage;
+/** One bit per AnimationID, set when it switches frames. */
+static Vector<U32> changed;
 
-    U32 refCnt;
-};
+static Vector<AnimationID> freeIDs;
 
-static Pool<AnimationData> pool;
+// Animations with more than one frame, the only ones that switch frames, are
+// kept densely together in their own table so that animationsTick() reads
+// nothing else.
 
-static bool
-isSingleFrame(AnimationID self) noexcept {
-    assert_(self != NO_ANIMATION);
+static Vector<AnimationID> ids;
 
-    return pool[self].frameTime == 0;
+/** Length of each frame in animation in milliseconds. */
+static Vector<Time> frameTimes;
+
+/** Length of one complete cycle through animation in milliseconds. */
+static Vector<Time> cycleTimes;
+
+/** Time offset to find current animation frame. */
+static Vector<Time> offsets;
+
+/** Index of frame currently displaying on screen. */
+static Vector<U32> currentIndices;
+
+/** Where the animation's frames start in frames. */
+static Vector<U32> firstFrames;
+
+/** Frames of every animation, one after another. */
+static Vector<Image> frames;
+
+/** Number of frames that belong to destroyed animations. */
+static Size deadFrames = 0;
+
+static AnimationID
+allocate(Image image, U32 slot) noexcept {
+    AnimationID id;
+
+    if (freeIDs.size) {
+        id = freeIDs[freeIDs.size - 1];
+        freeIDs.pop();
+        images[id] = image;
+        refCnts[id] = 1;
+        slots[id] = slot;
+    }
+    else {
+        id = static_cast<AnimationID>(images.size);
+        images.push(image);
+        refCnts.push(1);
+        slots.push(slot);
+        if (changed.size * 32 <= id)
+            changed.push(0);
+    }
+
+    changed[id >> 5] &= ~(1u << (id & 31));
+    return id;
+}
+
+static U32
+numFrames(U32 slot) noexcept {
+    return static_cast<U32>(cycleTimes[slot] / frameTimes[slot]);
+}
+
+// Move the frames of live animations together once destroyed ones take up
+// half the space.
+static void
+compactFrames() noexcept {
+    if (deadFrames * 2 < frames.size)
+        return;
+
+    Vector<Image> live;
+    if (frames.size > deadFrames)
+        live.reserve(frames.size - deadFrames);
+
+    for (U32 slot = 0; slot < ids.size; slot++) {
+        U32 first = firstFrames[slot];
+        U32 n = numFrames(slot);
+
+        firstFrames[slot] = static_cast<U32>(live.size);
+        for (U32 i = 0; i < n; i++)
+            live.push(frames[first + i]);
+    }
+
+    frames = static_cast<Vector<Image>&&>(live);
+    deadFrames = 0;
 }
 
 static void
@@ -39,31 +110,53 @@ destroy(AnimationID self) noexcept {
     if (self == NO_ANIMATION)
         return;
 
-    AnimationData& data = pool[self];
-
-    if (!isSingleFrame(self))
-        data.frames.~Vector<Image>();
+    U32 slot = slots[self];
+    if (slot != NO_SLOT) {
+        deadFrames += numFrames(slot);
+
+        // Fill the hole with the last animated one.
+        U32 last = static_cast<U32>(ids.size - 1);
+        if (slot != last) {
+            ids[slot] = ids[last];
+            frameTimes[slot] = frameTimes[last];
+            cycleTimes[slot] = cycleTimes[last];
+            offsets[slot] = offsets[last];
+            currentIndices[slot] = currentIndices[last];
+            firstFrames[slot] = firstFrames[last];
+            slots[ids[slot]] = slot;
+        }
+        ids.pop();
+        frameTimes.pop();
+        cycleTimes.pop();
+        offsets.pop();
+        currentIndices.pop();
+        firstFrames.pop();
+
+        compactFrames();
+    }
 
-    pool.release(self);
+    images[self].texture = 0;
+    freeIDs.push(self);
 }
 
 static void
 incRef(AnimationID self) noexcept {
     if (self != NO_ANIMATION)
-        ++pool[self].refCnt;
+        ++refCnts[self];
 }
 
 static void
 decRef(AnimationID self) noexcept {
-    if (self != NO_ANIMATION && --pool[self].refCnt == 0)
+    if (self != NO_ANIMATION && --refCnts[self] == 0)
         destroy(self);
 }
 
 static void
 assign(AnimationID& self, AnimationID& other) noexcept {
+    // Referencing other first keeps it alive if it is the same as self.
+    incRef(other);
     decRef(self);
     self = other;
-    incRef(other);
 }
 
 Animation::Animation() noexcept {
@@ -73,31 +166,27 @@ Animation::Animation() noexcept {
 Animation::Animation(Image frame) noexcept {
     assert_(IMAGE_VALID(frame));
 
-    id = pool.allocate();
-    AnimationData& data = pool[id];
-
-    data.frameTime = 0;
-    data.currentImage = frame;
-    data.refCnt = 1;
+    id = allocate(frame, NO_SLOT);
 }
 
-Animation::Animation(Vector<Image> frames, Time frameTime) noexcept {
-    assert_(frames.size > 0);
+Animation::Animation(Vector<Image> frames_, Time frameTime) noexcept {
+    assert_(frames_.size > 0);
     assert_(frameTime > 0);
-    for (Image* frame = frames.begin(); frame != frames.end(); frame++)
+    for (Image* frame = frames_.begin(); frame != frames_.end(); frame++)
         assert_(IMAGE_VALID(*frame));
 
-    id = pool.allocate();
-    AnimationData& data = pool[id];
+    U32 slot = static_cast<U32>(ids.size);
+    id = allocate(frames_[0], slot);
+
+    ids.push(id);
+    frameTimes.push(frameTime);
+    cycleTimes.push(frameTime * static_cast<Time>(frames_.size));
+    offsets.push(0);
+    currentIndices.push(0);
+    firstFrames.push(static_cast<U32>(frames.size));
 
-    new (&data.frames) Vector<Image>();
-    data.frames = static_cast<Vector<Image>&&>(frames);
-    data.frameTime = frameTime;
-    data.cycleTime = frameTime * static_cast<Time>(data.frames.size);
-    data.offset = 0;
-    data.currentIndex = 0;
-    data.currentImage = data.frames[0];
-    data.refCnt = 1;
+    for (Image* frame = frames_.begin(); frame != frames_.end(); frame++)
+        frames.push(*frame);
 }
 
 Animation::Animation(Animation& other) noexcept {
@@ -128,52 +217,54 @@ void
 Animation::restart(Time now) noexcept {
     assert_(id != NO_ANIMATION);
 
-    if (isSingleFrame(id))
+    U32 slot = slots[id];
+    if (slot == NO_SLOT)
         return;
 
-    AnimationData& data = pool[id];
-
-    data.offset = now;
-    data.currentIndex = 0;
-    data.currentImage = data.frames[0];
+    offsets[slot] = now;
+    currentIndices[slot] = 0;
+    images[id] = frames[firstFrames[slot]];
 }
 
 bool
-Animation::needsRedraw(Time now) noexcept {
+Animation::needsRedraw() noexcept {
     assert_(id != NO_ANIMATION);
 
-    if (isSingleFrame(id))
-        return false;
-
-    AnimationData& data = pool[id];
-
-    Time pos = now - data.offset;
-    Size index = static_cast<Size>((pos % data.cycleTime) / data.frameTime);
-
-    return index != data.currentIndex;
+    return (changed[id >> 5] >> (id & 31)) & 1;
 }
 
 Image
-Animation::setFrame(Time now) noexcept {
+Animation::getFrame() noexcept {
     assert_(id != NO_ANIMATION);
 
-    AnimationData& data = pool[id];
-
-    if (!isSingleFrame(id)) {
-        Time pos = now - data.offset;
-        U32 index = static_cast<U32>((pos % data.cycleTime) / data.frameTime);
-        Image image = data.frames[index];
+    return images[id];
+}
 
-        data.currentIndex = index;
-        data.currentImage = image;
-    }
+bool
+Animation::isAnimated() noexcept {
+    assert_(id != NO_ANIMATION);
 
-    return data.currentImage;
+    return slots[id] != NO_SLOT;
 }
 
-Image
-Animation::getFrame() noexcept {
-    assert_(id != NO_ANIMATION);
+void
+animationsTick(Time now) noexcept {
+    for (U32 slot = 0; slot < ids.size; slot++) {
+        Time pos = now - offsets[slot];
+        U32 index =
+            static_cast<U32>((pos % cycleTimes[slot]) / frameTimes[slot]);
+        if (index == currentIndices[slot])
+            continue;
+
+        AnimationID id = ids[slot];
+        currentIndices[slot] = index;
+        images[id] = frames[firstFrames[slot] + index];
+        changed[id >> 5] |= 1u << (id & 31);
+    }
+}
 
-    return pool[id].currentImage;
+void
+animationsDrawn() noexcept {
+    if (changed.size)
+        memset(changed.data, 0, changed.size * sizeof(U32));
 }
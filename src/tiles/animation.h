@@ -18,7 +18,8 @@ typedef U32 AnimationID;
  * displayed.
  *
  * Mechanically, it is a list of images and a period of time over which to
- * play.
+ * play. Every Animation is advanced at once by animationsTick(), so finding
+ * the current frame or whether it changed is a lookup.
  */
 class Animation {
  public:
@@ -66,29 +67,42 @@ class Animation {
     restart(Time now) noexcept;
 
     /**
-     * Has this Animation switched frames since frame() was last called?
-     *
-     * @now current time in milliseconds
+     * Has this Animation switched frames since animationsDrawn() was last
+     * called?
      */
     bool
-    needsRedraw(Time now) noexcept;
+    needsRedraw() noexcept;
 
     /**
-     * Returns the image that should be displayed at this time.
-     *
-     * @now current time in milliseconds
+     * Returns the image that should be displayed as of the last
+     * animationsTick().
      */
     Image
-    setFrame(Time now) noexcept;
+    getFrame() noexcept;
 
     /**
-     * Returns the last image that should have been displayed.
+     * Does this Animation have more than one frame?
      */
-    Image
-    getFrame() noexcept;
+    bool
+    isAnimated() noexcept;
 
  public:
     AnimationID id;
 };
 
+/**
+ * Advance every Animation to the given time, noting which switched frames.
+ * Call once per tick.
+ *
+ * @now current time in milliseconds
+ */
+void
+animationsTick(Time now) noexcept;
+
+/**
+ * Forget which Animations switched frames. Call once they have been drawn.
+ */
+void
+animationsDrawn() noexcept;
+
 #endif  // SRC_TILES_ANIMATION_H_
@@ -1,8 +1,12 @@
 #include "tiles/area-json.h"
 
 #include "data/data-world.h"
+#include "os/c.h"
+#include "os/condition-variable.h"
+#include "os/mutex.h"
 #include "tiles/area.h"
 #include "tiles/character.h"
+#include "tiles/client-conf.h"
 #include "tiles/entity.h"
 #include "tiles/images.h"
 #include "tiles/jsons.h"
@@ -13,7 +17,10 @@
 #include "tiles/world.h"
 #include "util/assert.h"
 #include "util/compiler.h"
+#include "util/hashtable.h"
 #include "util/int.h"
+#include "util/jobs.h"
+#include "util/math2.h"
 #include "util/measure.h"
 #include "util/string2.h"
 #include "util/vector.h"
@@ -31,10 +38,70 @@
          account.
 */
 
+// Residency of one chunk column in a streamed Area.
+enum StreamState {
+    STREAM_UNLOADED,
+    // A worker is reading the chunk.
+    STREAM_LOADING,
+    // A worker is reading the chunk, but it is no longer wanted.
+    STREAM_CANCELLED,
+    STREAM_LOADED,
+};
+
+// An NPC listed in a chunk file of a streamed Area. It is spawned when the
+// chunk is first paged in, and again only after it dies. While the chunk it
+// stands in is paged out, so is it, and it comes back as it was.
+struct StreamNPC {
+    // Its entry in the "npcs" of its chunk's file, as {cx, cy, index}.
+    ivec3 source;
+
+    // Null while paged out.
+    Character* character;
+
+    // Where it was paged out, to be spawned again, and the next NPC paged
+    // out with the same chunk.
+    String descriptor;
+    vicoord coord;
+    String phase;
+    StreamNPC* next;
+};
+
+struct NoSource {
+    static ivec3
+    value() noexcept {
+        return IVEC3_MIN;
+    }
+};
+
+struct NoChunk {
+    static ivec2
+    value() noexcept {
+        ivec2 chunk = {INT32_MIN, INT32_MIN};
+        return chunk;
+    }
+};
+
+class AreaJSON;
+
+struct StreamJob {
+    AreaJSON* area;
+    ivec2 chunk;
+    String path;
+    // Null if the chunk has no file, which means it is empty.
+    JsonDocument* doc;
+};
+
 class AreaJSON : public Area {
  public:
     AreaJSON(Player* player, StringView descriptor) noexcept;
 
+ protected:
+    void
+    streamTick() noexcept;
+
+    void
+    characterRemoved(Character* c) noexcept;
+
  private:
     //! Allocate Tile objects for one layer of map.
     void
@@ -63,20 +130,85 @@ class AreaJSON : public Area {
     bool
     processObjectGroupProperties(JsonValue obj) noexcept;
     bool
-    processObject(JsonValue obj) noexcept;
+    processObject(JsonValue obj, I32 z, const icube& bounds) noexcept;
+    bool
+    processChunk(JsonValue obj, ivec2 chunk) noexcept;
+    bool
+    processChunkLayer(JsonValue obj, ivec2 chunk, const icube& bounds) noexcept;
+    bool
+    processChunkNPC(JsonValue obj, ivec3 source, const icube& bounds) noexcept;
     bool
     splitTileFlags(StringView strOfFlags, U32* flags) noexcept;
     bool
     parseExit(StringView dest, Exit& exit, bool* wwide, bool* hwide) noexcept;
     bool
     parseARGB(StringView str, U8& a, U8& r, U8& g, U8& b) noexcept;
+
+    //! Chunk streaming.
+    String
+    chunkPath(ivec2 chunk) noexcept;
+    icube
+    chunkBounds(ivec2 chunk) noexcept;
+    void
+    streamLoadNow(ivec2 chunk) noexcept;
+    void
+    streamLoadAsync(ivec2 chunk) noexcept;
+    void
+    streamWait(ivec2 chunk) noexcept;
+    void
+    streamCommit() noexcept;
+    void
+    streamUnload(ivec2 chunk) noexcept;
+    //! Spawn the NPCs that were paged out with a chunk, once it is loaded.
+    void
+    streamRestoreNPCs(ivec2 chunk) noexcept;
+
+ public:
+    // Directory holding the chunk files of a streamed Area, with trailing
+    // slash. Empty if the whole Area is loaded up front.
+    String streamPath;
+
+    // StreamState of each chunk column, indexed by cy * chunksDim.x + cx.
+    Vector<U8> streamStates;
+
+    // Chunks that are loading or loaded.
+    Vector<ivec2> streamResident;
+
+    // Access to streamFinished.
+    Mutex streamMutex;
+
+    // Events for when a job is pushed onto streamFinished.
+    ConditionVariable streamDone;
+
+    // Jobs whose chunk has been read by a worker, waiting to be applied.
+    Vector<StreamJob*> streamFinished;
+
+    // NPCs from chunk files, by the entry they came from, by their Character
+    // while they are spawned, and listed by the chunk they were paged out
+    // with.
+    Hashmap<ivec3, StreamNPC*, NoSource> streamNPCs;
+    Hashmap<Character*, StreamNPC*> streamSpawned;
+    Hashmap<ivec2, StreamNPC*, NoChunk> streamPagedOut;
 };
 
 static void
 preallocateMapLayers(TileGrid& grid, Size n) noexcept {
     ivec3 dim = grid.dim;
-    Size layerSize = dim.x * dim.y;
-    grid.graphics.reserve(layerSize * n);
+    Size layerSize = ((dim.x + TILE_CHUNK_MASK) >> TILE_CHUNK_SHIFT) *
+                     ((dim.y + TILE_CHUNK_MASK) >> TILE_CHUNK_SHIFT);
+    grid.chunks.reserve(layerSize * n);
+}
+
+/**
+ * dirname
+ *
+ * Returns the directory component of a path, including trailing slash.  If
+ * there is no directory component, return an empty string.
+ */
+static StringView
+dirname(StringView path) noexcept {
+    StringPosition slash = path.rfind('/');
+    return slash == SV_NOT_FOUND ? "" : path.substr(0, slash + 1);
 }
 
 Area*
@@ -107,10 +239,7 @@ AreaJSON::allocateMapLayer(TileGrid::LayerType type) noexcept {
     assert_(0 <= dim.x);
     assert_(0 <= dim.z);
 
-    grid.layerTypes.push(type);
-
-    grid.graphics.resize(grid.graphics.size + dim.x * dim.y);
-    grid.dim.z++;
+    grid.allocateLayer(type);
 }
 
 bool
@@ -138,6 +267,11 @@ AreaJSON::processDescriptor() noexcept {
 
     CHECK(processMapProperties(propertiesValue));
 
+    if (streamPath.size && (grid.loopX || grid.loopY)) {
+        logErr(descriptor, "A streamed area cannot loop");
+        return false;
+    }
+
     CHECK(tilesetsValue.toNode());
 
     for (JsonIterator tilesetNode = begin(tilesetsValue);
@@ -188,6 +322,12 @@ AreaJSON::processDescriptor() noexcept {
         }
     }
 
+    if (streamPath.size) {
+        Size n = grid.chunksDim.x * grid.chunksDim.y;
+        streamStates.resize(n);
+        memset(streamStates.data, STREAM_UNLOADED, n);
+    }
+
     return true;
 }
 
@@ -198,7 +338,8 @@ AreaJSON::processMapProperties(JsonValue obj) noexcept {
        "name": "Wooded Area"
        "music": "wind.oga",
        "loop": "xy",
-       "color_overlay": "255,255,255,127"
+       "color_overlay": "255,255,255,127",
+       "stream": "overworld"
      }
     */
 
@@ -206,10 +347,12 @@ AreaJSON::processMapProperties(JsonValue obj) noexcept {
     JsonValue musicValue = obj["music"];
     JsonValue loopValue = obj["loop"];
     JsonValue coloroverlayValue = obj["coloroverlay"];
+    JsonValue streamValue = obj["stream"];
 
     CHECK(musicValue.isString() || musicValue.isNull());
     CHECK(loopValue.isString() || loopValue.isNull());
     CHECK(coloroverlayValue.isString() || coloroverlayValue.isNull());
+    CHECK(streamValue.isString() || streamValue.isNull());
 
     if (!nameValue.isString())
         logErr(descriptor, "Area must have \"name\" property");
@@ -232,22 +375,16 @@ AreaJSON::processMapProperties(JsonValue obj) noexcept {
         colorOverlayARGB =
             (U32)(a << 24) + (U32)(r << 16) + (U32)(g << 8) + (U32)b;
     }
+    if (streamValue.isString()) {
+        // Chunk files are paged in from this directory as the viewport
+        // approaches them. See AreaJSON::processChunk().
+        streamPath = String() << dirname(descriptor) << streamValue.toString()
+                              << "/";
+    }
 
     return true;
 }
 
-/**
- * dirname
- *
- * Returns the directory component of a path, including trailing slash.  If
- * there is no directory component, return an empty string.
- */
-static StringView
-dirname(StringView path) noexcept {
-    StringPosition slash = path.rfind('/');
-    return slash == SV_NOT_FOUND ? "" : path.substr(0, slash + 1);
-}
-
 bool
 AreaJSON::processTileSet(JsonValue obj) noexcept {
     /*
@@ -509,7 +646,8 @@ AreaJSON::processLayer(JsonValue obj) noexcept {
     CHECK(widthValue.isNumber());
     CHECK(heightValue.isNumber());
     CHECK(propertiesValue.isObject() || propertiesValue.isNull());
-    CHECK(dataValue.isArray());
+    // The tiles of a streamed area are in its chunk files instead.
+    CHECK(dataValue.isArray() || (streamPath.size && dataValue.isNull()));
 
     const I32 x = widthValue.toInt();
     const I32 y = heightValue.toInt();
@@ -523,7 +661,8 @@ AreaJSON::processLayer(JsonValue obj) noexcept {
 
     if (propertiesValue.isObject())
         CHECK(processLayerProperties(propertiesValue));
-    CHECK(processLayerData(dataValue));
+    if (dataValue.isArray())
+        CHECK(processLayerData(dataValue));
 
     return true;
 }
@@ -550,16 +689,11 @@ AreaJSON::processLayerProperties(JsonValue obj) noexcept {
         return false;
     }
 
-    if (grid.depth2idx.contains(depth)) {
+    if (!grid.setLayerDepth(grid.dim.z - 1, depth)) {
         logErr(descriptor, "Layers cannot share a depth");
         return false;
     }
 
-    grid.depth2idx[depth] = grid.dim.z - 1;
-
-    // Effectively idx2depth[dim.z - 1] = depth;
-    grid.idx2depth.push(depth);
-
     return true;
 }
 
@@ -569,12 +703,12 @@ AreaJSON::processLayerData(JsonValue arr) noexcept {
      [9, 9, 9, ..., 3, 9, 9]
     */
 
-    const Size z = static_cast<Size>(grid.dim.z) - 1;
+    const I32 z = grid.dim.z - 1;
 
     // If we ever allow finding layers out of order.
     // assert_(0 <= z && z < dim.z);
 
-    Size x = 0, y = 0;
+    I32 x = 0, y = 0;
 
     for (JsonIterator node = begin(arr); node != end(arr); ++node) {
         CHECK(node->value.isNumber());
@@ -586,13 +720,16 @@ AreaJSON::processLayerData(JsonValue arr) noexcept {
             return false;
         }
 
-        Size idx = (z * grid.dim.y + y) * grid.dim.x + x;
+        CHECK(y < grid.dim.y);
 
         // A gid of zero means there is no tile at this
         // position on this layer.
-        grid.graphics[idx] = gid;
+        if (gid) {
+            ivec3 phys = {x, y, z};
+            grid.setTileType(phys, gid);
+        }
 
-        if (++x == static_cast<Size>(grid.dim.x)) {
+        if (++x == grid.dim.x) {
             x = 0;
             y++;
         }
@@ -620,10 +757,18 @@ AreaJSON::processObjectGroup(JsonValue obj) noexcept {
     if (propertiesValue.isObject())
         CHECK(processObjectGroupProperties(propertiesValue));
 
+    if (streamPath.size && begin(objectsValue) != end(objectsValue)) {
+        logErr(descriptor, "The objects of a streamed area go in its chunks");
+        return false;
+    }
+
+    const I32 z = grid.dim.z - 1;
+    icube bounds = {0, 0, z, grid.dim.x, grid.dim.y, z + 1};
+
     for (JsonIterator objectNode = begin(objectsValue);
          objectNode != end(objectsValue); ++objectNode) {
         CHECK(objectNode->value.isObject());
-        CHECK(processObject(objectNode->value));
+        CHECK(processObject(objectNode->value, z, bounds));
     }
 
     return true;
@@ -651,22 +796,19 @@ AreaJSON::processObjectGroupProperties(JsonValue obj) noexcept {
         return false;
     }
 
-    if (grid.depth2idx.contains(depth)) {
+    if (grid.findDepth(depth) != -1) {
         logErr(descriptor, "Layers cannot share a depth");
         return false;
     }
 
     allocateMapLayer(TileGrid::OBJECT_LAYER);
-    grid.depth2idx[depth] = grid.dim.z - 1;
-
-    // Effectively idx2depth[dim.z - 1] = depth;
-    grid.idx2depth.push(depth);
+    grid.setLayerDepth(grid.dim.z - 1, depth);
 
     return true;
 }
 
 bool
-AreaJSON::processObject(JsonValue obj) noexcept {
+AreaJSON::processObject(JsonValue obj, I32 z, const icube& bounds) noexcept {
     /*
      {
        "height": 16,
@@ -772,11 +914,6 @@ AreaJSON::processObject(JsonValue obj) noexcept {
         CHECK(layermodrightValue.isNull());
     }
 
-    const Size z = static_cast<Size>(grid.dim.z) - 1;
-
-    // If we ever allow finding layers out of order.
-    // assert_(0 <= z && z < dim.z);
-
     // Gather object properties now. Assign them to tiles later.
     bool wwide[5] = {}, hwide[5] = {};  // Wide exit in width or height.
 
@@ -891,13 +1028,13 @@ AreaJSON::processObject(JsonValue obj) noexcept {
     const I32 w = widthValue.toInt() / grid.tileDim.x;
     const I32 h = heightValue.toInt() / grid.tileDim.y;
 
-    CHECK(x + w <= grid.dim.x);
-    CHECK(y + h <= grid.dim.y);
+    CHECK(bounds.x1 <= x && x + w <= bounds.x2);
+    CHECK(bounds.y1 <= y && y + h <= bounds.y2);
 
     // We know which Tiles are being talked about now... yay
     for (I32 Y = y; Y < y + h; Y++) {
         for (I32 X = x; X < x + w; X++) {
-            ivec3 tile = {X, Y, static_cast<I32>(z)};
+            ivec3 tile = {X, Y, z};
 
             grid.flags[tile] |= flags;
             for (Size i = 0; i < EXITS_LENGTH; i++) {
@@ -1072,3 +1209,447 @@ AreaJSON::parseARGB(StringView str, U8& a, U8& r, U8& g, U8& b) noexcept {
 
     return true;
 }
+
+bool
+AreaJSON::processChunk(JsonValue obj, ivec2 chunk) noexcept {
+    /*
+     {
+       "layers": [
+         {"depth": "-0.5", "data": [9, 9, 9, ..., 3, 9, 9]},
+         {"depth": "0.0", "objects": [...]}
+       ],
+       "npcs": [
+         {"descriptor": "entities/deer/deer.json", "x": 40, "y": 37,
+          "depth": "0.0", "phase": "down"}
+       ]
+     }
+    */
+
+    JsonValue layersValue = obj["layers"];
+    JsonValue npcsValue = obj["npcs"];
+
+    CHECK(layersValue.isArray() || layersValue.isNull());
+    CHECK(npcsValue.isArray() || npcsValue.isNull());
+
+    icube bounds = chunkBounds(chunk);
+
+    if (layersValue.isArray()) {
+        for (JsonIterator layerNode = begin(layersValue);
+             layerNode != end(layersValue); ++layerNode) {
+            CHECK(layerNode->value.isObject());
+            CHECK(processChunkLayer(layerNode->value, chunk, bounds));
+        }
+    }
+
+    if (npcsValue.isArray()) {
+        ivec3 source = {chunk.x, chunk.y, 0};
+        for (JsonIterator npcNode = begin(npcsValue); npcNode != end(npcsValue);
+             ++npcNode, source.z++) {
+            CHECK(npcNode->value.isObject());
+            CHECK(processChunkNPC(npcNode->value, source, bounds));
+        }
+    }
+
+    paths.invalidate(bounds);
+
+    return true;
+}
+
+bool
+AreaJSON::processChunkLayer(JsonValue obj, ivec2 chunk,
+                            const icube& bounds) noexcept {
+    /*
+     {
+       "depth": "-0.5",
+       "data": [9, 9, 9, ..., 3, 9, 9]
+     }
+    */
+
+    JsonValue depthValue = obj["depth"];
+    JsonValue dataValue = obj["data"];
+    JsonValue objectsValue = obj["objects"];
+
+    CHECK(depthValue.isString());
+    CHECK(dataValue.isArray() || dataValue.isNull());
+    CHECK(objectsValue.isArray() || objectsValue.isNull());
+
+    String buf = depthValue.toString();
+    float depth;
+    I32 z = -1;
+    if (parseFloat(depth, buf))
+        z = grid.findDepth(depth);
+    if (z == -1) {
+        logErr(descriptor, String() << "Chunk " << chunk.x << "," << chunk.y
+                                    << " refers to a missing layer");
+        return false;
+    }
+
+    TileGrid::LayerType type = grid.layerTypes[(Size)z];
+
+    if (dataValue.isArray()) {
+        if (type != TileGrid::TILE_LAYER) {
+            logErr(descriptor, "Only tilelayers can hold tile data");
+            return false;
+        }
+
+        // The data covers the part of the chunk that is within the map.
+        I32 x = bounds.x1, y = bounds.y1;
+
+        for (JsonIterator node = begin(dataValue); node != end(dataValue);
+             ++node) {
+            CHECK(node->value.isNumber());
+            CHECK(y < bounds.y2);
+
+            U32 gid = node->value.toInt();
+
+            if (gid >= tileGraphics.size) {
+                logErr(descriptor, "Invalid tile gid");
+                return false;
+            }
+
+            if (gid) {
+                ivec3 phys = {x, y, z};
+                grid.setTileType(phys, gid);
+            }
+
+            if (++x == bounds.x2) {
+                x = bounds.x1;
+                y++;
+            }
+        }
+    }
+
+    if (objectsValue.isArray()) {
+        if (type != TileGrid::OBJECT_LAYER) {
+            logErr(descriptor, "Only objectgroups can hold objects");
+            return false;
+        }
+
+        for (JsonIterator objectNode = begin(objectsValue);
+             objectNode != end(objectsValue); ++objectNode) {
+            CHECK(objectNode->value.isObject());
+            CHECK(processObject(objectNode->value, z, bounds));
+        }
+    }
+
+    return true;
+}
+
+bool
+AreaJSON::processChunkNPC(JsonValue obj, ivec3 source,
+                          const icube& bounds) noexcept {
+    /*
+     {
+       "descriptor": "entities/deer/deer.json",
+       "x": 40,
+       "y": 37,
+       "depth": "0.0",
+       "phase": "down"
+     }
+    */
+
+    JsonValue descriptorValue = obj["descriptor"];
+    JsonValue xValue = obj["x"];
+    JsonValue yValue = obj["y"];
+    JsonValue depthValue = obj["depth"];
+    JsonValue phaseValue = obj["phase"];
+
+    CHECK(descriptorValue.isString());
+    CHECK(xValue.isNumber());
+    CHECK(yValue.isNumber());
+    CHECK(depthValue.isString());
+    CHECK(phaseValue.isString());
+
+    String buf = depthValue.toString();
+    vicoord coord;
+    coord.x = xValue.toInt();
+    coord.y = yValue.toInt();
+    CHECK(parseFloat(coord.z, buf));
+
+    CHECK(bounds.x1 <= coord.x && coord.x < bounds.x2);
+    CHECK(bounds.y1 <= coord.y && coord.y < bounds.y2);
+    CHECK(grid.findDepth(coord.z) != -1);
+
+    // Still around, either spawned or paged out with another chunk.
+    if (streamNPCs.contains(source))
+        return true;
+
+    // A descriptor that fails to load is logged by spawnNPC and skipped.
+    Character* c =
+        spawnNPC(descriptorValue.toString(), coord, phaseValue.toString());
+    if (!c)
+        return true;
+
+    StreamNPC* npc = new StreamNPC;
+    npc->source = source;
+    npc->character = c;
+    npc->next = 0;
+    streamNPCs[source] = npc;
+    streamSpawned[c] = npc;
+
+    return true;
+}
+
+String
+AreaJSON::chunkPath(ivec2 chunk) noexcept {
+    return String() << streamPath << chunk.x << "_" << chunk.y << ".json";
+}
+
+icube
+AreaJSON::chunkBounds(ivec2 chunk) noexcept {
+    I32 x = chunk.x << TILE_CHUNK_SHIFT;
+    I32 y = chunk.y << TILE_CHUNK_SHIFT;
+    icube bounds = {x,
+                    y,
+                    0,
+                    min(x + TILE_CHUNK_SIZE, grid.dim.x),
+                    min(y + TILE_CHUNK_SIZE, grid.dim.y),
+                    grid.dim.z};
+    return bounds;
+}
+
+static void
+streamRead(void* data) noexcept {
+    StreamJob* job = static_cast<StreamJob*>(data);
+
+    if (resourceExists(job->path))
+        job->doc = new JsonDocument(loadJson(job->path));
+
+    AreaJSON* area = job->area;
+    LockGuard lock(area->streamMutex);
+    area->streamFinished.push(job);
+    area->streamDone.notifyAll();
+}
+
+void
+AreaJSON::streamLoadNow(ivec2 chunk) noexcept {
+    String path = chunkPath(chunk);
+
+    if (resourceExists(path)) {
+        JsonDocument doc = loadJson(path);
+        if (!doc.ok || !processChunk(doc.root, chunk))
+            logErr(descriptor, String() << path << ": failed to load chunk");
+    }
+    streamRestoreNPCs(chunk);
+
+    streamStates[chunk.y * grid.chunksDim.x + chunk.x] = STREAM_LOADED;
+    redraw = true;
+}
+
+void
+AreaJSON::streamLoadAsync(ivec2 chunk) noexcept {
+    StreamJob* job = new StreamJob;
+    job->area = this;
+    job->chunk = chunk;
+    job->path = chunkPath(chunk);
+    job->doc = 0;
+
+    streamStates[chunk.y * grid.chunksDim.x + chunk.x] = STREAM_LOADING;
+
+    Function fn = {streamRead, job};
+    JobsEnqueue(fn);
+}
+
+void
+AreaJSON::streamWait(ivec2 chunk) noexcept {
+    while (streamStates[chunk.y * grid.chunksDim.x + chunk.x] ==
+           STREAM_LOADING) {
+        {
+            LockGuard lock(streamMutex);
+            while (streamFinished.size == 0)
+                streamDone.wait(lock);
+        }
+        streamCommit();
+    }
+}
+
+void
+AreaJSON::streamCommit() noexcept {
+    Vector<StreamJob*> finished;
+    {
+        LockGuard lock(streamMutex);
+        if (streamFinished.size == 0)
+            return;
+        finished = static_cast<Vector<StreamJob*>&&>(streamFinished);
+    }
+
+    for (StreamJob** job_ = finished.begin(); job_ != finished.end(); job_++) {
+        StreamJob* job = *job_;
+        ivec2 chunk = job->chunk;
+        U8& state = streamStates[chunk.y * grid.chunksDim.x + chunk.x];
+
+        if (state == STREAM_LOADING) {
+            JsonDocument* doc = job->doc;
+            if (doc && (!doc->ok || !processChunk(doc->root, chunk)))
+                logErr(descriptor,
+                       String() << job->path << ": failed to load chunk");
+            streamRestoreNPCs(chunk);
+            state = STREAM_LOADED;
+            redraw = true;
+        }
+        else {
+            assert_(state == STREAM_CANCELLED);
+            state = STREAM_UNLOADED;
+        }
+
+        delete job->doc;
+        delete job;
+    }
+}
+
+void
+AreaJSON::streamUnload(ivec2 chunk) noexcept {
+    icube bounds = chunkBounds(chunk);
+
+    // Characters standing in the chunk are paged out with it. Those from
+    // chunk files are kept to be spawned again when it is paged back in.
+    for (Character** character = characters.begin();
+         character != characters.end(); character++) {
+        Character* c = *character;
+        if (c->isDead())
+            continue;
+
+        ivec3 tile = c->getTileCoords_i();
+        if (tile.x < bounds.x1 || bounds.x2 <= tile.x || tile.y < bounds.y1 ||
+            bounds.y2 <= tile.y)
+            continue;
+
+        StreamNPC** npc_ = streamSpawned.tryAt(c);
+        if (npc_) {
+            StreamNPC* npc = *npc_;
+            npc->character = 0;
+            npc->descriptor = c->descriptor;
+            npc->coord = c->getTileCoords_vi();
+            npc->phase = c->phaseName;
+            streamSpawned.erase(c);
+            StreamNPC*& pagedOut = streamPagedOut[chunk];
+            npc->next = pagedOut;
+            pagedOut = npc;
+        }
+
+        c->destroy();
+    }
+
+    grid.clearChunk(chunk);
+    paths.invalidate(bounds);
+
+    streamStates[chunk.y * grid.chunksDim.x + chunk.x] = STREAM_UNLOADED;
+    redraw = true;
+}
+
+void
+AreaJSON::streamRestoreNPCs(ivec2 chunk) noexcept {
+    StreamNPC** pagedOut = streamPagedOut.tryAt(chunk);
+    if (!pagedOut)
+        return;
+
+    StreamNPC* next;
+    for (StreamNPC* npc = *pagedOut; npc; npc = next) {
+        next = npc->next;
+        Character* c = spawnNPC(npc->descriptor, npc->coord, npc->phase);
+        if (!c) {
+            // Spawned from the file again when its chunk is next loaded.
+            streamNPCs.erase(npc->source);
+            delete npc;
+            continue;
+        }
+
+        npc->character = c;
+        npc->descriptor = String();
+        npc->phase = String();
+        npc->next = 0;
+        streamSpawned[c] = npc;
+    }
+
+    streamPagedOut.erase(chunk);
+}
+
+void
+AreaJSON::characterRemoved(Character* c) noexcept {
+    StreamNPC** npc_ = streamSpawned.tryAt(c);
+    if (!npc_)
+        return;
+
+    // Dead, so spawned from the file again when its chunk is next loaded.
+    StreamNPC* npc = *npc_;
+    streamSpawned.erase(c);
+    streamNPCs.erase(npc->source);
+    delete npc;
+}
+
+void
+AreaJSON::streamTick() noexcept {
+    if (!streamPath.size)
+        return;
+
+    streamCommit();
+
+    icube tiles = visibleTiles();
+    if (tiles.x1 >= tiles.x2 || tiles.y1 >= tiles.y2)
+        return;
+
+    // Chunks on screen, inclusive.
+    I32 vx1 = tiles.x1 >> TILE_CHUNK_SHIFT;
+    I32 vy1 = tiles.y1 >> TILE_CHUNK_SHIFT;
+    I32 vx2 = (tiles.x2 - 1) >> TILE_CHUNK_SHIFT;
+    I32 vy2 = (tiles.y2 - 1) >> TILE_CHUNK_SHIFT;
+
+    I32 radius = confStreamRadius;
+
+    // Page out chunks more than one chunk beyond the load radius, so that
+    // walking back and forth over a chunk boundary doesn't thrash.
+    for (Size i = 0; i < streamResident.size;) {
+        ivec2 chunk = streamResident[i];
+        if (vx1 - radius - 1 <= chunk.x && chunk.x <= vx2 + radius + 1 &&
+            vy1 - radius - 1 <= chunk.y && chunk.y <= vy2 + radius + 1) {
+            i++;
+            continue;
+        }
+
+        U8& state = streamStates[chunk.y * grid.chunksDim.x + chunk.x];
+        if (state == STREAM_LOADED)
+            streamUnload(chunk);
+        else
+            // Dropped by streamCommit() when the worker finishes.
+            state = STREAM_CANCELLED;
+
+        streamResident.eraseUnordered(i);
+    }
+
+    // Page in chunks within the load radius. Chunks on screen are needed
+    // right away, the rest are read ahead by workers.
+    I32 x1 = max(vx1 - radius, 0);
+    I32 y1 = max(vy1 - radius, 0);
+    I32 x2 = min(vx2 + radius, grid.chunksDim.x - 1);
+    I32 y2 = min(vy2 + radius, grid.chunksDim.y - 1);
+
+    for (I32 y = y1; y <= y2; y++) {
+        for (I32 x = x1; x <= x2; x++) {
+            ivec2 chunk = {x, y};
+            bool visible = vx1 <= x && x <= vx2 && vy1 <= y && y <= vy2;
+
+            U8& state = streamStates[y * grid.chunksDim.x + x];
+            switch (state) {
+            case STREAM_UNLOADED:
+                streamResident.push(chunk);
+                if (visible)
+                    streamLoadNow(chunk);
+                else
+                    streamLoadAsync(chunk);
+                break;
+            case STREAM_CANCELLED:
+                // Still in flight. Want it again.
+                streamResident.push(chunk);
+                state = STREAM_LOADING;
+                if (visible)
+                    streamWait(chunk);
+                break;
+            case STREAM_LOADING:
+                if (visible)
+                    streamWait(chunk);
+                break;
+            case STREAM_LOADED: break;
+            }
+        }
+    }
+}
@@ -17,18 +17,39 @@
 #include "util/algorithm.h"
 #include "util/assert.h"
 #include "util/compiler.h"
+#include "util/jobs.h"
 #include "util/math2.h"
 
+// Number of draws a baked chunk stays in memory after it was last on screen.
+#define TILE_BAKE_KEEP 120
+
+// Number of steps worked out by each job in moveCharacters().
+#define MOVE_CHUNK 256
+
+// Cleared once imageBake() shows that the backend cannot bake tiles.
+static bool canBake = true;
+
 Area::Area() noexcept
-    : ok(true),
+    : entityGrid(grid),
+      paths(grid, entityGrid),
+      ok(true),
+      background(false),
+      drawCount(0),
+      deferring(false),
       beenFocused(false),
       redraw(true),
       colorOverlayARGB(0),
       dataArea(0),
-      player(0) { }
+      player(0) {
+    drawnOffset.x = drawnOffset.y = 0.0f;
+    drawnScale.x = drawnScale.y = 0.0f;
+}
 
 void
 Area::focus() noexcept {
+    // The screen still shows the previous Area.
+    redraw = true;
+
     if (!beenFocused) {
         beenFocused = true;
         if (dataArea)
@@ -114,12 +135,29 @@ Area::draw(DisplayList* display) noexcept {
         }
     }
 
+    drawCount++;
+    pruneBakes();
+
+    if (!redraw && !scrolled())
+        for (Size i = 0; i < damage.size; i++)
+            display->damage.push(damage[i]);
+    damage.clear();
+
+    drawnOffset = viewportGetMapOffset();
+    drawnScale = viewportGetScale();
     redraw = false;
 }
 
+bool
+Area::scrolled() noexcept {
+    return !(viewportGetMapOffset() == drawnOffset) ||
+           !(viewportGetScale() == drawnScale);
+}
+
 bool
 Area::needsRedraw() noexcept {
-    if (redraw)
+    // Scrolling moves everything on screen.
+    if (redraw || scrolled())
         return true;
 
     icube tiles = visibleTiles();
@@ -128,47 +166,65 @@ Area::needsRedraw() noexcept {
         tiles.x2 * grid.tileDim.x, tiles.y2 * grid.tileDim.y, tiles.z2,
     };
 
-    if (player->needsRedraw(pixels))
-        return true;
-    for (Character** character = characters.begin();
-         character != characters.end(); character++) {
-        if ((*character)->needsRedraw(pixels))
-            return true;
-    }
-    for (Overlay** overlay = overlays.begin(); overlay != overlays.end();
-         overlay++) {
-        if ((*overlay)->needsRedraw(pixels))
-            return true;
+    bool changed = damage.size > 0;
+
+    if (player->needsRedraw(pixels, damage))
+        changed = true;
+
+    // Only entities filed near the screen can be on it.
+    icube cells = entityGrid.cellsFor(tiles);
+    for (I32 z = cells.z1; z < cells.z2; z++) {
+        for (I32 y = cells.y1; y < cells.y2; y++) {
+            for (I32 x = cells.x1; x < cells.x2; x++) {
+                EntityCell& cell = entityGrid.cellAt(x, y, z);
+                for (Character** character = cell.characters.begin();
+                     character != cell.characters.end(); character++) {
+                    if (*character != player &&
+                        (*character)->needsRedraw(pixels, damage))
+                        changed = true;
+                }
+                for (Overlay** overlay = cell.overlays.begin();
+                     overlay != cell.overlays.end(); overlay++) {
+                    if ((*overlay)->needsRedraw(pixels, damage))
+                        changed = true;
+                }
+            }
+        }
     }
 
-    // Do any on-screen tile types need to update their animations?
-    if (tileGraphics.size > checkedForAnimation.size)
-        checkedForAnimation.resize(tileGraphics.size);
-    memset(checkedForAnimation.data, 0, checkedForAnimation.size);
-
-    Time now = worldTime();
+    // Damage every on-screen tile whose animation switched frames.
+    I32 rowWidth = tiles.x2 - tiles.x1;
+    if (static_cast<Size>(rowWidth) > tileRow.size)
+        tileRow.resize(rowWidth);
 
     for (I32 z = tiles.z1; z < tiles.z2; z++) {
         if (grid.layerTypes[z] != TileGrid::TILE_LAYER)
             continue;
         for (I32 y = tiles.y1; y < tiles.y2; y++) {
-            for (I32 x = tiles.x1; x < tiles.x2; x++) {
-                ivec3 coord = {x, y, z};
-                I32 type = grid.getTileType(coord);
+            ivec3 start = {tiles.x1, y, z};
+            grid.getTileRow(start, rowWidth, tileRow.data);
 
-                if (type == 0)
-                    continue;
+            for (I32 i = 0; i < rowWidth; i++) {
+                U32 type = tileRow.data[i];
 
-                if (checkedForAnimation[type])
+                if (type == 0)
                     continue;
-                checkedForAnimation[type] = true;
 
-                if (tileGraphics[type].needsRedraw(now))
-                    return true;
+                if (tileGraphics[type].needsRedraw()) {
+                    I32 x = tiles.x1 + i;
+                    irect tile = {
+                        x * grid.tileDim.x,
+                        y * grid.tileDim.y,
+                        (x + 1) * grid.tileDim.x,
+                        (y + 1) * grid.tileDim.y,
+                    };
+                    damage.push(tile);
+                    changed = true;
+                }
             }
         }
     }
-    return false;
+    return changed;
 }
 
 void
@@ -176,19 +232,36 @@ Area::requestRedraw() noexcept {
     redraw = true;
 }
 
+void
+Area::requestRedraw(irect pixels) noexcept {
+    if (pixels.x1 != pixels.x2)
+        damage.push(pixels);
+}
+
 static bool
 isCharacterDead(Character* c) noexcept {
     bool dead = c->isDead();
     if (dead) {
+        Area* area = c->getArea();
         vicoord coord = {0, 0, 0.0};
         c->setArea(0, coord);
+        if (area) {
+            area->characterRemoved(c);
+            area->motions.release(c->motion);
+            c->motion = 0;
+        }
     }
     return dead;
 }
 
 static bool
 isOverlayDead(Overlay* o) noexcept {
-    return o->isDead();
+    bool dead = o->isDead();
+    if (dead) {
+        o->getArea()->motions.release(o->motion);
+        o->motion = 0;
+    }
+    return dead;
 }
 
 void
@@ -196,23 +269,43 @@ Area::tick(Time dt) noexcept {
     if (dataArea)
         dataArea->tick(dt);
 
-    for (Overlay** overlay = overlays.begin(); overlay != overlays.end();
-         overlay++) {
-        (*overlay)->tick(dt);
-    }
-    erase_if(overlays, isOverlayDead);
+    U32 step = worldSteps();
 
-    if (confMoveMode != TURN) {
+    if (confMoveMode != TURN && motionStep(*player->motion, dt, step))
         player->tick(dt);
 
-        for (Character** character = characters.begin();
-             character != characters.end(); character++) {
-            (*character)->tick(dt);
-        }
-        erase_if(characters, isCharacterDead);
-    }
+    tickEntities(dt, confTickParallel);
 
     viewportTick(dt);
+    streamTick();
+}
+
+void
+Area::backgroundTick(Time dt) noexcept {
+    background = true;
+    tickEntities(dt, true);
+    background = false;
+
+    // Focusing the Area again redraws all of it.
+    damage.clear();
+}
+
+void
+Area::tickEntities(Time dt, bool parallel) noexcept {
+    // Move everything at once, then visit only the Entities that have more
+    // to do.
+    motions.step(dt, worldSteps(), awake, parallel);
+    deferring = true;
+    for (Entity** entity = awake.begin(); entity != awake.end(); entity++)
+        (*entity)->tick(dt);
+    awake.clear();
+    deferring = false;
+
+    moveCharacters(parallel);
+
+    erase_if(overlays, isOverlayDead);
+    if (confMoveMode != TURN)
+        erase_if(characters, isCharacterDead);
 }
 
 void
@@ -229,6 +322,56 @@ Area::turn() noexcept {
     erase_if(characters, isCharacterDead);
 
     viewportTurn();
+    streamTick();
+}
+
+void
+Area::streamTick() noexcept { }
+
+void
+Area::characterRemoved(Character*) noexcept { }
+
+bool
+Area::deferMove(Character* c) noexcept {
+    if (!deferring)
+        return false;
+    movers.push(c);
+    return true;
+}
+
+void
+Area::proposeMoves(void* data, U32 i) noexcept {
+    Area* self = static_cast<Area*>(data);
+    U32 end = min((i + 1) * MOVE_CHUNK, static_cast<U32>(self->movers.size));
+
+    for (U32 j = i * MOVE_CHUNK; j < end; j++)
+        self->movers[j]->proposePathStep(self->moves[j]);
+}
+
+void
+Area::moveCharacters(bool parallel) noexcept {
+    if (!movers.size)
+        return;
+
+    // Working out a step only reads the Area. Making one checks that its
+    // tile is still free and works it out again if an earlier one got in its
+    // way, so the moves come out the same however they were worked out.
+    moves.resize(movers.size);
+    U32 chunks = static_cast<U32>((movers.size + MOVE_CHUNK - 1) / MOVE_CHUNK);
+    if (parallel) {
+        JobsFor(proposeMoves, this, chunks);
+    }
+    else {
+        for (U32 i = 0; i < chunks; i++)
+            proposeMoves(this, i);
+    }
+
+    for (Size i = 0; i < movers.size; i++) {
+        Character* c = movers[i];
+        if (c->area == this && !c->isDead())
+            c->followPath(&moves[i]);
+    }
+    movers.clear();
 }
 
 
@@ -280,7 +423,10 @@ Area::visibleTiles() noexcept {
 
 bool
 Area::inBounds(Entity* ent) noexcept {
-    return grid.inBounds(ent->getPixelCoord());
+    fvec3 r = ent->getPixelCoord();
+    ivec3 phys = {static_cast<I32>(r.x) / grid.tileDim.x,
+                  static_cast<I32>(r.y) / grid.tileDim.y, ent->layer};
+    return grid.inBounds(phys);
 }
 
 
@@ -288,8 +434,10 @@ Character*
 Area::spawnNPC(StringView descriptor_, vicoord coord,
                StringView phase) noexcept {
     Character* c = new Character;
+    c->motion = motions.allocate(c);
     if (!c->init(descriptor_, phase)) {
         logErr("Area", String() << "Failed to load entity " << descriptor_);
+        motions.release(c->motion);
         delete c;
         return 0;
     }
@@ -302,8 +450,10 @@ Overlay*
 Area::spawnOverlay(StringView descriptor_, vicoord coord,
                    StringView phase) noexcept {
     Overlay* o = new Overlay;
+    o->motion = motions.allocate(o);
     if (!o->init(descriptor_, phase)) {
         logErr("Area", String() << "Failed to load entity " << descriptor_);
+        motions.release(o->motion);
         delete o;
         return 0;
     }
@@ -327,19 +477,98 @@ Area::runScript(TileGrid::ScriptType type, ivec3 tile,
         (*script)(dataArea, triggeredBy, tile);
 }
 
+void
+Area::setTileFlags(ivec3 tile, U32 flags) noexcept {
+    if (flags)
+        grid.flags[tile] = flags;
+    else if (grid.flags.contains(tile))
+        grid.flags.erase(tile);
+    paths.invalidate(tile);
+}
+
 
 void
 Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
+    if (!canBake) {
+        drawTileRange(display, tiles, z);
+        return;
+    }
+
+    if (tileBakes.size != grid.chunks.size)
+        tileBakes.resize(grid.chunks.size);
+
     Vector<DisplayItem>& items = display->items;
 
-    Time now = worldTime();
+    float depth = grid.idx2depth[(Size)z];
+
+    I32 width = grid.tileDim.x;
+    I32 height = grid.tileDim.y;
+
+    I32 cx1 = tiles.x1 >> TILE_CHUNK_SHIFT;
+    I32 cy1 = tiles.y1 >> TILE_CHUNK_SHIFT;
+    I32 cx2 = ((tiles.x2 - 1) >> TILE_CHUNK_SHIFT) + 1;
+    I32 cy2 = ((tiles.y2 - 1) >> TILE_CHUNK_SHIFT) + 1;
 
-    // FIXME: Same.
-    if (tileGraphics.size > tilesAnimated.size)
-        tilesAnimated.resize(tileGraphics.size);
+    for (I32 cy = cy1; cy < cy2; cy++) {
+        for (I32 cx = cx1; cx < cx2; cx++) {
+            Size i = (z * grid.chunksDim.y + cy) * grid.chunksDim.x + cx;
+            TileChunk& chunk = grid.chunks[i];
+            if (chunk.used == 0)
+                continue;
+
+            ivec2 c = {cx, cy};
+            TileBake& bake = tileBakes[i];
+            bool baked = true;
+            if (!bake.valid || bake.version != chunk.version)
+                baked = bakeChunk(bake, c, z);
+
+            I32 x0 = cx << TILE_CHUNK_SHIFT;
+            I32 y0 = cy << TILE_CHUNK_SHIFT;
+
+            if (!canBake || !baked) {
+                // The backend just refused, or the chunk's tiles are still on
+                // their way. Draw this chunk the slow way.
+                icube part = {max(x0, tiles.x1),
+                              max(y0, tiles.y1),
+                              z,
+                              min(x0 + TILE_CHUNK_SIZE, tiles.x2),
+                              min(y0 + TILE_CHUNK_SIZE, tiles.y2),
+                              z + 1};
+                drawTileRange(display, part, z);
+                continue;
+            }
 
-    // FIXME: Only do this once per draw() call. Don't do it per drawTiles.
-    memset(tilesAnimated.data, 0, tilesAnimated.size);
+            bake.lastDrawn = drawCount;
+
+            if (IMAGE_VALID(bake.image)) {
+                fvec3 drawPos = {float(x0 * width), float(y0 * height),
+                                 depth};
+                DisplayItem item = {bake.image, drawPos};
+                items.push(item);
+            }
+
+            for (U16* offset = bake.animated.begin();
+                 offset != bake.animated.end(); offset++) {
+                I32 x = x0 + (*offset & TILE_CHUNK_MASK);
+                I32 y = y0 + (*offset >> TILE_CHUNK_SHIFT);
+                if (x < tiles.x1 || tiles.x2 <= x || y < tiles.y1 ||
+                    tiles.y2 <= y)
+                    continue;
+
+                ivec3 phys = {x, y, z};
+                U32 type = grid.getTileType(phys);
+
+                fvec3 drawPos = {float(x * width), float(y * height), depth};
+                DisplayItem item = {tileGraphics[type].getFrame(), drawPos};
+                items.push(item);
+            }
+        }
+    }
+}
+
+void
+Area::drawTileRange(DisplayList* display, icube tiles, I32 z) noexcept {
+    Vector<DisplayItem>& items = display->items;
 
     Size maxTiles = (tiles.y2 - tiles.y1) * (tiles.x2 - tiles.x1);
     Size itemCount = items.size;
@@ -353,11 +582,17 @@ Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
     I32 width = grid.tileDim.x;
     I32 height = grid.tileDim.y;
 
+    I32 rowWidth = tiles.x2 - tiles.x1;
+    if (static_cast<Size>(rowWidth) > tileRow.size)
+        tileRow.resize(rowWidth);
+
     for (I32 y = tiles.y1; y < tiles.y2; y++) {
+        // We are certain the Tiles exist.
+        ivec3 start = {tiles.x1, y, z};
+        grid.getTileRow(start, rowWidth, tileRow.data);
+
         for (I32 x = tiles.x1; x < tiles.x2; x++) {
-            // We are certain the Tile exists.
-            ivec3 coord = {x, y, z};
-            U32 type = grid.getTileType(coord);
+            U32 type = tileRow.data[x - tiles.x1];
 
             if (type == 0)
                 continue;
@@ -365,11 +600,6 @@ Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
             if (tileGraphics[type].id == NO_ANIMATION)
                 continue;
 
-            if (!tilesAnimated[type]) {
-                tilesAnimated[type] = true;
-                tileGraphics[type].setFrame(now);
-            }
-
             // Image guaranteed to exist because Animation won't hold a null
             // ImageID.
             Image img = tileGraphics[type].getFrame();
@@ -385,22 +615,120 @@ Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
     items.size = itemCount;
 }
 
+bool
+Area::bakeChunk(TileBake& bake, ivec2 chunk, I32 z) noexcept {
+    Size i = (z * grid.chunksDim.y + chunk.y) * grid.chunksDim.x + chunk.x;
+    TileChunk& tiles = grid.chunks[i];
+
+    if (IMAGE_VALID(bake.image))
+        imageBakeRelease(bake.image);
+    bake.image.texture = 0;
+    bake.animated.clear();
+    bakeItems.clear();
+
+    I32 x1 = chunk.x << TILE_CHUNK_SHIFT;
+    I32 y1 = chunk.y << TILE_CHUNK_SHIFT;
+    I32 x2 = min(x1 + TILE_CHUNK_SIZE, grid.dim.x);
+    I32 y2 = min(y1 + TILE_CHUNK_SIZE, grid.dim.y);
+
+    I32 width = grid.tileDim.x;
+    I32 height = grid.tileDim.y;
+
+    I32 rowWidth = x2 - x1;
+    if (static_cast<Size>(rowWidth) > tileRow.size)
+        tileRow.resize(rowWidth);
+
+    for (I32 y = y1; y < y2; y++) {
+        ivec3 start = {x1, y, z};
+        grid.getTileRow(start, rowWidth, tileRow.data);
+
+        for (I32 x = x1; x < x2; x++) {
+            U32 type = tileRow.data[x - x1];
+
+            if (type == 0)
+                continue;
+
+            Animation& graphic = tileGraphics[type];
+            if (graphic.id == NO_ANIMATION)
+                continue;
+
+            if (graphic.isAnimated()) {
+                bake.animated.push(static_cast<U16>(
+                    ((y - y1) << TILE_CHUNK_SHIFT) | (x - x1)));
+                continue;
+            }
+
+            BakeItem item = {graphic.getFrame(), float((x - x1) * width),
+                             float((y - y1) * height)};
+            bakeItems.push(item);
+        }
+    }
+
+    // A baked image is kept as it is, so tiles baked before their pixels
+    // arrive would stay blank.
+    for (BakeItem* item = bakeItems.begin(); item != bakeItems.end(); item++)
+        if (!imageReady(item->image))
+            return false;
+
+    if (bakeItems.size) {
+        bake.image = imageBake(static_cast<U32>(rowWidth * width),
+                               static_cast<U32>((y2 - y1) * height),
+                               bakeItems.data, bakeItems.size);
+        if (!IMAGE_VALID(bake.image))
+            canBake = false;
+    }
+
+    if (!bake.valid)
+        residentBakes.push(static_cast<U32>(i));
+    bake.valid = true;
+    bake.version = tiles.version;
+    return true;
+}
+
 void
-Area::drawEntities(DisplayList* display, icube& tiles, I32 z) noexcept {
-    float depth = grid.idx2depth[(Size)z];
+Area::pruneBakes() noexcept {
+    for (Size i = 0; i < residentBakes.size;) {
+        TileBake& bake = tileBakes[residentBakes[i]];
+        if (drawCount - bake.lastDrawn <= TILE_BAKE_KEEP) {
+            i++;
+            continue;
+        }
 
-    for (Character** character = characters.begin();
-         character != characters.end(); character++) {
-        if ((*character)->getTileCoords_i().z == z)
-            (*character)->draw(display);
+        if (IMAGE_VALID(bake.image))
+            imageBakeRelease(bake.image);
+        bake.image.texture = 0;
+        bake.animated.clear();
+        bake.valid = false;
+        residentBakes.eraseUnordered(i);
+    }
+}
+
+void
+Area::drawEntities(DisplayList* display, icube& tiles, I32 z) noexcept {
+    icube cells = entityGrid.cellsFor(tiles);
+
+    for (I32 y = cells.y1; y < cells.y2; y++) {
+        for (I32 x = cells.x1; x < cells.x2; x++) {
+            Vector<Character*>& characters =
+                entityGrid.cellAt(x, y, z).characters;
+            for (Character** character = characters.begin();
+                 character != characters.end(); character++) {
+                if (*character != player)
+                    (*character)->draw(display);
+            }
+        }
     }
 
-    for (Overlay** overlay = overlays.begin(); overlay != overlays.end();
-         overlay++) {
-        if ((*overlay)->getPixelCoord().z == depth)
-            (*overlay)->draw(display);
+    for (I32 y = cells.y1; y < cells.y2; y++) {
+        for (I32 x = cells.x1; x < cells.x2; x++) {
+            Vector<Overlay*>& overlays = entityGrid.cellAt(x, y, z).overlays;
+            for (Overlay** overlay = overlays.begin();
+                 overlay != overlays.end(); overlay++) {
+                (*overlay)->draw(display);
+            }
+        }
     }
 
-    if (player->getTileCoords_i().z == z)
+    if (player->indexTile.z == z)
         player->draw(display);
 }
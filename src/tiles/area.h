@@ -2,6 +2,10 @@
 #define SRC_TILES_AREA_H_
 
 #include "tiles/animation.h"
+#include "tiles/entity-grid.h"
+#include "tiles/images.h"
+#include "tiles/motion.h"
+#include "tiles/pathfinder.h"
 #include "tiles/tile-grid.h"
 #include "tiles/tile.h"
 #include "tiles/vec.h"
@@ -31,6 +35,28 @@ class Player;
     The viewport will not scroll past the edge of an Area. (At least as of
     June 2012. :)
 */
+// A chunk of a tile layer drawn ahead of time with imageBake(). Tiles with a
+// single frame are baked, and animated tiles are drawn over it every frame.
+struct TileBake {
+    TileBake() noexcept : valid(false), version(0), lastDrawn(0) {
+        image.texture = 0;
+    }
+
+    // Invalid if the chunk has no single-frame tiles.
+    Image image;
+
+    // Whether the fields below describe the chunk at TileChunk::version.
+    bool valid;
+    U32 version;
+
+    // Value of Area::drawCount when the bake was last drawn.
+    U32 lastDrawn;
+
+    // Offsets within the chunk of its animated tiles, as y * TILE_CHUNK_SIZE
+    // + x.
+    Vector<U16> animated;
+};
+
 class Area {
  public:
     Area() noexcept;
@@ -50,12 +76,17 @@ class Area {
     draw(DisplayList* display) noexcept;
 
     //! If false, drawing might be skipped. Saves CPU cycles when idle.
+    //! If true, the next draw() tells the DisplayList which parts of the
+    //! screen changed, unless they all did.
     bool
     needsRedraw() noexcept;
 
     //! Inform the Area that a redraw is needed.
     void
     requestRedraw() noexcept;
+    //! Inform the Area that a part of it, in pixels, needs to be redrawn.
+    void
+    requestRedraw(irect pixels) noexcept;
 
     /**
      * Update the game state within this Area as if dt milliseconds had
@@ -65,6 +96,13 @@ class Area {
     void
     tick(Time dt) noexcept;
 
+    //! Move the Entities in this Area while another is focused. Nothing is
+    //! drawn, footsteps are not heard, and its DataArea is left alone, since
+    //! its scripts expect their Area to be on screen. A Character takes at most a step
+    //! per call, so those that would take more fall behind.
+    void
+    backgroundTick(Time dt) noexcept;
+
     /**
      * Updates Entities, runs scripts, and checks for Tile animation
      * updates.
@@ -100,15 +138,41 @@ class Area {
     DataArea*
     getDataArea() noexcept;
 
+    //! Called as a dead Character is taken out of the Area.
+    virtual void
+    characterRemoved(Character* c) noexcept;
+
     void
     runScript(TileGrid::ScriptType type, ivec3 tile,
               Entity* triggeredBy) noexcept;
 
+    // Replace the TILE_NOWALK* flags on a tile. Zero removes them.
+    void
+    setTileFlags(ivec3 tile, U32 flags) noexcept;
+
+    //! During tick(), take a Character's next step on its path later, along
+    //! with everyone else's. Returns false if it should take it now.
+    bool
+    deferMove(Character* c) noexcept;
+
  public:
     TileGrid grid;
 
+    // Characters and Overlays filed by the tile they are on.
+    EntityGrid entityGrid;
+
+    // Where the Characters and Overlays spawned here are and where they are
+    // going.
+    Motions motions;
+
+    // Routes for Characters. Told whenever the walkability of tiles changes.
+    PathFinder paths;
+
     bool ok;
 
+    // True during backgroundTick().
+    bool background;
+
  protected:
     //! Calculate frame to show for each type of tile
     void
@@ -116,18 +180,69 @@ class Area {
     void
     drawEntities(DisplayList* display, icube& tiles, I32 z) noexcept;
 
+    //! Whether the viewport moved or zoomed since the last draw().
+    bool
+    scrolled() noexcept;
+
+    //! Draw tiles one at a time, for backends that cannot bake.
+    void
+    drawTileRange(DisplayList* display, icube tiles, I32 z) noexcept;
+    //! Returns false if the chunk's tiles have not all arrived, in which case
+    //! it is left to be baked on a later draw.
+    bool
+    bakeChunk(TileBake& bake, ivec2 chunk, I32 z) noexcept;
+    //! Free baked chunks that have not been drawn in a while.
+    void
+    pruneBakes() noexcept;
+
+    //! Page parts of the map in and out around the viewport. Called once per
+    //! tick or turn. Areas that are loaded whole do nothing.
+    virtual void
+    streamTick() noexcept;
+
+    //! The part of tick() that backgroundTick() shares.
+    void
+    tickEntities(Time dt, bool parallel) noexcept;
+
+    //! Take the steps put off by deferMove(). They are worked out all at
+    //! once, then made in order.
+    void
+    moveCharacters(bool parallel) noexcept;
+    static void
+    proposeMoves(void* data, U32 i) noexcept;
+
  protected:
     Hashmap<String, TileSet> tileSets;
 
     Vector<Animation> tileGraphics;
-    Vector<bool> checkedForAnimation;
-    Vector<bool> tilesAnimated;
+
+    // Scratch space for one row of tile types while scanning the grid.
+    Vector<U32> tileRow;
+
+    // Indexed like TileGrid::chunks. Empty until first drawn.
+    Vector<TileBake> tileBakes;
+    // Indices of the valid ones, which are all that pruneBakes() looks at.
+    Vector<U32> residentBakes;
+    Vector<BakeItem> bakeItems;
+    U32 drawCount;
 
     Vector<Character*> characters;
     Vector<Overlay*> overlays;
+    // Scratch space for the Entities that need ticking this tick.
+    Vector<Entity*> awake;
+    // Characters with a step to take this tick, and the steps.
+    Vector<Character*> movers;
+    Vector<MoveProposal> moves;
+    bool deferring;
 
     bool beenFocused;
     bool redraw;
+
+    // Pixels that changed since the last draw(), when not everything did.
+    Vector<irect> damage;
+    // Viewport at the last draw().
+    fvec2 drawnOffset;
+    fvec2 drawnScale;
     U32 colorOverlayARGB;
 
     DataArea* dataArea;
@@ -1,5 +1,6 @@
 #include "tiles/character.h"
 
+#include "os/c.h"
 #include "tiles/area.h"
 #include "tiles/client-conf.h"
 #include "tiles/sounds.h"
@@ -9,28 +10,34 @@
 Character::Character() noexcept
     : nowalkFlags(TILE_NOWALK | TILE_NOWALK_NPC),
       nowalkExempt(0),
-      destExit(0) {
+      destExit(0),
+      pathNext(0) {
     fromCoord.x = 0.0;
     fromCoord.y = 0.0;
     fromCoord.z = 0.0;
+    pathGoal = IVEC3_MIN;
     enterTile();
 }
 
 void
 Character::tick(Time dt) noexcept {
-    Entity::tick(dt);
-
     switch (confMoveMode) {
     case TURN:
         // Characters don't do anything on tick() for TURN mode.
         break;
-    case TILE: moveTowardDestination(dt); break;
+    case TILE:
+        // Movement happened in the Area's pass over its Motions.
+        Entity::tick(dt);
+        followPath();
+        break;
     case NOTILE: assert_(false && "not implemented"); break;
     }
 }
 
 void
-Character::turn() noexcept { }
+Character::turn() noexcept {
+    followPath();
+}
 
 void
 Character::destroy() noexcept {
@@ -40,73 +47,129 @@ Character::destroy() noexcept {
 
 ivec3
 Character::getTileCoords_i() noexcept {
-    return area->grid.virt2phys(r);
+    fvec3 r = motion->r;
+    ivec3 phys = {static_cast<I32>(r.x) / area->grid.tileDim.x,
+                  static_cast<I32>(r.y) / area->grid.tileDim.y, layer};
+    return phys;
 }
 
 vicoord
 Character::getTileCoords_vi() noexcept {
-    return area->grid.virt2virt(r);
+    return area->grid.virt2virt(motion->r);
 }
 
 void
 Character::setTileCoords(I32 x, I32 y) noexcept {
     leaveTile();
+    area->requestRedraw(drawnPixels);
     redraw = true;
-    vicoord virt = {x, y, r.z};
-    r = area->grid.virt2virt(virt);
+    vicoord virt = {x, y, motion->r.z};
+    motion->r = area->grid.virt2virt(virt);
+    motion->prevR = motion->r;
     enterTile();
 }
 
 void
 Character::setTileCoords(ivec3 phys) noexcept {
     leaveTile();
+    area->requestRedraw(drawnPixels);
     redraw = true;
-    r = area->grid.phys2virt_r(phys);
+    motion->r = area->grid.phys2virt_r(phys);
+    motion->prevR = motion->r;
+    layer = phys.z;
     enterTile();
 }
 
 void
 Character::setTileCoords(vicoord virt) noexcept {
     leaveTile();
+    area->requestRedraw(drawnPixels);
     redraw = true;
-    r = area->grid.virt2virt(virt);
+    motion->r = area->grid.virt2virt(virt);
+    motion->prevR = motion->r;
+    layer = area->grid.depthIndex(virt.z);
     enterTile();
 }
 
 void
 Character::setTileCoords(fvec3 virt) noexcept {
     leaveTile();
+    area->requestRedraw(drawnPixels);
     redraw = true;
-    r = virt;
+    motion->r = virt;
+    motion->prevR = motion->r;
+    layer = area->grid.depthIndex(virt.z);
     enterTile();
 }
 
 void
 Character::setArea(Area* area, vicoord position) noexcept {
     leaveTile();
+    if (this->area)
+        this->area->requestRedraw(drawnPixels);
+    drawnPixels.x1 = drawnPixels.x2 = 0;
+    path.clear();
+    pathNext = 0;
+    motion->wake &= ~MOTION_PATHING;
+    if (!area) {
+        this->area = 0;
+        return;
+    }
     Entity::setArea(area);
-    r = area->grid.virt2virt(position);
+    motion->r = area->grid.virt2virt(position);
+    motion->prevR = motion->r;
+    layer = area->grid.depthIndex(position.z);
     enterTile();
     redraw = true;
 }
 
 void
 Character::moveByTile(ivec2 delta) noexcept {
-    if (moving)
+    if (motion->moving)
         return;
 
-    setFacing(delta);
+    MoveProposal move;
+    proposeMove(delta, move);
+    makeMove(move);
+}
 
-    ivec3 dest = moveDest(facing);
+void
+Character::proposeMove(ivec2 delta, MoveProposal& move) noexcept {
+    fvec3 r = motion->r;
+
+    move.delta = delta;
+    move.at = r;
+    move.from = getTileCoords_i();
+    move.dest = moveDest(delta);
+    move.destCoord = area->grid.phys2virt_r(move.dest);
+
+    float angleToDest =
+        atan2f(move.destCoord.y - r.y, move.destCoord.x - r.x);
+    move.direction.x = cosf(angleToDest);
+    move.direction.y = sinf(angleToDest);
+
+    move.exit = 0;
+    if (area->grid.inBounds(move.from))
+        move.exit = area->grid.exitAt(move.from, delta);
+    if (!move.exit && area->grid.inBounds(move.dest))
+        move.exit = area->grid.exits[EXIT_NORMAL].tryAt(move.dest);
+}
 
-    ivec3 from = getTileCoords_i();
-    setDestinationCoordinate(area->grid.phys2virt_r(dest));
+void
+Character::makeMove(const MoveProposal& move) noexcept {
+    setFacing(move.delta);
 
-    destExit = 0;
-    if (area->grid.inBounds(from))
-        destExit = area->grid.exitAt(from, delta);
-    if (!destExit && area->grid.inBounds(dest))
-        destExit = area->grid.exits[EXIT_NORMAL].tryAt(dest);
+    ivec3 from = move.from;
+    ivec3 dest = move.dest;
+
+    // Set z right away so that we're on-level with the square we're
+    // entering.
+    motion->r.z = move.destCoord.z;
+    layer = dest.z;
+    motion->destCoord = move.destCoord;
+    motion->direction = move.direction;
+
+    destExit = move.exit;
 
     if (!canMove(dest)) {
         setAnimationStanding();
@@ -114,7 +177,7 @@ Character::moveByTile(ivec2 delta) noexcept {
     }
 
     setAnimationMoving();
-    moving = true;
+    motion->moving = true;
 
     // Process triggers.
     runTileExitScript();
@@ -123,33 +186,99 @@ Character::moveByTile(ivec2 delta) noexcept {
         area->runScript(TileGrid::SCRIPT_TYPE_LEAVE, from, this);
 
     // Modify tile's entity count.
-    leaveTile(from);
     enterTile(dest);
 
-    if (soundPathStep.size) {
-        SoundID sid = soundLoad(soundPathStep);
-        PlayingSoundID psid = soundPlay(sid);
+    if (soundStep && !area->background) {
+        PlayingSoundID psid = soundPlay(soundStep);
         playingSoundRelease(psid);
-        soundRelease(sid);
     }
 
     switch (confMoveMode) {
     case TURN:
         // Movement is instantaneous.
         redraw = true;
-        r = destCoord;
-        moving = false;
+        motion->r = motion->destCoord;
+        motion->prevR = motion->r;
+        motion->moving = false;
         setAnimationStanding();
         arrived();
         break;
     case TILE:
     case NOTILE:
-        // Movement happens in Entity::moveTowardDestination() during
+        // Movement happens in the Area's pass over its Motions during
         // tick().
         break;
     }
 }
 
+bool
+Character::walkTo(ivec3 goal) noexcept {
+    path.clear();
+    pathNext = 0;
+    pathGoal = goal;
+
+    U32 nowalk = nowalkFlags & ~nowalkExempt;
+    if (!area->paths.findPath(getTileCoords_i(), goal, nowalk, path)) {
+        pathGoal = IVEC3_MIN;
+        motion->wake &= ~MOTION_PATHING;
+        return false;
+    }
+    motion->wake |= MOTION_PATHING;
+    return true;
+}
+
+void
+Character::stepToward(ivec3 goal) noexcept {
+    if (motion->moving)
+        return;
+
+    U32 nowalk = nowalkFlags & ~nowalkExempt;
+    ivec2 delta = area->paths.flowStep(getTileCoords_i(), goal, nowalk);
+    if (delta.x || delta.y)
+        moveByTile(delta);
+}
+
+void
+Character::proposePathStep(MoveProposal& move) noexcept {
+    if (motion->moving || pathNext == path.size) {
+        // Never matches a step, so followPath() ignores it.
+        move.delta.x = 0;
+        move.delta.y = 0;
+        return;
+    }
+
+    proposeMove(path[pathNext], move);
+}
+
+void
+Character::followPath(const MoveProposal* move) noexcept {
+    if (motion->moving || pathNext == path.size || !area)
+        return;
+
+    if (!move && area->deferMove(this))
+        return;
+
+    ivec3 before = indexTile;
+    if (move && move->delta == path[pathNext] && move->at == motion->r)
+        makeMove(*move);
+    else
+        moveByTile(path[pathNext]);
+    if (indexTile != before) {
+        pathNext++;
+        if (pathNext == path.size) {
+            path.clear();
+            pathNext = 0;
+            pathGoal = IVEC3_MIN;
+            motion->wake &= ~MOTION_PATHING;
+        }
+        return;
+    }
+
+    // Something moved into our way since we planned. Plan again, and give up
+    // if there is no longer a way there.
+    walkTo(pathGoal);
+}
+
 ivec3
 Character::moveDest(ivec2 facing) noexcept {
     ivec3 here = getTileCoords_i();
@@ -178,7 +307,7 @@ Character::canMove(ivec3 dest) noexcept {
         // Tile is inside map. Can we move?
         if (nowalked(dest))
             return false;
-        if (area->grid.occupied.contains(dest)) {
+        if (area->entityGrid.occupied(dest)) {
             // Space is occupied by another Entity.
             return false;
         }
@@ -201,13 +330,15 @@ void
 Character::arrived() noexcept {
     Entity::arrived();
 
-    ivec3 dest = area->grid.virt2phys(destCoord);
+    ivec3 dest = getTileCoords_i();
     bool inBounds = area->grid.inBounds(dest);
 
     if (inBounds) {
         float* layermod = area->grid.layermods[EXIT_NORMAL].tryAt(dest);
-        if (layermod)
-            r.z = *layermod;
+        if (layermod) {
+            motion->r.z = *layermod;
+            layer = area->grid.depthIndex(motion->r.z);
+        }
 
         // Process triggers.
         area->runScript(TileGrid::SCRIPT_TYPE_ENTER, dest, this);
@@ -229,12 +360,7 @@ Character::arrived() noexcept {
 void
 Character::leaveTile() noexcept {
     if (area)
-        leaveTile(getTileCoords_i());
-}
-
-void
-Character::leaveTile(ivec3 phys) noexcept {
-    area->grid.occupied.erase(phys);
+        area->entityGrid.remove(this);
 }
 
 void
@@ -245,7 +371,7 @@ Character::enterTile() noexcept {
 
 void
 Character::enterTile(ivec3 phys) noexcept {
-    area->grid.occupied[phys] = true;
+    area->entityGrid.add(this, phys);
 }
 
 void
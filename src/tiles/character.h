@@ -2,9 +2,11 @@
 #define SRC_TILES_CHARACTER_H_
 
 #include "tiles/entity.h"
+#include "tiles/motion.h"
 #include "tiles/vec.h"
 #include "util/compiler.h"
 #include "util/int.h"
+#include "util/vector.h"
 
 class Area;
 struct Exit;
@@ -45,6 +47,32 @@ class Character : public Entity {
     virtual void
     moveByTile(ivec2 delta) noexcept;
 
+    //! Work out a move by delta without making it. Only reads the Area, so
+    //! that many Characters can do this at once.
+    void
+    proposeMove(ivec2 delta, MoveProposal& move) noexcept;
+
+    //! Work out the next step planned by walkTo(), if there is one.
+    void
+    proposePathStep(MoveProposal& move) noexcept;
+
+    //! Takes the next step planned by walkTo(). The step is move if that was
+    //! worked out from where the Character still is. Otherwise it is worked
+    //! out again, or during the Area's tick() left for it to work out along
+    //! with everyone else's.
+    void
+    followPath(const MoveProposal* move = 0) noexcept;
+
+    //! Walk to a tile one step per move, going around obstacles. Returns
+    //! false if there is no way there.
+    bool
+    walkTo(ivec3 goal) noexcept;
+
+    //! Take one step toward a tile that many Characters might be heading
+    //! for at once, such as the Player's.
+    void
+    stepToward(ivec3 goal) noexcept;
+
  protected:
     //! Indicates which coordinate we will move into if we proceed in
     //! direction specified.
@@ -58,14 +86,16 @@ class Character : public Entity {
     bool
     nowalked(ivec3 phys) noexcept;
 
+    //! Start a move worked out by proposeMove(), if the tile is free.
+    void
+    makeMove(const MoveProposal& move) noexcept;
+
     void
     arrived() noexcept;
 
     void
     leaveTile() noexcept;
     void
-    leaveTile(ivec3 phys) noexcept;
-    void
     enterTile() noexcept;
     void
     enterTile(ivec3 phys) noexcept;
@@ -81,6 +111,11 @@ class Character : public Entity {
 
     fvec3 fromCoord;
     Exit* destExit;
+
+    // Steps planned by walkTo() and the index of the next one to take.
+    Vector<ivec2> path;
+    Size pathNext;
+    ivec3 pathGoal;
 };
 
 #endif  // SRC_TILES_CHARACTER_H_
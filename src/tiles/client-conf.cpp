@@ -10,6 +10,86 @@ extern fvec2 dataWorldViewportResolution;
 MoveMode confMoveMode;
 ivec2 confWindowSize;
 bool confFullscreen;
+bool confWindowPipeline;
+I32 confStreamRadius;
+I32 confTextureBudget;
+I32 confUploadBudget;
+I32 confSoundBudget;
+String confSoundOutput;
+I32 confSoftFrames;
+String confSoftOutput;
+bool confSoftPipeline;
+I32 confBenchFrames;
+I32 confBenchDt;
+Vector<BenchKey> confBenchKeys;
+String confReplayRecord;
+String confReplayPlay;
+bool confTickParallel;
+I32 confBackgroundAreas;
+I32 confBackgroundInterval;
+I32 confBackgroundBudget;
+
+struct KeyName {
+    StringView name;
+    Key key;
+};
+
+static const KeyName keyNames[] = {
+    {"escape", KEY_ESCAPE},
+    {"left_control", KEY_LEFT_CONTROL},
+    {"right_control", KEY_RIGHT_CONTROL},
+    {"left_shift", KEY_LEFT_SHIFT},
+    {"right_shift", KEY_RIGHT_SHIFT},
+    {"space", KEY_SPACE},
+    {"left", KEY_LEFT_ARROW},
+    {"right", KEY_RIGHT_ARROW},
+    {"up", KEY_UP_ARROW},
+    {"down", KEY_DOWN_ARROW},
+};
+
+// Returns 0 if there is no key by that name.
+static Key
+keyNamed(StringView name) noexcept {
+    for (Size i = 0; i < sizeof(keyNames) / sizeof(keyNames[0]); i++)
+        if (keyNames[i].name == name)
+            return keyNames[i].key;
+    return 0;
+}
+
+// Parse a list of key events like {"frame": 10, "key": "up", "down": true}.
+static void
+parseBenchKeys(JsonValue keysValue) noexcept {
+    if (!keysValue.isArray() || !keysValue.toNode())
+        return;
+
+    for (JsonIterator node = begin(keysValue); node != end(keysValue);
+         ++node) {
+        JsonValue eventValue = node->value;
+        if (!eventValue.isObject())
+            continue;
+
+        JsonValue frameValue = eventValue["frame"];
+        JsonValue keyValue = eventValue["key"];
+        JsonValue downValue = eventValue["down"];
+        if (!frameValue.isNumber() || !keyValue.isString() ||
+            !downValue.isBool())
+            continue;
+
+        BenchKey event = {frameValue.toInt(), keyNamed(keyValue.toString()),
+                          downValue.toBool()};
+        if (event.key == 0) {
+            logErr("ClientConf", String() << "Unknown key "
+                                          << keyValue.toString());
+            continue;
+        }
+
+        // Keep the events in order of frame.
+        Size i = confBenchKeys.size;
+        while (i > 0 && confBenchKeys[i - 1].frame > event.frame)
+            i--;
+        confBenchKeys.insert(i, event);
+    }
+}
 
 // Parse and process the client config file, and set configuration defaults for
 // missing options.
@@ -17,6 +97,20 @@ void
 confParse(StringView filename) noexcept {
     String file;
 
+    confWindowPipeline = false;
+    confStreamRadius = 1;
+    confTextureBudget = 256;
+    confUploadBudget = 2048;
+    confSoundBudget = 32;
+    confSoftFrames = 1;
+    confSoftPipeline = false;
+    confBenchFrames = 0;
+    confBenchDt = 16;
+    confTickParallel = false;
+    confBackgroundAreas = 0;
+    confBackgroundInterval = 100;
+    confBackgroundBudget = 1000;
+
     bool ok = readFile(filename, file);
     if (!ok) {
         logInfo("ClientConf",
@@ -46,5 +140,89 @@ confParse(StringView filename) noexcept {
         JsonValue fullscreenValue = windowValue["fullscreen"];
         if (fullscreenValue.isBool())
             confFullscreen = fullscreenValue.toBool();
+        JsonValue pipelineValue = windowValue["pipeline"];
+        if (pipelineValue.isBool())
+            confWindowPipeline = pipelineValue.toBool();
+    }
+
+    JsonValue streamValue = root["stream"];
+    if (streamValue.isObject()) {
+        JsonValue radiusValue = streamValue["radius"];
+        if (radiusValue.isNumber() && radiusValue.toInt() >= 0)
+            confStreamRadius = radiusValue.toInt();
+    }
+
+    JsonValue texturesValue = root["textures"];
+    if (texturesValue.isObject()) {
+        JsonValue budgetValue = texturesValue["budget"];
+        if (budgetValue.isNumber() && budgetValue.toInt() > 0)
+            confTextureBudget = budgetValue.toInt();
+        JsonValue uploadValue = texturesValue["upload"];
+        if (uploadValue.isNumber() && uploadValue.toInt() > 0)
+            confUploadBudget = uploadValue.toInt();
+    }
+
+    JsonValue soundsValue = root["sounds"];
+    if (soundsValue.isObject()) {
+        JsonValue budgetValue = soundsValue["budget"];
+        if (budgetValue.isNumber() && budgetValue.toInt() > 0)
+            confSoundBudget = budgetValue.toInt();
+        JsonValue outputValue = soundsValue["output"];
+        if (outputValue.isString())
+            confSoundOutput = outputValue.toString();
+    }
+
+    JsonValue softValue = root["soft"];
+    if (softValue.isObject()) {
+        JsonValue framesValue = softValue["frames"];
+        if (framesValue.isNumber() && framesValue.toInt() > 0)
+            confSoftFrames = framesValue.toInt();
+        JsonValue outputValue = softValue["output"];
+        if (outputValue.isString())
+            confSoftOutput = outputValue.toString();
+        JsonValue pipelineValue = softValue["pipeline"];
+        if (pipelineValue.isBool())
+            confSoftPipeline = pipelineValue.toBool();
+    }
+
+    JsonValue benchValue = root["bench"];
+    if (benchValue.isObject()) {
+        JsonValue framesValue = benchValue["frames"];
+        if (framesValue.isNumber() && framesValue.toInt() > 0)
+            confBenchFrames = framesValue.toInt();
+        JsonValue dtValue = benchValue["dt"];
+        if (dtValue.isNumber() && dtValue.toInt() > 0)
+            confBenchDt = dtValue.toInt();
+        parseBenchKeys(benchValue["keys"]);
+    }
+
+    JsonValue replayValue = root["replay"];
+    if (replayValue.isObject()) {
+        JsonValue recordValue = replayValue["record"];
+        if (recordValue.isString())
+            confReplayRecord = recordValue.toString();
+        JsonValue playValue = replayValue["play"];
+        if (playValue.isString())
+            confReplayPlay = playValue.toString();
+    }
+
+    JsonValue tickValue = root["tick"];
+    if (tickValue.isObject()) {
+        JsonValue parallelValue = tickValue["parallel"];
+        if (parallelValue.isBool())
+            confTickParallel = parallelValue.toBool();
+    }
+
+    JsonValue backgroundValue = root["background"];
+    if (backgroundValue.isObject()) {
+        JsonValue areasValue = backgroundValue["areas"];
+        if (areasValue.isNumber() && areasValue.toInt() >= 0)
+            confBackgroundAreas = areasValue.toInt();
+        JsonValue intervalValue = backgroundValue["interval"];
+        if (intervalValue.isNumber() && intervalValue.toInt() > 0)
+            confBackgroundInterval = intervalValue.toInt();
+        JsonValue budgetValue = backgroundValue["budget"];
+        if (budgetValue.isNumber() && budgetValue.toInt() > 0)
+            confBackgroundBudget = budgetValue.toInt();
     }
 }
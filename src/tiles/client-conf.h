@@ -3,9 +3,12 @@
 
 #include "tiles/log.h"
 #include "tiles/vec.h"
+#include "tiles/window.h"
 #include "util/compiler.h"
 #include "util/int.h"
 #include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
 
 //! Engine-wide user-configurable values.
 
@@ -16,6 +19,74 @@ extern MoveMode confMoveMode;
 extern ivec2 confWindowSize;
 extern bool confFullscreen;
 
+//! Whether the window presents each frame on a render thread while the next
+//! one is simulated and drawn, if its renderer can be moved there.
+extern bool confWindowPipeline;
+
+//! Number of chunks beyond the visible ones that streaming Areas keep loaded.
+extern I32 confStreamRadius;
+
+//! Megabytes of texture memory that image atlases try to stay within.
+extern I32 confTextureBudget;
+
+//! Kilobytes of decoded images copied into textures each frame.
+extern I32 confUploadBudget;
+
+//! Megabytes of decoded sounds kept resident.
+extern I32 confSoundBudget;
+
+//! WAV file that backends without an audio device mix sounds into, or empty
+//! for none.
+extern String confSoundOutput;
+
+//! Number of frames the software renderer draws before exiting.
+extern I32 confSoftFrames;
+
+//! Directory the software renderer writes its frames to, or empty for none.
+extern String confSoftOutput;
+
+//! Whether the software renderer presents each frame on a thread of its own
+//! while the next one is simulated.
+extern bool confSoftPipeline;
+
+//! A key pressed or released by the benchmark at the start of a frame.
+struct BenchKey {
+    I32 frame;
+    Key key;
+    bool down;
+};
+
+//! Number of frames the null window runs as a benchmark, or 0 for none.
+extern I32 confBenchFrames;
+
+//! Milliseconds of game time each benchmark frame advances by.
+extern I32 confBenchDt;
+
+//! Keys the benchmark presses and releases, in order of frame.
+extern Vector<BenchKey> confBenchKeys;
+
+//! File to record the session's input to, or empty for none.
+extern String confReplayRecord;
+
+//! Recording the null window replays instead of running the game, or empty
+//! for none.
+extern String confReplayPlay;
+
+//! Whether an Area's tick() spreads moving its Entities across the job
+//! workers. Either way the game plays out the same.
+extern bool confTickParallel;
+
+//! Number of Areas the player most recently left that keep being ticked in
+//! the background, or 0 for none.
+extern I32 confBackgroundAreas;
+
+//! Milliseconds of game time between ticks of an Area in the background.
+extern I32 confBackgroundInterval;
+
+//! Microseconds each frame that ticking Areas in the background may take.
+//! Ignored while recording or replaying, which need every tick to happen.
+extern I32 confBackgroundBudget;
+
 void
 confParse(StringView filename) noexcept;
 
@@ -1,8 +1,126 @@
 #include "tiles/display-list.h"
 
+#include "os/c.h"
 #include "tiles/window.h"
 #include "util/compiler.h"
+#include "util/int.h"
 #include "util/math2.h"
+#include "util/vector.h"
+
+struct SortEntry {
+    U64 key;
+    U32 index;
+};
+
+// Scratch space for sortItems().
+static Vector<SortEntry> entries;
+static Vector<SortEntry> sortScratch;
+static Vector<DisplayItem> sortedItems;
+static Vector<void*> textures;
+
+// Maps a float to an integer with the same ordering.
+static U32
+orderedBits(float f) noexcept {
+    union {
+        float f;
+        U32 u;
+    } bits;
+    bits.f = f;
+    return (bits.u & 0x80000000) ? ~bits.u : bits.u | 0x80000000;
+}
+
+// Number of distinct textures seen so far this frame, by first appearance.
+static U32
+textureRank(void* texture) noexcept {
+    // Neighboring items almost always share a texture.
+    static U32 last = 0;
+    if (last < textures.size && textures[last] == texture)
+        return last;
+
+    for (U32 i = 0; i < textures.size; i++) {
+        if (textures[i] == texture) {
+            last = i;
+            return i;
+        }
+    }
+
+    last = static_cast<U32>(textures.size);
+    textures.push(texture);
+    return last;
+}
+
+// Stable LSD radix sort on the low 48 bits of each key, a byte at a time.
+// Passes in which every key has the same byte are skipped.
+static void
+radixSort() noexcept {
+    Size n = entries.size;
+    if (sortScratch.capacity < n)
+        sortScratch.reserve(n);
+    sortScratch.size = n;
+
+    SortEntry* from = entries.data;
+    SortEntry* to = sortScratch.data;
+
+    for (U32 shift = 0; shift < 48; shift += 8) {
+        Size counts[256] = {};
+        for (Size i = 0; i < n; i++)
+            counts[(from[i].key >> shift) & 0xFF]++;
+        if (counts[(from[0].key >> shift) & 0xFF] == n)
+            continue;
+
+        Size offset = 0;
+        for (Size b = 0; b < 256; b++) {
+            Size count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        for (Size i = 0; i < n; i++)
+            to[counts[(from[i].key >> shift) & 0xFF]++] = from[i];
+
+        SortEntry* tmp = from;
+        from = to;
+        to = tmp;
+    }
+
+    if (from != entries.data)
+        for (Size i = 0; i < n; i++)
+            entries[i] = from[i];
+}
+
+// Order items back to front, and within one depth group them by texture so
+// that backends can draw each group as one batch. Items with the same depth
+// and texture keep the order they were emitted in.
+static void
+sortItems(Vector<DisplayItem>& items) noexcept {
+    Size n = items.size;
+    if (n < 2)
+        return;
+
+    textures.clear();
+    entries.clear();
+    if (entries.capacity < n)
+        entries.reserve(n);
+
+    for (Size i = 0; i < n; i++) {
+        DisplayItem& item = items[i];
+        U64 depth = orderedBits(item.destination.z);
+        U64 texture = textureRank(item.image.texture) & 0xFFFF;
+        SortEntry entry = {(depth << 16) | texture, static_cast<U32>(i)};
+        entries.push(entry);
+    }
+
+    radixSort();
+
+    sortedItems.clear();
+    if (sortedItems.capacity < n)
+        sortedItems.reserve(n);
+    for (Size i = 0; i < n; i++)
+        sortedItems.push(items[entries[i].index]);
+
+    Vector<DisplayItem> tmp = static_cast<Vector<DisplayItem>&&>(items);
+    items = static_cast<Vector<DisplayItem>&&>(sortedItems);
+    sortedItems = static_cast<Vector<DisplayItem>&&>(tmp);
+}
 
 static void
 pushLetterbox(DisplayList* display) noexcept {
@@ -43,8 +161,79 @@ popLetterbox() noexcept {
     windowPopClip();
 }
 
-void
-displayListPresent(DisplayList* display) noexcept {
+// More damaged rectangles than this are drawn as one that bounds them all,
+// since each is another pass over the DisplayList.
+#define DAMAGE_REGIONS_MAX 16
+
+// Scratch space for mergeDamage().
+static Vector<irect> regions;
+
+static bool
+touches(irect a, irect b) noexcept {
+    return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+static irect
+bounding(irect a, irect b) noexcept {
+    irect r = {min(a.x1, b.x1), min(a.y1, b.y1), max(a.x2, b.x2),
+               max(a.y2, b.y2)};
+    return r;
+}
+
+// Fill regions with rectangles that cover the damage and do not overlap, so
+// that no pixel is drawn twice.
+static void
+mergeDamage(Vector<irect>& damage) noexcept {
+    regions.clear();
+
+    if (damage.size > DAMAGE_REGIONS_MAX * DAMAGE_REGIONS_MAX) {
+        irect all = damage[0];
+        for (Size i = 1; i < damage.size; i++)
+            all = bounding(all, damage[i]);
+        regions.push(all);
+        return;
+    }
+
+    for (Size i = 0; i < damage.size; i++)
+        regions.push(damage[i]);
+
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (Size i = 0; i < regions.size; i++) {
+            for (Size j = i + 1; j < regions.size;) {
+                if (touches(regions[i], regions[j])) {
+                    regions[i] = bounding(regions[i], regions[j]);
+                    regions.eraseUnordered(j);
+                    merged = true;
+                }
+                else {
+                    j++;
+                }
+            }
+        }
+    }
+
+    if (regions.size > DAMAGE_REGIONS_MAX) {
+        irect all = regions[0];
+        for (Size i = 1; i < regions.size; i++)
+            all = bounding(all, regions[i]);
+        regions.clear();
+        regions.push(all);
+    }
+}
+
+static bool
+overlaps(DisplayItem& item, irect region) noexcept {
+    float x = item.destination.x;
+    float y = item.destination.y;
+    return x < region.x2 && region.x1 < x + item.image.width &&
+           y < region.y2 && region.y1 < y + item.image.height;
+}
+
+// Draw the items that overlap region, or all of them if region is null.
+static void
+drawItems(DisplayList* display, const irect* region) noexcept {
     pushLetterbox(display);
 
     // Zoom and pan the Area to fit on-screen.
@@ -54,6 +243,8 @@ displayListPresent(DisplayList* display) noexcept {
 
     for (DisplayItem* item = display->items.begin();
          item != display->items.end(); item++) {
+        if (region && !overlaps(*item, *region))
+            continue;
         imageDraw(item->image, item->destination.x, item->destination.y,
                   item->destination.z);
     }
@@ -75,7 +266,7 @@ displayListPresent(DisplayList* display) noexcept {
         float wh = static_cast<float>(windowHeight());
         imageDrawRect(0, ww, 0, wh, 512.0f, 0x7F000000);
 
-        Image pauseInfo = imageLoad("resource/pause_overlay.bmp");
+        Image pauseInfo = display->pauseOverlay;
         if (IMAGE_VALID(pauseInfo)) {
             imageFlushImages();
             imageFlushRects();
@@ -85,9 +276,45 @@ displayListPresent(DisplayList* display) noexcept {
             float top = 768.0f;
             imageDraw(pauseInfo, ww / 2 - iw / 2, wh / 2 - ih / 2, top);
         }
-        imageRelease(pauseInfo);
     }
 
     imageFlushImages();
     imageFlushRects();
 }
+
+void
+displayListPresent(DisplayList* display) noexcept {
+    sortItems(display->items);
+
+    if (display->damage.size == 0) {
+        drawItems(display, 0);
+        return;
+    }
+
+    mergeDamage(display->damage);
+
+    fvec2 scale = display->scale;
+    fvec2 offset = display->scroll * scale + display->padding;
+    I32 ww = windowWidth();
+    I32 wh = windowHeight();
+
+    for (irect* region = regions.begin(); region != regions.end();
+         region++) {
+        // From map pixels to window pixels, rounded outward.
+        I32 x1 = static_cast<I32>(floorf(region->x1 * scale.x - offset.x));
+        I32 y1 = static_cast<I32>(floorf(region->y1 * scale.y - offset.y));
+        I32 x2 = static_cast<I32>(ceilf(region->x2 * scale.x - offset.x));
+        I32 y2 = static_cast<I32>(ceilf(region->y2 * scale.y - offset.y));
+
+        x1 = max(x1, 0);
+        y1 = max(y1, 0);
+        x2 = min(x2, ww);
+        y2 = min(y2, wh);
+        if (x1 >= x2 || y1 >= y2)
+            continue;
+
+        imageBeginRegion(x1, y1, x2 - x1, y2 - y1);
+        drawItems(display, region);
+        imageEndRegion();
+    }
+}
@@ -22,8 +22,16 @@ struct DisplayList {
 
     Vector<DisplayItem> items;
 
+    // Parts of the map, in the same pixels as item destinations, that changed
+    // since the previous frame. Empty if the whole screen is to be drawn.
+    Vector<irect> damage;
+
     U32 colorOverlayARGB;
     bool paused;  // TODO: Move to colorOverlay & overlay.
+
+    // Drawn while paused. Loaded by whoever drew the list, so that a list can
+    // be presented on another thread.
+    Image pauseOverlay;
 };
 
 void
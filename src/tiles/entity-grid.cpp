@@ -0,0 +1,130 @@
+#include "tiles/entity-grid.h"
+
+#include "tiles/character.h"
+#include "tiles/overlay.h"
+#include "tiles/tile-grid.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/math2.h"
+
+EntityGrid::EntityGrid(TileGrid& grid) noexcept : grid(grid) {
+    dim.x = dim.y = dim.z = 0;
+    margin.x = margin.y = 0;
+}
+
+EntityCell*
+EntityGrid::cellFor(ivec3 tile) noexcept {
+    if (cells.size == 0) {
+        // The TileGrid is fully loaded by the time the first entity arrives.
+        dim.x = (grid.dim.x + ENTITY_CELL_SIZE - 1) >> ENTITY_CELL_SHIFT;
+        dim.y = (grid.dim.y + ENTITY_CELL_SIZE - 1) >> ENTITY_CELL_SHIFT;
+        dim.z = grid.dim.z;
+        cells.resize(dim.x * dim.y * dim.z);
+    }
+
+    if (tile.z < 0 || dim.z <= tile.z || dim.x == 0 || dim.y == 0)
+        return 0;
+
+    // Entities off the edge of the map are filed under the nearest cell.
+    I32 x = bound(tile.x >> ENTITY_CELL_SHIFT, 0, dim.x - 1);
+    I32 y = bound(tile.y >> ENTITY_CELL_SHIFT, 0, dim.y - 1);
+
+    return &cells[(tile.z * dim.y + y) * dim.x + x];
+}
+
+EntityCell&
+EntityGrid::cellAt(I32 x, I32 y, I32 z) noexcept {
+    return cells[(z * dim.y + y) * dim.x + x];
+}
+
+void
+EntityGrid::grow(Entity* e) noexcept {
+    if (grid.tileDim.x == 0 || grid.tileDim.y == 0)
+        return;
+    margin.x = max(margin.x, e->imgsz.x / grid.tileDim.x + 1);
+    margin.y = max(margin.y, e->imgsz.y / grid.tileDim.y + 1);
+}
+
+void
+EntityGrid::add(Character* c, ivec3 tile) noexcept {
+    remove(c);
+
+    EntityCell* cell = cellFor(tile);
+    if (!cell)
+        return;
+
+    cell->characters.push(c);
+    c->indexTile = tile;
+    grow(c);
+}
+
+void
+EntityGrid::add(Overlay* o, ivec3 tile) noexcept {
+    remove(o);
+
+    EntityCell* cell = cellFor(tile);
+    if (!cell)
+        return;
+
+    cell->overlays.push(o);
+    o->indexTile = tile;
+    grow(o);
+}
+
+void
+EntityGrid::remove(Character* c) noexcept {
+    if (c->indexTile == IVEC3_MIN)
+        return;
+
+    Vector<Character*>& characters = cellFor(c->indexTile)->characters;
+    for (Size i = 0; i < characters.size; i++) {
+        if (characters[i] == c) {
+            characters.eraseUnordered(i);
+            break;
+        }
+    }
+    c->indexTile = IVEC3_MIN;
+}
+
+void
+EntityGrid::remove(Overlay* o) noexcept {
+    if (o->indexTile == IVEC3_MIN)
+        return;
+
+    Vector<Overlay*>& overlays = cellFor(o->indexTile)->overlays;
+    for (Size i = 0; i < overlays.size; i++) {
+        if (overlays[i] == o) {
+            overlays.eraseUnordered(i);
+            break;
+        }
+    }
+    o->indexTile = IVEC3_MIN;
+}
+
+bool
+EntityGrid::occupied(ivec3 tile) noexcept {
+    EntityCell* cell = cellFor(tile);
+    if (!cell)
+        return false;
+
+    Vector<Character*>& characters = cell->characters;
+    for (Character** c = characters.begin(); c != characters.end(); c++)
+        if ((*c)->indexTile == tile)
+            return true;
+    return false;
+}
+
+icube
+EntityGrid::cellsFor(icube tiles) noexcept {
+    icube range = {0, 0, tiles.z1, 0, 0, tiles.z2};
+    if (cells.size == 0)
+        return range;
+
+    range.x1 = bound((tiles.x1 - margin.x) >> ENTITY_CELL_SHIFT, 0, dim.x);
+    range.y1 = bound((tiles.y1 - margin.y) >> ENTITY_CELL_SHIFT, 0, dim.y);
+    range.x2 = bound(((tiles.x2 + margin.x - 1) >> ENTITY_CELL_SHIFT) + 1, 0,
+                     dim.x);
+    range.y2 = bound(((tiles.y2 + margin.y - 1) >> ENTITY_CELL_SHIFT) + 1, 0,
+                     dim.y);
+    return range;
+}
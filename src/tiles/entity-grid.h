@@ -0,0 +1,84 @@
+#ifndef SRC_TILES_ENTITY_GRID_H_
+#define SRC_TILES_ENTITY_GRID_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+class Character;
+class Entity;
+class Overlay;
+class TileGrid;
+
+// Cells are ENTITY_CELL_SIZE x ENTITY_CELL_SIZE tiles on one layer.
+#define ENTITY_CELL_SHIFT 3
+#define ENTITY_CELL_SIZE  (1 << ENTITY_CELL_SHIFT)
+
+struct EntityCell {
+    Vector<Character*> characters;
+    Vector<Overlay*> overlays;
+};
+
+// A uniform grid over an Area that files each Character and Overlay under the
+// cell of the tile it stands on. Drawing, redraw checks, and collision only
+// look at the entities in the cells they are interested in.
+//
+// A Character is filed under the tile it occupies, which while it is moving
+// is its destination. An Overlay is filed under the tile containing its pixel
+// coordinate.
+class EntityGrid {
+ public:
+    explicit EntityGrid(TileGrid& grid) noexcept;
+
+    void
+    add(Character* c, ivec3 tile) noexcept;
+    void
+    add(Overlay* o, ivec3 tile) noexcept;
+
+    // Does nothing if the entity is not filed.
+    void
+    remove(Character* c) noexcept;
+    void
+    remove(Overlay* o) noexcept;
+
+    // Whether any Character occupies the tile.
+    bool
+    occupied(ivec3 tile) noexcept;
+
+    // The range of cells, on every layer, that hold all entities that might
+    // be drawn within the given tiles. Accounts for sprites larger than a
+    // tile.
+    icube
+    cellsFor(icube tiles) noexcept;
+
+    EntityCell&
+    cellAt(I32 x, I32 y, I32 z) noexcept;
+
+ private:
+    EntityCell*
+    cellFor(ivec3 tile) noexcept;
+
+    void
+    grow(Entity* e) noexcept;
+
+ public:
+    TileGrid& grid;
+
+    // Number of cells in each dimension.
+    ivec3 dim;
+
+    // Indexed by (z * dim.y + y) * dim.x + x.
+    Vector<EntityCell> cells;
+
+    // Distance in tiles that the largest filed sprite reaches beyond the tile
+    // it is filed under.
+    ivec2 margin;
+
+ private:
+    EntityGrid(const EntityGrid&);
+    void
+    operator=(const EntityGrid&);
+};
+
+#endif  // SRC_TILES_ENTITY_GRID_H_
@@ -8,6 +8,7 @@
 #include "tiles/jsons.h"
 #include "tiles/log.h"
 #include "tiles/resources.h"
+#include "tiles/sounds.h"
 #include "tiles/world.h"
 #include "util/assert.h"
 #include "util/compiler.h"
@@ -73,7 +74,8 @@ parseDescriptor(Entity* e) noexcept {
 
         if (e->area) {
             assert_(e->area->grid.tileDim.x == e->area->grid.tileDim.y);
-            e->pixelsPerSecond = e->tilesPerSecond * e->area->grid.tileDim.x;
+            e->motion->pixelsPerSecond =
+                e->tilesPerSecond * e->area->grid.tileDim.x;
         }
     }
     if (spriteValue.isObject())
@@ -117,6 +119,7 @@ parseSprite(Entity* e, JsonValue sprite) noexcept {
     TiledImage tiles =
         tilesLoad(path, tileWidth, tileHeight, numAcross, numHigh);
     CHECK(TILES_VALID(tiles));
+    e->tiles = tiles;
 
     return parsePhases(e, phasesValue, tiles);
 }
@@ -242,7 +245,8 @@ parseSound(Entity* e, StringView name, StringView path) noexcept {
     }
 
     if (name == "step") {
-        e->soundPathStep = path;
+        soundRelease(e->soundStep);
+        e->soundStep = soundLoad(path);
     }
     else {
         logErr(e->descriptor, String() << "unknown entity sound " << name);
@@ -317,17 +321,21 @@ Entity::Entity() noexcept
     : dead(false),
       redraw(true),
       area(0),
-      frozen(false),
-      moving(false),
+      motion(0),
+      layer(-1),
+      indexTile(IVEC3_MIN),
       phase(0) {
-    r.x = 0.0;
-    r.y = 0.0;
-    r.z = 0.0;
+    drawnPixels.x1 = drawnPixels.y1 = drawnPixels.x2 = drawnPixels.y2 = 0;
     facing.x = 0;
     facing.y = 0;
+    tiles.image.texture = 0;
 }
 
-Entity::~Entity() noexcept { }
+Entity::~Entity() noexcept {
+    if (TILES_VALID(tiles))
+        tilesRelease(tiles);
+    soundRelease(soundStep);
+}
 
 bool
 Entity::init(StringView descriptor, StringView initialPhase) noexcept {
@@ -341,43 +349,60 @@ void
 Entity::destroy() noexcept {
     dead = true;
     if (area)
-        area->requestRedraw();
+        area->requestRedraw(drawnPixels);
 }
 
 void
 Entity::draw(DisplayList* display) noexcept {
     redraw = false;
-    if (!phase)
+    if (!phase) {
+        drawnPixels.x1 = drawnPixels.x2 = 0;
         return;
-
-    Time now = worldTime();
+    }
 
     // TODO: Don't add to DisplayList if not on-screen.
 
+    fvec3 at = getDrawCoord();
+
     // X-axis is centered on tile.
-    float maxX = (area->grid.tileDim.x + imgsz.x) / 2 + r.x;
+    float maxX = (area->grid.tileDim.x + imgsz.x) / 2 + at.x;
     float minX = maxX - imgsz.x;
     // Y-axis is aligned with bottom of tile.
-    float maxY = area->grid.tileDim.y + r.y;
+    float maxY = area->grid.tileDim.y + at.y;
     float minY = maxY - imgsz.y;
 
-    fvec3 destination = {minX, minY, r.z};
-    DisplayItem item = {phase->setFrame(now), destination};
+    fvec3 destination = {minX, minY, motion->r.z};
+    DisplayItem item = {phase->getFrame(), destination};
     display->items.push(item);
+
+    drawnPixels = pixelBounds();
+}
+
+static bool
+isVisible(irect pixels, icube& visiblePixels) noexcept {
+    if (pixels.x1 == pixels.x2)
+        return false;
+    if (visiblePixels.x2 < pixels.x1 || pixels.x2 < visiblePixels.x1)
+        return false;
+    if (visiblePixels.y2 < pixels.y1 || pixels.y2 < visiblePixels.y1)
+        return false;
+    return true;
 }
 
 bool
-Entity::needsRedraw(icube& visiblePixels) noexcept {
+Entity::needsRedraw(icube& visiblePixels, Vector<irect>& damage) noexcept {
     if (!phase) {
-        // Entity is invisible.
-        return false;
+        // Entity is invisible, but may have been drawn before it became so.
+        if (!isVisible(drawnPixels, visiblePixels))
+            return false;
+        damage.push(drawnPixels);
+        drawnPixels.x1 = drawnPixels.x2 = 0;
+        return true;
     }
 
-
-    if (!redraw) {
+    if (!redraw && !interpolating()) {
         // Entity has not moved and has not changed phase.
-        Time now = worldTime();
-        if (!phase->needsRedraw(now)) {
+        if (!phase->needsRedraw()) {
             // Entity's animation does not need an update.
             return false;
         }
@@ -385,21 +410,17 @@ Entity::needsRedraw(icube& visiblePixels) noexcept {
 
     // At this point, we know the entity is visible, and has either moved since
     // the last frame or it wants to update its animation frame. Now we check
-    // if it is on-screen.
-
-    // X-axis is centered on tile.
-    I32 maxX = (area->grid.tileDim.x + imgsz.x) / 2 + static_cast<I32>(r.x);
-    I32 minX = maxX - imgsz.x;
-    // Y-axis is aligned with bottom of tile.
-    I32 maxY = area->grid.tileDim.y + static_cast<I32>(r.y);
-    I32 minY = maxY - imgsz.y;
+    // if it is on-screen, either where it was or where it is.
+    irect pixels = pixelBounds();
+    bool was = isVisible(drawnPixels, visiblePixels);
+    bool is = isVisible(pixels, visiblePixels);
 
-    if (visiblePixels.x2 < minX || maxX < visiblePixels.x1)
-        return false;
-    if (visiblePixels.y2 < minY || maxY < visiblePixels.y1)
-        return false;
+    if (was)
+        damage.push(drawnPixels);
+    if (is)
+        damage.push(pixels);
 
-    return true;
+    return was || is;
 }
 
 bool
@@ -410,6 +431,11 @@ Entity::isDead() noexcept {
 
 void
 Entity::tick(Time dt) noexcept {
+    if (motion->wake & MOTION_ARRIVED) {
+        motion->wake &= ~MOTION_ARRIVED;
+        finishMove(dt);
+    }
+
     for (OnTickFn* fn = onTickFns.begin(); fn != onTickFns.end(); fn++)
         fn->fn(fn->data, dt);
 }
@@ -455,7 +481,22 @@ Entity::setAnimationMoving() noexcept {
 
 fvec3
 Entity::getPixelCoord() noexcept {
-    return r;
+    return motion->r;
+}
+
+fvec3
+Entity::getDrawCoord() noexcept {
+    fvec3 r = motion->r;
+    if (!interpolating())
+        return r;
+
+    // Exactly r when the world is right on a step.
+    return r - (1.0f - worldInterpolation()) * (r - motion->prevR);
+}
+
+bool
+Entity::interpolating() noexcept {
+    return motion->prevStep == worldSteps() && motion->prevR != motion->r;
 }
 
 Area*
@@ -470,7 +511,7 @@ Entity::setArea(Area* area) noexcept {
 
     if (confMoveMode != TURN)
         assert_(area->grid.tileDim.x == area->grid.tileDim.y);
-    pixelsPerSecond = tilesPerSecond * area->grid.tileDim.x;
+    motion->pixelsPerSecond = tilesPerSecond * area->grid.tileDim.x;
 }
 
 float
@@ -486,12 +527,13 @@ Entity::getSpeedInTiles() noexcept {
 
 void
 Entity::setFrozen(bool b) noexcept {
-    frozen = b;
+    motion->frozen = b;
 }
 
 void
 Entity::attach(OnTickFn fn) noexcept {
     onTickFns.push(static_cast<OnTickFn&&>(fn));
+    motion->wake |= MOTION_HOOKED;
 }
 
 void
@@ -499,6 +541,22 @@ Entity::attach(OnTurnFn fn) noexcept {
     onTurnFns.push(static_cast<OnTurnFn&&>(fn));
 }
 
+irect
+Entity::pixelBounds() noexcept {
+    // Same placement as draw(), rounded out to whole pixels.
+    fvec3 at = getDrawCoord();
+    float maxX = (area->grid.tileDim.x + imgsz.x) / 2 + at.x;
+    float maxY = area->grid.tileDim.y + at.y;
+
+    irect pixels = {
+        static_cast<I32>(floorf(maxX - imgsz.x)),
+        static_cast<I32>(floorf(maxY - imgsz.y)),
+        static_cast<I32>(ceilf(maxX)),
+        static_cast<I32>(ceilf(maxY)),
+    };
+    return pixels;
+}
+
 void
 Entity::calcDraw() noexcept {
     if (area) {
@@ -559,45 +617,37 @@ Entity::_setPhase(StringView name) noexcept {
 }
 
 void
-Entity::setDestinationCoordinate(fvec3 destCoord) noexcept {
+Entity::setDestinationCoordinate(fvec3 destCoord, I32 destLayer) noexcept {
     // Set z right away so that we're on-level with the square we're
     // entering.
-    r.z = destCoord.z;
+    motion->r.z = destCoord.z;
+    layer = destLayer;
 
-    this->destCoord = destCoord;
-    angleToDest = atan2f(destCoord.y - r.y, destCoord.x - r.x);
+    motion->destCoord = destCoord;
+    float angleToDest =
+        atan2f(destCoord.y - motion->r.y, destCoord.x - motion->r.x);
+    motion->direction.x = cosf(angleToDest);
+    motion->direction.y = sinf(angleToDest);
 }
 
 void
 Entity::moveTowardDestination(Time dt) noexcept {
-    if (!moving)
-        return;
-
-    redraw = true;
+    if (motion->moving && motionMove(*motion, dt))
+        finishMove(dt);
+}
 
-    float traveledPixels = pixelsPerSecond * static_cast<float>(dt) / 1000.0f;
-    float toDestPixels = distanceTo(r, destCoord);
-    if (toDestPixels > traveledPixels) {
-        // The destination has not been reached yet.
-        r.x += cosf(angleToDest) * traveledPixels;
-        r.y += sinf(angleToDest) * traveledPixels;
+void
+Entity::finishMove(Time dt) noexcept {
+    arrived();
+
+    // If arrived() starts a new movement, rollover unused traveled
+    // pixels and leave the the moving animation.
+    if (motion->moving) {
+        Time rem = static_cast<Time>(motion->leftover * static_cast<float>(dt));
+        moveTowardDestination(rem);
     }
     else {
-        // We have arrived at the destination.
-        r = destCoord;
-        moving = false;
-        arrived();
-
-        // If arrived() starts a new movement, rollover unused traveled
-        // pixels and leave the the moving animation.
-        if (moving) {
-            float percent = 1.0f - toDestPixels / traveledPixels;
-            Time rem = static_cast<Time>(percent * static_cast<float>(dt));
-            moveTowardDestination(rem);
-        }
-        else {
-            setAnimationStanding();
-        }
+        setAnimationStanding();
     }
 }
 
@@ -3,6 +3,8 @@
 
 #include "tiles/animation.h"
 #include "tiles/images.h"
+#include "tiles/motion.h"
+#include "tiles/sounds.h"
 #include "tiles/vec.h"
 #include "util/compiler.h"
 #include "util/function.h"
@@ -42,8 +44,10 @@ class Entity {
 
     void
     draw(DisplayList* display) noexcept;
+    // Whether the Entity changed on screen since it was last drawn. If so,
+    // adds the parts of the screen it covered then and covers now to damage.
     bool
-    needsRedraw(icube& visiblePixels) noexcept;
+    needsRedraw(icube& visiblePixels, Vector<irect>& damage) noexcept;
     bool
     isDead() noexcept;
 
@@ -78,6 +82,10 @@ class Entity {
     // Tile the Entity is standing on.
     fvec3
     getPixelCoord() noexcept;
+    // Where the Entity is drawn, which is behind getPixelCoord() by however
+    // far the world is from its next step.
+    fvec3
+    getDrawCoord() noexcept;
 
 
     // Gets the Entity's current Area.
@@ -126,14 +134,27 @@ class Entity {
     StringView
     directionStr(ivec2 facing) noexcept;
 
+    // Pixels within the Area that the Entity covers where it is drawn.
+    irect
+    pixelBounds() noexcept;
+
+    // Whether the Entity moved in the last step, so that it is drawn
+    // somewhere new as the world goes on to the next.
+    bool
+    interpolating() noexcept;
+
     enum SetPhaseResult
     _setPhase(StringView name) noexcept;
 
     void
-    setDestinationCoordinate(fvec3 destCoord) noexcept;
+    setDestinationCoordinate(fvec3 destCoord, I32 destLayer) noexcept;
 
     void
     moveTowardDestination(Time dt) noexcept;
+    // Called on arrival at the destination, with the tick that got the
+    // Entity there.
+    void
+    finishMove(Time dt) noexcept;
 
     // arrived() is called when an Entity arrives at its destination.  If
     // it is ordered to begin moving again from within arrived(), then the
@@ -147,28 +168,32 @@ class Entity {
 
     // Set to true if the Entity wants the screen to be redrawn.
     bool redraw;
+    // Pixels within the Area covered when last drawn. Empty if not drawn
+    // since entering the Area.
+    irect drawnPixels;
 
     // Pointer to Area this Entity is located on.
     Area* area;
-    // Real x,y position: hold partial pixel transversal
-    fvec3 r;
+    // Position and movement, kept by the Area that spawned the Entity, or by
+    // the Player itself.
+    Motion* motion;
+    // Physical index of the layer at depth r.z, or -1 if there is no layer
+    // at that depth. Kept in step with r.z so that tile lookups need not
+    // search for the depth.
+    I32 layer;
+    // Tile this Entity is filed under in its Area's EntityGrid, or IVEC3_MIN
+    // if it is not filed.
+    ivec3 indexTile;
     // Drawing offset to center entity on tile.
     fvec3 doff;
 
     String descriptor;
 
-    bool frozen;
-
     float tilesPerSecond;
-    float pixelsPerSecond;
-
-    // True if currently moving to a new coordinate in an Area.
-    bool moving;
-
-    fvec3 destCoord;
-    float angleToDest;
 
     ivec2 imgsz;
+    // Sprite sheet the phases are cut from. Released with the Entity.
+    TiledImage tiles;
     Animation* phase;
     String phaseName;
     ivec2 facing;
@@ -184,7 +209,7 @@ class Entity {
     Animation phaseMovingLeft;
 
     //  sounds["step"] = "sounds/player_step.oga"
-    String soundPathStep;
+    SoundID soundStep;
 
     Vector<OnTickFn> onTickFns;
     Vector<OnTurnFn> onTurnFns;
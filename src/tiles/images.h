@@ -39,6 +39,31 @@ imageDraw(Image image, float x, float y, float z) noexcept;
 void
 imageRelease(Image image) noexcept;
 
+// Whether an image's pixels have arrived. Until they do, it is drawn as
+// nothing.
+bool
+imageReady(Image image) noexcept;
+
+// An image placed within a baked image, in pixels from its top-left corner.
+struct BakeItem {
+    Image image;
+    float x;
+    float y;
+};
+
+// Draw images into a new texture of the given size, which can then be drawn
+// many times with imageDraw() for the cost of one image. Items must not
+// overlap, and must be ready.
+//
+// Returns an invalid Image if the backend cannot render to textures, in which
+// case the caller should draw the items individually.
+Image
+imageBake(U32 width, U32 height, const BakeItem* items, Size count) noexcept;
+
+// Free an Image returned by imageBake().
+void
+imageBakeRelease(Image image) noexcept;
+
 // Load an image of tiles from the file at the given path. Each tile with width
 // and heigh as specified. If the image does not have the expected number of
 // tiles across and high, loading fails.
@@ -69,6 +94,13 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
 void
 imageFlushImages() noexcept;
 
+// Redraw a rectangle of the window, in pixels, within a frame that kept the
+// previous one: clear it, and draw only within it until imageEndRegion().
+void
+imageBeginRegion(I32 x, I32 y, I32 width, I32 height) noexcept;
+void
+imageEndRegion() noexcept;
+
 void
 imageFlushRects() noexcept;
 
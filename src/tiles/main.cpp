@@ -3,6 +3,7 @@
 #include "tiles/client-conf.h"
 #include "tiles/images.h"
 #include "tiles/log.h"
+#include "tiles/replay.h"
 #include "tiles/window.h"
 #include "tiles/world.h"
 #include "util/compiler.h"
@@ -45,6 +46,7 @@ main() noexcept {
     threadDisableTimerCoalescing();
 
     confParse("./client.json");
+    replayInit();
 
     windowCreate();
     imageInit();
@@ -0,0 +1,106 @@
+#include "tiles/motion.h"
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/jobs.h"
+#include "util/math2.h"
+#include "util/vector.h"
+
+#define BLOCK_SIZE 256
+
+void
+motionInit(Motion& motion, Entity* entity) noexcept {
+    motion.entity = entity;
+    motion.r.x = 0.0;
+    motion.r.y = 0.0;
+    motion.r.z = 0.0;
+    motion.prevR = motion.r;
+    motion.prevStep = 0;
+    motion.destCoord = motion.r;
+    motion.direction.x = 0.0;
+    motion.direction.y = 0.0;
+    motion.pixelsPerSecond = 0.0;
+    motion.leftover = 0.0;
+    motion.moving = false;
+    motion.frozen = false;
+    motion.wake = 0;
+}
+
+struct MotionBlock {
+    Motion motions[BLOCK_SIZE];
+
+    // Indices of the Motions whose Entities woke in the last step.
+    U16 awake[BLOCK_SIZE];
+    U32 numAwake;
+};
+
+Motions::Motions() noexcept : used(0) { }
+
+Motions::~Motions() noexcept {
+    for (MotionBlock** block = blocks.begin(); block != blocks.end(); block++)
+        delete *block;
+}
+
+Motion*
+Motions::allocate(Entity* entity) noexcept {
+    Motion* motion;
+
+    if (released.size) {
+        motion = released[released.size - 1];
+        released.pop();
+    }
+    else {
+        if (used == blocks.size * BLOCK_SIZE)
+            blocks.push(new MotionBlock);
+        motion = blocks[used / BLOCK_SIZE]->motions + used % BLOCK_SIZE;
+        used++;
+    }
+
+    motionInit(*motion, entity);
+    return motion;
+}
+
+void
+Motions::release(Motion* motion) noexcept {
+    motion->entity = 0;
+    motion->moving = false;
+    motion->wake = 0;
+    released.push(motion);
+}
+
+void
+Motions::stepBlock(void* data, U32 i) noexcept {
+    Motions* self = static_cast<Motions*>(data);
+    MotionBlock* block = self->blocks[i];
+    U32 n = min(self->used - i * BLOCK_SIZE, static_cast<U32>(BLOCK_SIZE));
+
+    block->numAwake = 0;
+    for (U32 j = 0; j < n; j++) {
+        Motion& motion = block->motions[j];
+        if (motion.entity &&
+            motionStep(motion, self->stepDt, self->stepNumber))
+            block->awake[block->numAwake++] = static_cast<U16>(j);
+    }
+}
+
+void
+Motions::step(Time dt, U32 step, Vector<Entity*>& awake,
+              bool parallel) noexcept {
+    stepDt = dt;
+    stepNumber = step;
+
+    U32 numBlocks = static_cast<U32>(blocks.size);
+    if (parallel) {
+        JobsFor(stepBlock, this, numBlocks);
+    }
+    else {
+        for (U32 i = 0; i < numBlocks; i++)
+            stepBlock(this, i);
+    }
+
+    for (U32 i = 0; i < numBlocks; i++) {
+        MotionBlock* block = blocks[i];
+        for (U32 j = 0; j < block->numAwake; j++)
+            awake.push(block->motions[block->awake[j]].entity);
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef SRC_TILES_MOTION_H_
+#define SRC_TILES_MOTION_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+class Entity;
+struct Exit;
+
+// Reasons an Entity needs its tick() called.
+enum MotionWake {
+    // Got to destCoord this tick. tick() finishes the move.
+    MOTION_ARRIVED = 1 << 0,
+    // Has tick hooks attached.
+    MOTION_HOOKED = 1 << 1,
+    // A Character following a path from walkTo(). It takes the next step
+    // between moves, so this only wakes it while it stands still.
+    MOTION_PATHING = 1 << 2,
+    // An Overlay moving, which is refiled in its Area as it goes.
+    MOTION_DRIFTING = 1 << 3,
+};
+
+// The part of an Entity that changes every tick. An Area keeps those of its
+// Entities together in a Motions, so that stepping thousands of them is one
+// pass over contiguous memory, and only the few with more to do than move
+// are visited themselves.
+struct Motion {
+    // Zero if the Motion is not in use.
+    Entity* entity;
+
+    // Real x,y position: hold partial pixel transversal
+    fvec3 r;
+    // Position before the step numbered prevStep. Set to r when the Entity is
+    // placed somewhere, so that it is not drawn on its way there.
+    fvec3 prevR;
+    U32 prevStep;
+
+    fvec3 destCoord;
+    // Unit vector toward destCoord.
+    fvec2 direction;
+    float pixelsPerSecond;
+    // Part of the tick left over on arrival, for the next move to use.
+    float leftover;
+
+    // True if currently moving to a new coordinate in an Area.
+    bool moving;
+    bool frozen;
+    // MotionWake flags.
+    U8 wake;
+};
+
+void
+motionInit(Motion& motion, Entity* entity) noexcept;
+
+//! Move toward destCoord by dt milliseconds of travel. Returns true on
+//! arrival, which stops the motion.
+static inline bool
+motionMove(Motion& m, Time dt) noexcept {
+    float traveledPixels = m.pixelsPerSecond * static_cast<float>(dt) / 1000.0f;
+    float toDestPixels = distanceTo(m.r, m.destCoord);
+    if (toDestPixels > traveledPixels) {
+        // The destination has not been reached yet.
+        m.r.x += m.direction.x * traveledPixels;
+        m.r.y += m.direction.y * traveledPixels;
+        return false;
+    }
+
+    // We have arrived at the destination.
+    m.r = m.destCoord;
+    m.moving = false;
+    m.leftover = 1.0f - toDestPixels / traveledPixels;
+    return true;
+}
+
+//! Begin step number step, which lasts dt milliseconds. Returns true if the
+//! Entity needs its tick() called.
+static inline bool
+motionStep(Motion& m, Time dt, U32 step) noexcept {
+    m.prevR = m.r;
+    m.prevStep = step;
+
+    if (m.moving && motionMove(m, dt))
+        m.wake |= MOTION_ARRIVED;
+
+    U8 wake = m.wake;
+    if (m.moving)
+        wake &= ~MOTION_PATHING;
+    return wake != 0;
+}
+
+//! A move by one tile, worked out from what the Area looks like before anyone
+//! moves. Making it checks that the tile is free, so the moves of many
+//! Characters can be worked out at once and then made in order.
+struct MoveProposal {
+    ivec2 delta;
+    // Where the Character was when the move was worked out. If it is
+    // elsewhere by the time the move is made, it is worked out again.
+    fvec3 at;
+    ivec3 from;
+    ivec3 dest;
+    fvec3 destCoord;
+    fvec2 direction;
+    Exit* exit;
+};
+
+struct MotionBlock;
+
+// Motions in blocks that never move, so that an Entity can point at its own
+// while more are added.
+class Motions {
+ public:
+    Motions() noexcept;
+    ~Motions() noexcept;
+
+    Motion*
+    allocate(Entity* entity) noexcept;
+    void
+    release(Motion* motion) noexcept;
+
+    //! Begin a step for every Motion, a block at a time across the job
+    //! workers if parallel is set. Entities that need their tick() called
+    //! are added to awake, in the same order either way.
+    void
+    step(Time dt, U32 step, Vector<Entity*>& awake, bool parallel) noexcept;
+
+ private:
+    Motions(const Motions&) noexcept;
+
+    static void
+    stepBlock(void* data, U32 i) noexcept;
+
+    Vector<MotionBlock*> blocks;
+    // Motions handed out from the blocks, in use or not.
+    U32 used;
+    Vector<Motion*> released;
+
+    // Arguments to stepBlock().
+    Time stepDt;
+    U32 stepNumber;
+};
+
+#endif  // SRC_TILES_MOTION_H_
@@ -6,8 +6,8 @@ NPC::arrived() noexcept {
     Character::arrived();
 
     if (destExit) {
-        moving = false;  // Prevent time rollover check in
-                         // Entity::moveTowardDestination().
+        motion->moving = false;  // Prevent time rollover check in
+                                 // Entity::finishMove().
         destroy();
     }
 }
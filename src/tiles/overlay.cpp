@@ -6,35 +6,67 @@
 
 void
 Overlay::tick(Time dt) noexcept {
+    // Movement happened in the Area's pass over its Motions.
     Entity::tick(dt);
-    moveTowardDestination(dt);
+    refile();
+    if (!motion->moving)
+        motion->wake &= ~MOTION_DRIFTING;
+}
+
+void
+Overlay::destroy() noexcept {
+    if (area)
+        area->entityGrid.remove(this);
+    Entity::destroy();
 }
 
 void
 Overlay::teleport(vicoord coord) noexcept {
-    r = area->grid.virt2virt(coord);
+    area->requestRedraw(drawnPixels);
+    motion->r = area->grid.virt2virt(coord);
+    motion->prevR = motion->r;
+    layer = area->grid.findDepth(coord.z);
     redraw = true;
+    refile();
 }
 
 void
 Overlay::drift(ivec2 xy) noexcept {
+    fvec3 r = motion->r;
     ivec2 dest = {static_cast<I32>(r.x) + xy.x, static_cast<I32>(r.y) + xy.y};
     driftTo(dest);
 }
 
 void
 Overlay::driftTo(ivec2 xy) noexcept {
-    fvec3 destCoord = {static_cast<float>(xy.x), static_cast<float>(xy.y), r.z};
-    setDestinationCoordinate(destCoord);
+    fvec3 destCoord = {static_cast<float>(xy.x), static_cast<float>(xy.y),
+                       motion->r.z};
+    setDestinationCoordinate(destCoord, layer);
 
     pickFacingForAngle();
-    moving = true;
+    motion->moving = true;
+    motion->wake |= MOTION_DRIFTING;
     setAnimationMoving();
 
-    // Movement happens in Entity::moveTowardDestination() during tick().
+    // Movement happens in the Area's pass over its Motions during tick().
 }
 
 void
 Overlay::pickFacingForAngle() noexcept {
     // TODO
 }
+
+void
+Overlay::refile() noexcept {
+    if (layer == -1) {
+        // Not on a layer, so never drawn.
+        area->entityGrid.remove(this);
+        return;
+    }
+
+    fvec3 r = motion->r;
+    ivec3 tile = {static_cast<I32>(r.x) / area->grid.tileDim.x,
+                  static_cast<I32>(r.y) / area->grid.tileDim.y, layer};
+    if (tile != indexTile)
+        area->entityGrid.add(this, tile);
+}
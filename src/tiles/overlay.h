@@ -12,6 +12,9 @@ class Overlay : public Entity {
     void
     tick(Time dt) noexcept;
 
+    void
+    destroy() noexcept;
+
     void
     teleport(vicoord coord) noexcept;
 
@@ -23,6 +26,10 @@ class Overlay : public Entity {
  protected:
     void
     pickFacingForAngle() noexcept;
+
+    //! Update our place in the Area's EntityGrid after moving.
+    void
+    refile() noexcept;
 };
 
 #endif  // SRC_TILES_OVERLAY_H_
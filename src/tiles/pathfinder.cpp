@@ -0,0 +1,405 @@
+#include "tiles/pathfinder.h"
+
+#include "os/c.h"
+#include "tiles/entity-grid.h"
+#include "tiles/tile-grid.h"
+#include "util/compiler.h"
+
+// Bits in PathFinder::bits. The low bits are the tile's TILE_NOWALK* flags.
+#define PATH_NOWALK (TILE_NOWALK | TILE_NOWALK_PLAYER | TILE_NOWALK_NPC)
+// The tile has an exit taken upon arriving.
+#define PATH_EXIT 0x08
+// The tile has an exit or layermod taken when leaving in some direction.
+#define PATH_SPECIAL 0x10
+// The tile has a layermod taken upon arriving.
+#define PATH_ARRIVE 0x20
+
+// Values in FlowField::dirs. Otherwise, one more than an index into dirs[].
+#define PATH_DIR_NONE 0
+#define PATH_DIR_GOAL 5
+
+// In the same order as EXIT_UP through EXIT_RIGHT.
+static const ivec2 dirs[4] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+template<typename Map>
+static void
+markTiles(Map& map, PathFinder& pf, U8 bit) noexcept {
+    for (typename Map::iterator it = map.begin(); it != map.end(); ++it) {
+        ivec3 tile = it->key;
+        if (pf.grid.inBounds(tile))
+            pf.bits[pf.indexOf(tile)] |= bit;
+    }
+}
+
+PathFinder::PathFinder(TileGrid& grid, EntityGrid& entities) noexcept
+        : grid(grid), entities(entities), stamp(0), uses(0) {
+    for (I32 i = 0; i < PATH_FLOW_FIELDS; i++) {
+        fields[i].goal = IVEC3_MIN;
+        fields[i].nowalk = 0;
+        fields[i].stale = true;
+        fields[i].lastUse = 0;
+    }
+}
+
+U32
+PathFinder::indexOf(ivec3 tile) noexcept {
+    return (tile.z * grid.dim.y + tile.y) * grid.dim.x + tile.x;
+}
+
+void
+PathFinder::prepare() noexcept {
+    Size n = grid.dim.x * grid.dim.y * grid.dim.z;
+    if (bits.size == n)
+        return;
+
+    bits.resize(n);
+    memset(bits.data, 0, n);
+
+    Hashmap<ivec3, U32, EmptyIcoord>& flags = grid.flags;
+    for (Hashmap<ivec3, U32, EmptyIcoord>::iterator it = flags.begin();
+         it != flags.end(); ++it) {
+        if (grid.inBounds(it->key))
+            bits[indexOf(it->key)] |= static_cast<U8>(it->value &
+                                                      PATH_NOWALK);
+    }
+
+    markTiles(grid.exits[EXIT_NORMAL], *this, PATH_EXIT);
+    markTiles(grid.layermods[EXIT_NORMAL], *this, PATH_ARRIVE);
+    for (I32 i = EXIT_UP; i < EXITS_LENGTH; i++) {
+        markTiles(grid.exits[i], *this, PATH_SPECIAL);
+        markTiles(grid.layermods[i], *this, PATH_SPECIAL);
+    }
+
+    Size area = grid.dim.x * grid.dim.y;
+    columns.resize(area);
+    memset(columns.data, 0, area);
+    for (Size i = 0; i < n; i++)
+        columns[i % area] |= bits[i] & (PATH_SPECIAL | PATH_ARRIVE);
+
+    for (I32 i = 0; i < PATH_FLOW_FIELDS; i++)
+        fields[i].stale = true;
+}
+
+void
+PathFinder::updateBits(ivec3 tile) noexcept {
+    U8 b = 0;
+
+    U32* flags = grid.flags.tryAt(tile);
+    if (flags)
+        b |= static_cast<U8>(*flags & PATH_NOWALK);
+    if (grid.exits[EXIT_NORMAL].contains(tile))
+        b |= PATH_EXIT;
+    if (grid.layermods[EXIT_NORMAL].contains(tile))
+        b |= PATH_ARRIVE;
+    for (I32 i = EXIT_UP; i < EXITS_LENGTH; i++)
+        if (grid.exits[i].contains(tile) || grid.layermods[i].contains(tile))
+            b |= PATH_SPECIAL;
+
+    U32 idx = indexOf(tile);
+    U8 old = bits[idx];
+    bits[idx] = b;
+    if (old == b)
+        return;
+
+    U32 column = tile.y * grid.dim.x + tile.x;
+    U32 area = grid.dim.x * grid.dim.y;
+    columns[column] = 0;
+    for (I32 z = 0; z < grid.dim.z; z++)
+        columns[column] |= bits[column + z * area] &
+                           (PATH_SPECIAL | PATH_ARRIVE);
+
+    for (I32 i = 0; i < PATH_FLOW_FIELDS; i++) {
+        FlowField& field = fields[i];
+        if (field.stale || field.dirs.size != bits.size)
+            continue;
+        // A field routes through a tile if it reached it. A tile that just
+        // became walkable was reached too, if it borders the field, because
+        // fields record directions for blocked tiles next to them.
+        //
+        // Layer changes can connect far-away tiles, so changes to them
+        // invalidate everything.
+        if (((old | b) & (PATH_SPECIAL | PATH_ARRIVE)) ||
+            field.dirs[idx] != PATH_DIR_NONE)
+            field.stale = true;
+    }
+}
+
+void
+PathFinder::invalidate(ivec3 tile) noexcept {
+    if (bits.size == 0 || !grid.inBounds(tile))
+        return;
+    updateBits(tile);
+}
+
+void
+PathFinder::invalidate(icube tiles) noexcept {
+    if (bits.size == 0)
+        return;
+    for (I32 z = tiles.z1; z < tiles.z2; z++)
+        for (I32 y = tiles.y1; y < tiles.y2; y++)
+            for (I32 x = tiles.x1; x < tiles.x2; x++) {
+                ivec3 tile = {x, y, z};
+                if (grid.inBounds(tile))
+                    updateBits(tile);
+            }
+}
+
+// Moves one tile from a tile in direction dir in the same way that
+// Character::moveByTile() would, including layermods. Returns false if the
+// move is not allowed.
+inline bool
+PathFinder::step(ivec3 from, U32 fromIdx, I32 dir, U32 goalIdx, U32 nowalk,
+                 bool avoidOccupied, ivec3& dest, U32& destIdx) noexcept {
+    ivec2 facing = dirs[dir];
+
+    if (bits[fromIdx] & PATH_SPECIAL) {
+        if (grid.exitAt(from, facing))
+            return false;
+        dest = grid.moveDest(from, facing);
+    }
+    else {
+        dest.x = from.x + facing.x;
+        dest.y = from.y + facing.y;
+        dest.z = from.z;
+    }
+
+    if (dest.x < 0 || grid.dim.x <= dest.x || dest.y < 0 ||
+        grid.dim.y <= dest.y || dest.z < 0 || grid.dim.z <= dest.z)
+        return false;
+
+    destIdx = indexOf(dest);
+    U8 b = bits[destIdx];
+    if (b & nowalk)
+        return false;
+    if (destIdx != goalIdx) {
+        if (b & PATH_EXIT)
+            return false;
+        if (avoidOccupied && entities.occupied(dest))
+            return false;
+    }
+
+    if (b & PATH_ARRIVE) {
+        dest.z = grid.depthIndex(*grid.layermods[EXIT_NORMAL].tryAt(dest));
+        destIdx = indexOf(dest);
+    }
+    return true;
+}
+
+static U32
+distance(ivec3 a, ivec3 b) noexcept {
+    I32 dx = a.x - b.x;
+    I32 dy = a.y - b.y;
+    return static_cast<U32>((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+}
+
+bool
+PathFinder::findPath(ivec3 start, ivec3 goal, U32 nowalk,
+                     Vector<ivec2>& steps) noexcept {
+    if (!grid.inBounds(start) || !grid.inBounds(goal))
+        return false;
+    if (start == goal)
+        return true;
+
+    prepare();
+    nowalk &= PATH_NOWALK;
+
+    if (nodes.size != bits.size) {
+        nodes.resize(bits.size);
+        memset(nodes.data, 0, sizeof(PathNode) * nodes.size);
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        memset(nodes.data, 0, sizeof(PathNode) * nodes.size);
+        stamp = 1;
+    }
+
+    U32 goalIdx = indexOf(goal);
+    U32 startIdx = indexOf(start);
+    U32 fMin = distance(start, goal);
+
+    PathNode& first = nodes[startIdx];
+    first.stamp = stamp;
+    first.g = 0;
+    first.parent = UINT32_MAX;
+
+    for (Size i = 0; i < open.size; i++)
+        open[i].clear();
+    if (open.size == 0)
+        open.resize(1);
+    open[0].push(startIdx);
+
+    for (Size bucket = 0; bucket < open.size; bucket++) {
+        // Nodes pushed last are furthest along, so popping them first breaks
+        // ties toward the goal.
+        while (open[bucket].size) {
+            U32 idx = open[bucket][open[bucket].size - 1];
+            open[bucket].pop();
+
+            PathNode& node = nodes[idx];
+            if (node.closed == stamp)
+                // Already reached by a shorter route.
+                continue;
+            node.closed = stamp;
+
+            if (idx == goalIdx) {
+                Size end = steps.size + node.g;
+                steps.resize(end);
+                for (U32 i = idx; nodes[i].parent != UINT32_MAX;
+                     i = nodes[i].parent)
+                    steps[--end] = dirs[nodes[i].dir];
+                return true;
+            }
+
+            I32 x = static_cast<I32>(idx % grid.dim.x);
+            I32 y = static_cast<I32>(idx / grid.dim.x % grid.dim.y);
+            I32 z = static_cast<I32>(idx / grid.dim.x / grid.dim.y);
+            ivec3 here = {x, y, z};
+            U32 g = node.g + 1;
+
+            for (I32 d = 0; d < 4; d++) {
+                ivec3 dest;
+                U32 i;
+                if (!step(here, idx, d, goalIdx, nowalk, true, dest, i))
+                    continue;
+
+                PathNode& next = nodes[i];
+                if (next.stamp == stamp && next.g <= g)
+                    continue;
+
+                next.stamp = stamp;
+                next.g = g;
+                next.parent = idx;
+                next.dir = static_cast<U8>(d);
+
+                Size f = g + distance(dest, goal) - fMin;
+                if (open.size <= f)
+                    open.resize(f + 1);
+                open[f].push(i);
+            }
+        }
+    }
+
+    return false;
+}
+
+FlowField&
+PathFinder::flowField(ivec3 goal, U32 nowalk) noexcept {
+    FlowField* field = 0;
+    for (I32 i = 0; i < PATH_FLOW_FIELDS; i++) {
+        if (fields[i].goal == goal && fields[i].nowalk == nowalk) {
+            field = &fields[i];
+            break;
+        }
+    }
+
+    if (!field) {
+        // Replace the least recently used field.
+        field = &fields[0];
+        for (I32 i = 1; i < PATH_FLOW_FIELDS; i++)
+            if (fields[i].lastUse < field->lastUse)
+                field = &fields[i];
+        field->goal = goal;
+        field->nowalk = nowalk;
+        field->stale = true;
+    }
+
+    if (field->stale || field->dirs.size != bits.size)
+        buildFlowField(*field);
+
+    field->lastUse = ++uses;
+    return *field;
+}
+
+// A breadth-first search outward from the goal that, for every tile, records
+// the direction of a shortest route back.
+//
+// Every tile that can step toward a reached tile is queued, even one that is
+// impossible to walk onto, since walkers may already be standing there or
+// arrive there through a layermod. Whether a queued tile can really be walked
+// onto is decided when it is expanded.
+void
+PathFinder::buildFlowField(FlowField& field) noexcept {
+    ivec3 goal = field.goal;
+    U32 goalIdx = indexOf(goal);
+    U32 nowalk = field.nowalk;
+
+    field.stale = false;
+    field.dirs.resize(bits.size);
+    memset(field.dirs.data, PATH_DIR_NONE, field.dirs.size);
+    U8* fieldDirs = field.dirs.data;
+
+    fieldDirs[goalIdx] = PATH_DIR_GOAL;
+
+    queue.clear();
+    queue.push(goal);
+
+    I32 width = grid.dim.x;
+    I32 height = grid.dim.y;
+    I32 offsets[4] = {-width, width, -1, 1};
+
+    for (Size head = 0; head < queue.size; head++) {
+        ivec3 here = queue[head];
+        U32 idx = indexOf(here);
+        U32 column = here.y * width + here.x;
+
+        // Whether walking onto this tile leaves a walker here. If it has a
+        // layermod, walkers arrive from elsewhere and step() decides.
+        U8 hereBits = bits[idx];
+        bool enterable = (hereBits & nowalk) == 0 &&
+                         ((hereBits & PATH_EXIT) == 0 || idx == goalIdx);
+
+        for (I32 d = 0; d < 4; d++) {
+            ivec3 from = {here.x - dirs[d].x, here.y - dirs[d].y, here.z};
+            if (from.x < 0 || width <= from.x || from.y < 0 ||
+                height <= from.y)
+                continue;
+
+            U32 fromColumn = column - offsets[d];
+
+            if ((columns[fromColumn] | columns[column]) == 0) {
+                // Nothing changes layers, so only the tile behind us on this
+                // layer leads here.
+                U32 fromIdx = idx - offsets[d];
+                if (!enterable || fieldDirs[fromIdx] != PATH_DIR_NONE)
+                    continue;
+
+                fieldDirs[fromIdx] = static_cast<U8>(d + 1);
+                queue.push(from);
+                continue;
+            }
+
+            // Tiles on any layer might lead here through layermods.
+            for (from.z = 0; from.z < grid.dim.z; from.z++) {
+                U32 fromIdx = indexOf(from);
+                if (fieldDirs[fromIdx] != PATH_DIR_NONE)
+                    continue;
+
+                ivec3 dest;
+                U32 destIdx;
+                if (!step(from, fromIdx, d, goalIdx, nowalk, false, dest,
+                          destIdx) ||
+                    destIdx != idx)
+                    continue;
+
+                fieldDirs[fromIdx] = static_cast<U8>(d + 1);
+                queue.push(from);
+            }
+        }
+    }
+}
+
+ivec2
+PathFinder::flowStep(ivec3 from, ivec3 goal, U32 nowalk) noexcept {
+    ivec2 none = {0, 0};
+    if (!grid.inBounds(from) || !grid.inBounds(goal))
+        return none;
+
+    prepare();
+    nowalk &= PATH_NOWALK;
+
+    FlowField& field = flowField(goal, nowalk);
+    U8 dir = field.dirs[indexOf(from)];
+    if (dir == PATH_DIR_NONE || dir == PATH_DIR_GOAL)
+        return none;
+    return dirs[dir - 1];
+}
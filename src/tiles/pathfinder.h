@@ -0,0 +1,122 @@
+#ifndef SRC_TILES_PATHFINDER_H_
+#define SRC_TILES_PATHFINDER_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+class EntityGrid;
+class TileGrid;
+
+// Number of flow fields kept around at once. Each costs a byte per tile.
+#define PATH_FLOW_FIELDS 4
+
+struct PathNode {
+    // Search in which g and parent were last written.
+    U32 stamp;
+    // Search in which the node was expanded.
+    U32 closed;
+    U32 g;
+    // Index of the node we came from, or UINT32_MAX at the start.
+    U32 parent;
+    U8 dir;
+};
+
+// Directions of travel toward one goal for every tile that can reach it.
+struct FlowField {
+    ivec3 goal;
+    U32 nowalk;
+    bool stale;
+    U32 lastUse;
+    // For each tile in the TileGrid, PATH_DIR_NONE if it cannot reach the
+    // goal, PATH_DIR_GOAL if it is the goal, or else which way to go.
+    Vector<U8> dirs;
+};
+
+// Finds routes for Characters through a TileGrid.
+//
+// Routes are four-connected, like Character::moveByTile(). They honor
+// TILE_NOWALK* flags for the given walker, follow layermods between layers,
+// and never take an exit unless the exit is the goal.
+//
+// findPath() runs A* for one walker and treats tiles occupied by other
+// Characters as walls. flowStep() instead shares one breadth-first flow field
+// among all walkers seeking the same goal, such as a crowd chasing the
+// player. Flow fields ignore occupancy since it changes every step, and
+// walkers simply wait when the next tile is occupied.
+//
+// Call invalidate() after changing the flags, exits, or layermods of tiles.
+// Flow fields that could route through a changed tile are rebuilt the next
+// time they are used, while the rest stay cached.
+class PathFinder {
+ public:
+    PathFinder(TileGrid& grid, EntityGrid& entities) noexcept;
+
+    // Appends each step from start to goal to steps. Returns false if goal
+    // cannot be reached, in which case steps is unchanged.
+    //
+    // nowalk is the walker's TILE_NOWALK* flags after exemptions.
+    bool
+    findPath(ivec3 start, ivec3 goal, U32 nowalk,
+             Vector<ivec2>& steps) noexcept;
+
+    // Direction of the next step from a tile toward goal. Returns {0, 0} if
+    // from is the goal or cannot reach it.
+    ivec2
+    flowStep(ivec3 from, ivec3 goal, U32 nowalk) noexcept;
+
+    void
+    invalidate(ivec3 tile) noexcept;
+    void
+    invalidate(icube tiles) noexcept;
+
+ private:
+    void
+    prepare() noexcept;
+    void
+    updateBits(ivec3 tile) noexcept;
+    bool
+    step(ivec3 from, U32 fromIdx, I32 dir, U32 goalIdx, U32 nowalk,
+         bool avoidOccupied, ivec3& dest, U32& destIdx) noexcept;
+    FlowField&
+    flowField(ivec3 goal, U32 nowalk) noexcept;
+    void
+    buildFlowField(FlowField& field) noexcept;
+
+ public:
+    U32
+    indexOf(ivec3 tile) noexcept;
+
+    TileGrid& grid;
+    EntityGrid& entities;
+
+    // Per-tile summary of flags, exits and layermods, so that searching does
+    // not have to consult TileGrid's hashmaps. Empty until first used.
+    Vector<U8> bits;
+
+    // For each x, y position, whether a tile on any layer there has a
+    // layermod or directional exit. Routes that avoid these stay on one
+    // layer, which is the fast case.
+    Vector<U8> columns;
+
+    // Scratch space for findPath(). Every step costs the same and the
+    // heuristic is consistent, so the open list is a bucket per f-score above
+    // the start's, and each bucket is a stack of node indices.
+    Vector<PathNode> nodes;
+    Vector<Vector<U32> > open;
+    U32 stamp;
+
+    FlowField fields[PATH_FLOW_FIELDS];
+    U32 uses;
+
+    // Scratch space for buildFlowField().
+    Vector<ivec3> queue;
+
+ private:
+    PathFinder(const PathFinder&);
+    void
+    operator=(const PathFinder&);
+};
+
+#endif  // SRC_TILES_PATHFINDER_H_
@@ -17,6 +17,8 @@
 Player player;
 
 Player::Player() noexcept : numMovements(0) {
+    motionInit(ownMotion, this);
+    motion = &ownMotion;
     nowalkFlags = TILE_NOWALK | TILE_NOWALK_PLAYER;
     nowalkExempt = TILE_NOWALK_EXIT;
     velocity.x = 0;
@@ -73,9 +75,9 @@ Player::stopMovement(ivec2 delta) noexcept {
 
 void
 Player::moveByTile(ivec2 delta) noexcept {
-    if (frozen)
+    if (motion->frozen)
         return;
-    if (moving)
+    if (motion->moving)
         return;
 
     setFacing(delta);
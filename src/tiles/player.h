@@ -2,6 +2,7 @@
 #define SRC_TILES_PLAYER_H_
 
 #include "tiles/character.h"
+#include "tiles/motion.h"
 #include "tiles/vec.h"
 #include "util/compiler.h"
 
@@ -45,6 +46,9 @@ class Player : public Character {
     //! Stack storing depressed keyboard keys in the form of movement vectors.
     ivec2 movements[8];
     Size numMovements;
+
+    //! The Player goes from Area to Area, so its Motion is its own.
+    Motion ownMotion;
 };
 
 extern Player player;
@@ -0,0 +1,252 @@
+#include "tiles/replay.h"
+
+#include "os/c.h"
+#include "os/io.h"
+#include "os/os.h"
+#include "tiles/client-conf.h"
+#include "tiles/log.h"
+#include "tiles/window.h"
+#include "tiles/world.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/random.h"
+#include "util/string.h"
+
+// A recording is:
+//
+//   "CRPL", a version byte and the random seed, four bytes little-endian,
+//
+// then events, each a tag byte and a number as a LEB128 varint:
+//
+//   KEY_DOWN key
+//   KEY_UP   key
+//   ADVANCE  nanoseconds  hash
+//   TICK     milliseconds hash
+//
+// where hash is worldHash() after the advance, four bytes little-endian.
+
+#define VERSION 1
+#define HEADER_SIZE 9
+
+enum Tag {
+    TAG_KEY_DOWN = 1,
+    TAG_KEY_UP = 2,
+    TAG_ADVANCE = 3,
+    TAG_TICK = 4,
+};
+
+static const char magic[4] = {'C', 'R', 'P', 'L'};
+
+// Written an event at a time, so that the recording is whole however the
+// game exits.
+static FileWriter* output = 0;
+static Size outputSize = 0;
+
+static bool loaded = false;
+static String input;
+static Size inputPosition = 0;
+
+static U32 expectedHash = 0;
+static U32 stepsChecked = 0;
+static bool inStep = true;
+
+static void
+put32(U8* p, U32 x) noexcept {
+    p[0] = static_cast<U8>(x);
+    p[1] = static_cast<U8>(x >> 8);
+    p[2] = static_cast<U8>(x >> 16);
+    p[3] = static_cast<U8>(x >> 24);
+}
+
+static U32
+get32(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8 |
+           static_cast<U32>(p[2]) << 16 | static_cast<U32>(p[3]) << 24;
+}
+
+// Returns the number of bytes written, at most 10.
+static Size
+putVarint(U8* p, U64 x) noexcept {
+    Size n = 0;
+    do {
+        U8 byte = x & 0x7F;
+        x >>= 7;
+        if (x)
+            byte |= 0x80;
+        p[n++] = byte;
+    } while (x);
+    return n;
+}
+
+static bool
+getVarint(U64& x) noexcept {
+    const U8* data = reinterpret_cast<const U8*>(input.data);
+
+    x = 0;
+    for (U32 shift = 0; shift < 64; shift += 7) {
+        if (inputPosition == input.size)
+            return false;
+        U8 byte = data[inputPosition++];
+        x |= static_cast<U64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static void
+write(const U8* data, Size size) noexcept {
+    if (!output->writeOffset(data, size, outputSize)) {
+        logErr("Replay", String() << "Could not write " << confReplayRecord);
+        delete output;
+        output = 0;
+        return;
+    }
+    outputSize += size;
+}
+
+static void
+recordEvent(Tag tag, U64 x, bool hash) noexcept {
+    if (!output)
+        return;
+
+    U8 event[15];
+    event[0] = static_cast<U8>(tag);
+    Size size = 1 + putVarint(event + 1, x);
+    if (hash) {
+        put32(event + size, worldHash());
+        size += 4;
+    }
+
+    write(event, size);
+}
+
+static void
+load() noexcept {
+    if (!readFile(confReplayPlay, input)) {
+        logErr("Replay", String() << "Could not read " << confReplayPlay);
+        return;
+    }
+
+    const U8* data = reinterpret_cast<const U8*>(input.data);
+    if (input.size < HEADER_SIZE || memcmp(data, magic, 4) != 0 ||
+        data[4] != VERSION) {
+        logErr("Replay", String() << confReplayPlay << ": not a recording");
+        return;
+    }
+
+    seedRandom(get32(data + 5));
+    inputPosition = HEADER_SIZE;
+    loaded = true;
+}
+
+static void
+record() noexcept {
+    output = new FileWriter(confReplayRecord);
+    if (!*output) {
+        logErr("Replay", String() << "Could not open " << confReplayRecord);
+        delete output;
+        output = 0;
+        return;
+    }
+
+    U8 header[HEADER_SIZE];
+    memcpy(header, magic, 4);
+    header[4] = VERSION;
+    put32(header + 5, randomState());
+    write(header, sizeof(header));
+}
+
+void
+replayInit() noexcept {
+    if (confReplayPlay.size)
+        load();
+    else if (confReplayRecord.size)
+        record();
+}
+
+void
+replayRecordKey(Key key, bool down) noexcept {
+    recordEvent(down ? TAG_KEY_DOWN : TAG_KEY_UP, key, false);
+}
+
+void
+replayRecordAdvance(Nanoseconds elapsed) noexcept {
+    recordEvent(TAG_ADVANCE, static_cast<U64>(elapsed), true);
+}
+
+void
+replayRecordTick(Time dt) noexcept {
+    recordEvent(TAG_TICK, static_cast<U64>(dt), true);
+}
+
+bool
+replaying() noexcept {
+    return loaded;
+}
+
+bool
+replayNext(ReplayStep& step) noexcept {
+    if (!loaded)
+        return false;
+
+    while (inputPosition < input.size) {
+        U8 tag = static_cast<U8>(input.data[inputPosition++]);
+
+        U64 x;
+        if (!getVarint(x))
+            goto truncated;
+
+        switch (tag) {
+        case TAG_KEY_DOWN:
+            windowEmitKeyDown(static_cast<Key>(x));
+            continue;
+        case TAG_KEY_UP:
+            windowEmitKeyUp(static_cast<Key>(x));
+            continue;
+        case TAG_ADVANCE:
+        case TAG_TICK:
+            if (input.size - inputPosition < 4)
+                goto truncated;
+            expectedHash = get32(
+                    reinterpret_cast<const U8*>(input.data + inputPosition));
+            inputPosition += 4;
+
+            step.tick = tag == TAG_TICK;
+            step.dt = step.tick ? static_cast<Time>(x) : 0;
+            step.elapsed = step.tick ? 0 : static_cast<Nanoseconds>(x);
+            return true;
+        default:
+            logErr("Replay", String() << confReplayPlay << ": unknown event "
+                                      << static_cast<U32>(tag));
+            inStep = false;
+            inputPosition = input.size;
+            return false;
+        }
+    }
+
+    return false;
+
+truncated:
+    // Cut off partway through an event.
+    logErr("Replay", String() << confReplayPlay << ": truncated");
+    inStep = false;
+    inputPosition = input.size;
+    return false;
+}
+
+void
+replayCheck() noexcept {
+    stepsChecked += 1;
+
+    if (inStep && worldHash() != expectedHash) {
+        logErr("Replay", String() << "Step " << stepsChecked
+                                  << " differs from the recording");
+        inStep = false;
+    }
+}
+
+bool
+replayInStep() noexcept {
+    return inStep;
+}
@@ -0,0 +1,62 @@
+#ifndef SRC_TILES_REPLAY_H_
+#define SRC_TILES_REPLAY_H_
+
+#include "os/chrono.h"
+#include "tiles/window.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Recording a session's input so that it can be run again exactly, such as to
+// benchmark it.
+//
+// A recording holds the random seed, then each key press and release and each
+// advance of the game's time, in order. Every advance is followed by
+// worldHash() as it was afterward, which a replay checks to know that it has
+// stayed in step.
+
+//! Start recording to confReplayRecord, or load confReplayPlay and seed the
+//! random number generator from it. Call before the world is initialized.
+void
+replayInit() noexcept;
+
+//
+// Recording. These do nothing unless recording.
+//
+
+void
+replayRecordKey(Key key, bool down) noexcept;
+void
+replayRecordAdvance(Nanoseconds elapsed) noexcept;
+void
+replayRecordTick(Time dt) noexcept;
+
+//
+// Replaying
+//
+
+//! Whether a recording was loaded to be replayed.
+bool
+replaying() noexcept;
+
+//! How the game advances in a step of a replay.
+struct ReplayStep {
+    bool tick;  // Whether by worldTick() rather than worldAdvance().
+    Time dt;
+    Nanoseconds elapsed;
+};
+
+//! Press and release the keys that come before the next advance, and give
+//! the advance. Returns false at the end of the recording.
+bool
+replayNext(ReplayStep& step) noexcept;
+
+//! Check the game against the recording after the step replayNext() gave.
+//! Logs the first step that differs.
+void
+replayCheck() noexcept;
+
+//! Whether every step so far has matched the recording.
+bool
+replayInStep() noexcept;
+
+#endif  // SRC_TILES_REPLAY_H_
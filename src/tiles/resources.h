@@ -2,6 +2,7 @@
 #define SRC_TILES_RESOURCES_H_
 
 #include "util/compiler.h"
+#include "util/int.h"
 #include "util/string-view.h"
 #include "util/string.h"
 
@@ -12,4 +13,23 @@
 bool
 resourceLoad(StringView path, String& data) noexcept;
 
+// Whether a resource exists at the given path. Does not log if it is missing.
+bool
+resourceExists(StringView path) noexcept;
+
+// A resource to be read a piece at a time, for those too large to keep in
+// memory.
+struct Resource {
+    U32 index;
+    U32 size;
+};
+
+bool
+resourceFind(StringView path, Resource& resource) noexcept;
+
+// Read size bytes of a resource, starting offset bytes in. Can be called from
+// any thread.
+bool
+resourceRead(Resource resource, void* buf, U32 offset, U32 size) noexcept;
+
 #endif  // SRC_TILES_RESOURCES_H_
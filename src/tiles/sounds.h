@@ -20,6 +20,11 @@ soundLoad(StringView path) noexcept;
 void
 soundsPrune(Time latestPermissibleUse) noexcept;
 
+// Mix dt milliseconds of sound, for backends that have no audio thread of
+// their own.
+void
+soundsTick(Time dt) noexcept;
+
 //
 // Sound
 //
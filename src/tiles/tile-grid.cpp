@@ -1,8 +1,12 @@
 #include "tiles/tile-grid.h"
 
+#include "os/c.h"
 #include "util/assert.h"
 #include "util/compiler.h"
 #include "util/math2.h"
+#include "util/new.h"
+
+#define TILES_PER_CHUNK (TILE_CHUNK_SIZE * TILE_CHUNK_SIZE)
 
 static I32
 ivec2_to_dir(ivec2 v) noexcept {
@@ -21,15 +25,124 @@ ivec2_to_dir(ivec2 v) noexcept {
     }
 }
 
+static U16
+widthFor(U32 type) noexcept {
+    if (type <= 0xFF)
+        return 1;
+    else if (type <= 0xFFFF)
+        return 2;
+    else
+        return 4;
+}
+
+static U32
+chunkGet(TileChunk& chunk, I32 i) noexcept {
+    switch (chunk.width) {
+    case 0: return 0;
+    case 1: return static_cast<U8*>(chunk.tiles)[i];
+    case 2: return static_cast<U16*>(chunk.tiles)[i];
+    default: return static_cast<U32*>(chunk.tiles)[i];
+    }
+}
+
+static void
+chunkPut(TileChunk& chunk, I32 i, U32 type) noexcept {
+    switch (chunk.width) {
+    case 1: static_cast<U8*>(chunk.tiles)[i] = static_cast<U8>(type); break;
+    case 2: static_cast<U16*>(chunk.tiles)[i] = static_cast<U16>(type); break;
+    default: static_cast<U32*>(chunk.tiles)[i] = type; break;
+    }
+}
+
+// Re-encode a chunk's tiles at a larger width.
+static void
+chunkWiden(TileChunk& chunk, U16 width) noexcept {
+    void* tiles = malloc(TILES_PER_CHUNK * width);
+    TileChunk wide;
+    wide.tiles = tiles;
+    wide.width = width;
+    for (I32 i = 0; i < TILES_PER_CHUNK; i++)
+        chunkPut(wide, i, chunkGet(chunk, i));
+    free(chunk.tiles);
+    chunk.tiles = tiles;
+    chunk.width = width;
+}
+
+template<typename Map>
+static void
+eraseTile(Map& map, ivec3 tile) noexcept {
+    typename Map::iterator it = map.find(tile);
+    if (it != map.end())
+        map.erase(it);
+}
+
 TileGrid::TileGrid() noexcept : loopX(false), loopY(false) {
     dim.x = dim.y = dim.z = 0;
+    chunksDim.x = chunksDim.y = 0;
     tileDim.x = tileDim.y = 0;
 }
 
+TileGrid::~TileGrid() noexcept {
+    for (TileChunk* chunk = chunks.begin(); chunk != chunks.end(); chunk++)
+        free(chunk->tiles);
+}
+
+void
+TileGrid::allocateLayer(LayerType type) noexcept {
+    chunksDim.x = (dim.x + TILE_CHUNK_MASK) >> TILE_CHUNK_SHIFT;
+    chunksDim.y = (dim.y + TILE_CHUNK_MASK) >> TILE_CHUNK_SHIFT;
+
+    layerTypes.push(type);
+    chunks.resize(chunks.size + chunksDim.x * chunksDim.y);
+    dim.z++;
+}
+
+void
+TileGrid::clearChunk(ivec2 c) noexcept {
+    assert_(0 <= c.x && c.x < chunksDim.x);
+    assert_(0 <= c.y && c.y < chunksDim.y);
+
+    I32 x1 = c.x << TILE_CHUNK_SHIFT;
+    I32 y1 = c.y << TILE_CHUNK_SHIFT;
+    I32 x2 = min(x1 + TILE_CHUNK_SIZE, dim.x);
+    I32 y2 = min(y1 + TILE_CHUNK_SIZE, dim.y);
+
+    for (I32 z = 0; z < dim.z; z++) {
+        TileChunk& chunk = chunks[(z * chunksDim.y + c.y) * chunksDim.x + c.x];
+        free(chunk.tiles);
+        chunk.tiles = 0;
+        chunk.width = 0;
+        chunk.used = 0;
+        chunk.version++;
+
+        for (I32 y = y1; y < y2; y++) {
+            for (I32 x = x1; x < x2; x++) {
+                ivec3 tile = {x, y, z};
+                eraseTile(flags, tile);
+                for (Size i = 0; i < EXITS_LENGTH; i++) {
+                    eraseTile(exits[i], tile);
+                    eraseTile(layermods[i], tile);
+                }
+                for (Size i = 0; i < SCRIPT_TYPE_LAST; i++)
+                    eraseTile(scripts[i], tile);
+            }
+        }
+    }
+}
+
 U32
 TileGrid::getTileType(ivec3 phys) noexcept {
-    I32 idx = (phys.z * dim.y + phys.y) * dim.x + phys.x;
-    return graphics[idx];
+    assert_(0 <= phys.x && phys.x < dim.x);
+    assert_(0 <= phys.y && phys.y < dim.y);
+    assert_(0 <= phys.z && phys.z < dim.z);
+
+    I32 cx = phys.x >> TILE_CHUNK_SHIFT;
+    I32 cy = phys.y >> TILE_CHUNK_SHIFT;
+    TileChunk& chunk = chunks[(phys.z * chunksDim.y + cy) * chunksDim.x + cx];
+
+    I32 i = ((phys.y & TILE_CHUNK_MASK) << TILE_CHUNK_SHIFT) |
+            (phys.x & TILE_CHUNK_MASK);
+    return chunkGet(chunk, i);
 }
 
 U32
@@ -38,11 +151,96 @@ TileGrid::getTileType(vicoord virt) noexcept {
 }
 
 void
-TileGrid::setTileType(vicoord virt, U32 type) noexcept {
-    ivec3 phys = virt2phys(virt);
+TileGrid::getTileRow(ivec3 phys, I32 count, U32* out) noexcept {
+    assert_(0 <= phys.x && phys.x + count <= dim.x);
+    assert_(0 <= phys.y && phys.y < dim.y);
+    assert_(0 <= phys.z && phys.z < dim.z);
+
+    I32 cy = phys.y >> TILE_CHUNK_SHIFT;
+    TileChunk* row = chunks.data + (phys.z * chunksDim.y + cy) * chunksDim.x;
+    I32 rowStart = (phys.y & TILE_CHUNK_MASK) << TILE_CHUNK_SHIFT;
+
+    I32 x = phys.x;
+    I32 end = phys.x + count;
+
+    // Decode one chunk's span of the row at a time.
+    while (x < end) {
+        TileChunk& chunk = row[x >> TILE_CHUNK_SHIFT];
+        I32 first = x & TILE_CHUNK_MASK;
+        I32 n = min(TILE_CHUNK_SIZE - first, end - x);
+        I32 i = rowStart + first;
 
-    I32 idx = (phys.z * dim.y + phys.y) * dim.x + phys.x;
-    graphics[idx] = type;
+        switch (chunk.width) {
+        case 0: memset(out, 0, sizeof(U32) * n); break;
+        case 1: {
+            U8* tiles = static_cast<U8*>(chunk.tiles) + i;
+            for (I32 j = 0; j < n; j++)
+                out[j] = tiles[j];
+            break;
+        }
+        case 2: {
+            U16* tiles = static_cast<U16*>(chunk.tiles) + i;
+            for (I32 j = 0; j < n; j++)
+                out[j] = tiles[j];
+            break;
+        }
+        default:
+            memcpy(out, static_cast<U32*>(chunk.tiles) + i, sizeof(U32) * n);
+            break;
+        }
+
+        out += n;
+        x += n;
+    }
+}
+
+void
+TileGrid::setTileType(ivec3 phys, U32 type) noexcept {
+    assert_(0 <= phys.x && phys.x < dim.x);
+    assert_(0 <= phys.y && phys.y < dim.y);
+    assert_(0 <= phys.z && phys.z < dim.z);
+
+    I32 cx = phys.x >> TILE_CHUNK_SHIFT;
+    I32 cy = phys.y >> TILE_CHUNK_SHIFT;
+    TileChunk& chunk = chunks[(phys.z * chunksDim.y + cy) * chunksDim.x + cx];
+
+    I32 i = ((phys.y & TILE_CHUNK_MASK) << TILE_CHUNK_SHIFT) |
+            (phys.x & TILE_CHUNK_MASK);
+    U32 old = chunkGet(chunk, i);
+
+    if (old == type)
+        return;
+
+    chunk.version++;
+
+    if (type == 0) {
+        chunkPut(chunk, i, 0);
+        if (--chunk.used == 0) {
+            free(chunk.tiles);
+            chunk.tiles = 0;
+            chunk.width = 0;
+        }
+        return;
+    }
+
+    U16 width = widthFor(type);
+    if (chunk.width == 0) {
+        chunk.tiles = malloc(TILES_PER_CHUNK * width);
+        memset(chunk.tiles, 0, TILES_PER_CHUNK * width);
+        chunk.width = width;
+    }
+    else if (chunk.width < width) {
+        chunkWiden(chunk, width);
+    }
+
+    chunkPut(chunk, i, type);
+    if (old == 0)
+        chunk.used++;
+}
+
+void
+TileGrid::setTileType(vicoord virt, U32 type) noexcept {
+    setTileType(virt2phys(virt), type);
 }
 
 bool
@@ -106,8 +304,9 @@ TileGrid::virt2virt(fvec3 virt) noexcept {
 
 I32
 TileGrid::depthIndex(float depth) noexcept {
-    assert_(depth2idx.contains(depth) && "Attempt to access invalid layer");
-    return depth2idx[depth];
+    I32 idx = findDepth(depth);
+    assert_(idx != -1 && "Attempt to access invalid layer");
+    return idx;
 }
 
 float
@@ -116,6 +315,41 @@ TileGrid::indexDepth(I32 idx) noexcept {
     return idx2depth[(Size)idx];
 }
 
+I32
+TileGrid::findDepth(float depth) noexcept {
+    Size lo = 0;
+    Size hi = depth2idx.size;
+    while (lo < hi) {
+        Size mid = (lo + hi) / 2;
+        if (depth2idx.data[mid].depth < depth)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < depth2idx.size && depth2idx.data[lo].depth == depth)
+        return depth2idx.data[lo].idx;
+    return -1;
+}
+
+bool
+TileGrid::setLayerDepth(I32 idx, float depth) noexcept {
+    assert_(0 <= idx);
+
+    Size i = 0;
+    while (i < depth2idx.size && depth2idx.data[i].depth < depth)
+        i++;
+    if (i < depth2idx.size && depth2idx.data[i].depth == depth)
+        return false;
+
+    LayerDepth entry = {depth, idx};
+    depth2idx.insert(i, entry);
+
+    if (idx2depth.size <= static_cast<Size>(idx))
+        idx2depth.resize(idx + 1);
+    idx2depth[idx] = depth;
+    return true;
+}
+
 ivec3
 TileGrid::moveDest(ivec3 from, ivec2 facing) noexcept {
     ivec3 dest = from;
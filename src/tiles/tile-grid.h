@@ -5,6 +5,7 @@
 #include "tiles/vec.h"
 #include "util/compiler.h"
 #include "util/hashtable.h"
+#include "util/int.h"
 #include "util/string.h"
 #include "util/vector.h"
 
@@ -69,11 +70,34 @@ struct Exit {
 
 typedef void (*TileScript)(Entity& triggeredBy, ivec3 tile);
 
-struct EmptyFloat {
-    static constexpr11 float
-    value() noexcept {
-        return FLT_MIN;
-    }
+// Tiles are stored in square chunks of TILE_CHUNK_SIZE x TILE_CHUNK_SIZE per
+// layer. Chunks that hold no tiles have no storage, and chunks that do use the
+// narrowest integer width that fits their largest tile type.
+#define TILE_CHUNK_SHIFT 5
+#define TILE_CHUNK_SIZE  (1 << TILE_CHUNK_SHIFT)
+#define TILE_CHUNK_MASK  (TILE_CHUNK_SIZE - 1)
+
+struct TileChunk {
+    TileChunk() noexcept : tiles(0), width(0), used(0), version(0) { }
+
+    // TILE_CHUNK_SIZE * TILE_CHUNK_SIZE tiles of width bytes each, in
+    // row-major order. Null if the chunk is empty.
+    void* tiles;
+
+    // Bytes per tile: 0 if empty, or 1, 2, or 4.
+    U16 width;
+
+    // Number of non-zero tiles. The chunk is freed when this reaches zero.
+    U16 used;
+
+    // Incremented whenever a tile in the chunk changes, so that anything
+    // derived from the chunk's tiles knows to rebuild.
+    U32 version;
+};
+
+struct LayerDepth {
+    float depth;
+    I32 idx;
 };
 
 struct EmptyIcoord {
@@ -84,17 +108,37 @@ struct EmptyIcoord {
 };
 
 class TileGrid {
+ public:
+    enum LayerType { TILE_LAYER, OBJECT_LAYER };
+
  public:
     TileGrid() noexcept;
+    ~TileGrid() noexcept;
 
     U32
     getTileType(ivec3 phys) noexcept;
     U32
     getTileType(vicoord virt) noexcept;
 
+    // Copies the types of count tiles starting at phys and walking in the +x
+    // direction into out. The tiles must all be in bounds.
+    void
+    getTileRow(ivec3 phys, I32 count, U32* out) noexcept;
+
+    void
+    setTileType(ivec3 phys, U32 type) noexcept;
     void
     setTileType(vicoord virt, U32 type) noexcept;
 
+    // Appends an empty layer of the specified type, incrementing dim.z.
+    void
+    allocateLayer(LayerType type) noexcept;
+
+    // Empties the chunk at chunk coordinate c on every layer, along with any
+    // flags, exits, layermods, and scripts attached to its tiles.
+    void
+    clearChunk(ivec2 c) noexcept;
+
     //! Returns true if a Tile exists at the specified coordinate.
     bool
     inBounds(ivec3 phys) noexcept;
@@ -127,6 +171,16 @@ class TileGrid {
     float
     indexDepth(I32 idx) noexcept;
 
+    // Returns the physical index of a layer depth, or -1 if there is no layer
+    // at that depth.
+    I32
+    findDepth(float depth) noexcept;
+
+    // Assigns a virtual depth to the layer at physical index idx. Returns
+    // false if another layer already has that depth.
+    bool
+    setLayerDepth(I32 idx, float depth) noexcept;
+
     // Gets the correct destination for an Entity wanting to move off of this
     // tile in <code>facing</code> direction.
     //
@@ -146,10 +200,13 @@ class TileGrid {
     layermodAt(ivec3 from, ivec2 facing) noexcept;
 
  public:
-    // 3-dimensional array of the tiles that make up the grid.
-    Vector<U32> graphics;
+    // 3-dimensional array of the chunks that make up the grid, indexed by
+    // (z * chunksDim.y + cy) * chunksDim.x + cx.
+    Vector<TileChunk> chunks;
+
+    // Number of chunks across and down a layer.
+    ivec2 chunksDim;
 
-    enum LayerType { TILE_LAYER, OBJECT_LAYER };
     Vector<LayerType> layerTypes;
 
     // 3-dimensional length of map.
@@ -159,8 +216,10 @@ class TileGrid {
     // same size.
     ivec2 tileDim;
 
-    // Maps virtual float-point depths to an index in our map array.
-    Hashmap<float, I32, EmptyFloat> depth2idx;
+    // Maps virtual float-point depths to an index in our map array. Sorted by
+    // depth. There are only a handful of layers, so a binary search beats
+    // hashing.
+    Vector<LayerDepth> depth2idx;
 
     // Maps an index in our map array to a virtual float-point depth.
     Vector<float> idx2depth;
@@ -168,8 +227,6 @@ class TileGrid {
     bool loopX;
     bool loopY;
 
-    Hashmap<ivec3, bool, EmptyIcoord> occupied;
-
     enum ScriptType {
         SCRIPT_TYPE_ENTER,
         SCRIPT_TYPE_LEAVE,
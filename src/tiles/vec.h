@@ -27,6 +27,11 @@ struct icube {
     I32 x2, y2, z2;
 };
 
+struct irect {
+    I32 x1, y1;
+    I32 x2, y2;
+};
+
 ivec2 operator+(ivec2, ivec2) noexcept;
 ivec3 operator+(ivec3, ivec3) noexcept;
 fvec2 operator+(fvec2, fvec2) noexcept;
@@ -57,7 +57,7 @@ offsetForPt(fvec2 pt) noexcept {
 
 static void
 _jumpToEntity(Entity* e) noexcept {
-    fvec3 pos = e->getPixelCoord();
+    fvec3 pos = e->getDrawCoord();
     ivec2 td = viewportArea->grid.tileDim;
     fvec2 center = {pos.x + td.x / 2, pos.y + td.y / 2};
     off = offsetForPt(center);
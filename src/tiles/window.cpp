@@ -1,6 +1,7 @@
 #include "tiles/window.h"
 
 #include "os/os.h"
+#include "tiles/replay.h"
 #include "tiles/world.h"
 #include "util/compiler.h"
 
@@ -10,6 +11,8 @@ void
 windowEmitKeyDown(Key key) noexcept {
     bool wasDown = !!(windowKeysDown & key);
 
+    replayRecordKey(key, true);
+
     windowKeysDown |= key;
 
     if (windowKeysDown & KEY_ESCAPE &&
@@ -26,6 +29,8 @@ void
 windowEmitKeyUp(Key key) noexcept {
     bool wasDown = !!(windowKeysDown & key);
 
+    replayRecordKey(key, false);
+
     windowKeysDown &= ~key;
 
     if (wasDown)
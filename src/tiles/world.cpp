@@ -1,36 +1,77 @@
 #include "tiles/world.h"
 
 #include "data/data-world.h"
+#include "os/c.h"
+#include "os/chrono.h"
+#include "tiles/animation.h"
 #include "tiles/area-json.h"
 #include "tiles/area.h"
 #include "tiles/client-conf.h"
 #include "tiles/display-list.h"
+#include "tiles/images.h"
 #include "tiles/log.h"
 #include "tiles/music.h"
 #include "tiles/overlay.h"
 #include "tiles/player.h"
+#include "tiles/replay.h"
 #include "tiles/resources.h"
+#include "tiles/sounds.h"
 #include "tiles/viewport.h"
 #include "tiles/window.h"
 #include "util/compiler.h"
+#include "util/fnv.h"
 #include "util/hashtable.h"
+#include "util/math2.h"
+#include "util/random.h"
 //#include "util/measure.h"
 #include "util/vector.h"
 
 // ScriptRef keydownScript, keyupScript;
 
+// Most real time a call to worldAdvance() will catch up on. Beyond this, the
+// game slows down instead of spending ever longer frames catching up.
+#define MAX_CATCH_UP 250
+
+// Milliseconds an unused image or sound stays resident after an area change,
+// so that going back and forth does not reload it.
+#define IMAGE_KEEP 30000
+
 static Hashmap<String, Area*> areas;
 static Area* worldArea = 0;
 
+// An Area the player left that is still ticked, now and then, while another
+// is focused.
+struct BackgroundArea {
+    Area* area;
+    Time owed;  // Game time since it was last ticked.
+};
+
+// Most recently left last. The next to tick is at backgroundNext, so that
+// when the budget runs out the others get their turn on the next frame.
+static Vector<BackgroundArea> background;
+static Size backgroundNext = 0;
+
 /**
  * Total unpaused game run time.
  */
 static Time total = 0;
 
+/**
+ * Real time passed but not yet simulated, and how far that is into the next
+ * step.
+ */
+static Nanoseconds unsimulated = 0;
+static float interpolation = 1.0f;
+static U32 steps = 0;
+
 static bool alive = false;
 static bool redraw = false;
 static I32 paused = 0;
 
+// Loaded the first time the game is paused and kept from then on.
+static Image pauseOverlay = {};
+static bool pauseOverlayLoaded = false;
+
 static Keys keyStates[10];
 static Size numKeyStates = 0;
 
@@ -92,6 +133,8 @@ void
 worldDraw(DisplayList* display) noexcept {
     // TimeMeasure m("Drew world");
 
+    // Pausing and unpausing change the whole screen.
+    bool all = redraw;
     redraw = false;
 
     display->loopX = worldArea->grid.loopX;
@@ -105,7 +148,17 @@ worldDraw(DisplayList* display) noexcept {
     display->colorOverlayARGB = worldArea->getColorOverlay();
     display->paused = paused > 0;
 
+    if (paused && !pauseOverlayLoaded) {
+        pauseOverlay = imageLoad("resource/pause_overlay.bmp");
+        pauseOverlayLoaded = true;
+    }
+    display->pauseOverlay = pauseOverlay;
+
     worldArea->draw(display);
+    animationsDrawn();
+
+    if (all)
+        display->damage.clear();
 }
 
 bool
@@ -113,14 +166,116 @@ worldNeedsRedraw() noexcept {
     return redraw || (!paused && worldArea->needsRedraw());
 }
 
-void
-worldTick(Time dt) noexcept {
+static void
+tick(Time dt) noexcept {
     if (paused)
         return;
 
     total += dt;
+    steps += 1;
 
     worldArea->tick(dt);
+    animationsTick(total);
+    soundsTick(dt);
+
+    for (BackgroundArea* b = background.begin(); b != background.end(); b++)
+        b->owed = min(b->owed + dt, static_cast<Time>(MAX_CATCH_UP));
+}
+
+// Tick the Areas in the background that are due, for as long as the budget
+// allows. Called once a frame.
+static void
+tickBackground() noexcept {
+    if (!background.size || confMoveMode == TURN)
+        return;
+
+    // Stay deterministic for the recording.
+    bool budgeted = !replaying() && !confReplayRecord.size;
+    Nanoseconds budget = static_cast<Nanoseconds>(confBackgroundBudget) * 1000;
+    Nanoseconds start = chronoNow();
+
+    for (Size n = 0; n < background.size; n++) {
+        if (budgeted && chronoNow() - start >= budget)
+            break;
+
+        if (backgroundNext >= background.size)
+            backgroundNext = 0;
+        BackgroundArea& b = background[backgroundNext++];
+
+        if (b.owed < confBackgroundInterval)
+            continue;
+        b.area->backgroundTick(b.owed);
+        b.owed = 0;
+    }
+}
+
+void
+worldTick(Time dt) noexcept {
+    tick(dt);
+    tickBackground();
+    replayRecordTick(dt);
+}
+
+void
+worldAdvance(Nanoseconds elapsed) noexcept {
+    if (paused) {
+        unsimulated = 0;
+        replayRecordAdvance(elapsed);
+        return;
+    }
+
+    const Nanoseconds step = WORLD_STEP * 1000000;
+
+    unsimulated += elapsed;
+    if (unsimulated > MAX_CATCH_UP * 1000000) {
+        logInfo("World", String() << "Skipped "
+                                  << ns_to_ms(unsimulated) - MAX_CATCH_UP
+                                  << " ms");
+        unsimulated = MAX_CATCH_UP * 1000000;
+    }
+
+    while (unsimulated >= step && !paused) {
+        tick(WORLD_STEP);
+        unsimulated -= step;
+    }
+
+    interpolation = static_cast<float>(unsimulated) / step;
+
+    tickBackground();
+
+    // Follow the tracked entity to where it will be drawn.
+    viewportTick(0);
+
+    replayRecordAdvance(elapsed);
+}
+
+float
+worldInterpolation() noexcept {
+    return interpolation;
+}
+
+U32
+worldSteps() noexcept {
+    return steps;
+}
+
+U32
+worldHash() noexcept {
+    // What the game does next follows from these. NPCs that wander draw on
+    // the random number generator, so they are covered by its state.
+    U32 state[9];
+    state[0] = static_cast<U32>(total);
+    state[1] = static_cast<U32>(total >> 32);
+    state[2] = steps;
+    state[3] = static_cast<U32>(paused);
+    fvec3 r = player.getPixelCoord();
+    memcpy(state + 4, &r, sizeof(r));
+    state[7] = static_cast<U32>(player.facing.x + 1) |
+               static_cast<U32>(player.facing.y + 1) << 2;
+    state[8] = randomState();
+
+    return static_cast<U32>(
+            fnvHash(reinterpret_cast<const char*>(state), sizeof(state)));
 }
 
 void
@@ -156,10 +311,26 @@ worldFocusArea(StringView filename, vicoord playerPos) noexcept {
 
 void
 worldFocusArea(Area* area_, vicoord playerPos) noexcept {
+    for (Size i = 0; i < background.size; i++) {
+        if (background[i].area == area_) {
+            background.erase(i);
+            break;
+        }
+    }
+    if (worldArea && worldArea != area_ && confBackgroundAreas > 0) {
+        if (background.size == static_cast<Size>(confBackgroundAreas))
+            background.erase(0);
+        BackgroundArea b = {worldArea, 0};
+        background.push(b);
+    }
+
     worldArea = area_;
     player.setArea(worldArea, playerPos);
     viewportSetArea(worldArea);
     worldArea->focus();
+
+    imagesPrune(worldTime() - IMAGE_KEEP);
+    soundsPrune(worldTime() - IMAGE_KEEP);
 }
 
 void
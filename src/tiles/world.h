@@ -1,6 +1,7 @@
 #ifndef SRC_TILES_WORLD_H_
 #define SRC_TILES_WORLD_H_
 
+#include "os/chrono.h"
 #include "tiles/vec.h"
 #include "tiles/window.h"
 #include "util/compiler.h"
@@ -62,6 +63,41 @@ worldNeedsRedraw() noexcept;
 void
 worldTick(Time dt) noexcept;
 
+/**
+ * Milliseconds the game advances in each step of worldAdvance().
+ */
+#define WORLD_STEP 4
+
+/**
+ * Advance the game by as many whole steps as fit in the real time that has
+ * passed, carrying the rest over to the next call. Until the next step,
+ * entities are drawn part of the way between where the last two steps left
+ * them, by worldInterpolation().
+ */
+void
+worldAdvance(Nanoseconds elapsed) noexcept;
+
+/**
+ * How far the game is between its last step and the next, from 0 to 1. Is 1
+ * if the game is ticked directly.
+ */
+float
+worldInterpolation() noexcept;
+
+/**
+ * Number of times the game has been ticked.
+ */
+U32
+worldSteps() noexcept;
+
+/**
+ * Hash of the game's state: its time, the player and the random number
+ * generator. Two runs given the same input have the same hash after each
+ * step.
+ */
+U32
+worldHash() noexcept;
+
 /**
  * Update the game world when the turn is over (Player moves).
  *
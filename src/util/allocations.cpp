@@ -0,0 +1,12 @@
+#include "util/allocations.h"
+
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+Size allocations = 0;
+
+Size
+allocationsCount() noexcept {
+    return atomicLoad(&allocations);
+}
@@ -0,0 +1,18 @@
+#ifndef SRC_UTIL_ALLOCATIONS_H_
+#define SRC_UTIL_ALLOCATIONS_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Counting calls to malloc, for benchmarks. An executable opts in by linking
+// count-allocations.cpp, which stands in for glibc's malloc. Libraries never
+// do, so that programs using them keep their own.
+
+// Incremented by count-allocations.cpp, from any thread.
+extern Size allocations;
+
+//! Calls to malloc so far, or 0 if they are not being counted.
+Size
+allocationsCount() noexcept;
+
+#endif  // SRC_UTIL_ALLOCATIONS_H_
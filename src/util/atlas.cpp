@@ -0,0 +1,170 @@
+#include "util/atlas.h"
+
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/fnv.h"
+#include "util/hashtable.h"
+#include "util/int.h"
+#include "util/math2.h"
+#include "util/new.h"
+#include "util/rect-packer.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+bool
+operator==(AtlasSpot a, AtlasSpot b) noexcept {
+    return a.texture == b.texture && a.x == b.x && a.y == b.y;
+}
+
+bool
+operator!=(AtlasSpot a, AtlasSpot b) noexcept {
+    return !(a == b);
+}
+
+Size
+hash_(AtlasSpot spot) noexcept {
+    return fnvHash(reinterpret_cast<char*>(&spot), sizeof(spot));
+}
+
+Atlas::Atlas(AtlasHooks hooks) noexcept : hooks(hooks), pageBytes(0) { }
+
+Atlas::~Atlas() noexcept {
+    for (Hashmap<String, AtlasImage*>::iterator it = images.begin();
+         it != images.end(); ++it)
+        delete it->value;
+}
+
+AtlasImage&
+Atlas::image(StringView path) noexcept {
+    AtlasImage*& image = images[path];
+    if (image == 0)
+        image = new AtlasImage();
+    return *image;
+}
+
+bool
+Atlas::place(AtlasImage& image, U32 width, U32 height, Size budget,
+             Time now) noexcept {
+    assert_(image.texture == 0);
+
+    PackedRect rect;
+    AtlasPage* page = 0;
+
+    U32 pageWidth = max(width, static_cast<U32>(ATLAS_SIZE));
+    U32 pageHeight = max(height, static_cast<U32>(ATLAS_SIZE));
+    Size bytes = pageWidth * pageHeight * 4;
+
+    do {
+        for (AtlasPage* p = pages.begin(); p != pages.end(); p++) {
+            if (p->packer.insert(width, height, rect)) {
+                page = p;
+                break;
+            }
+        }
+    } while (page == 0 && pageBytes + bytes > budget && evictOldest(now));
+
+    bool withinBudget = true;
+
+    if (page == 0) {
+        withinBudget = pageBytes + bytes <= budget;
+
+        pages.push(AtlasPage());
+        page = &pages[pages.size - 1];
+        page->texture = hooks.makeTexture(pageWidth, pageHeight);
+        page->packer.reset(pageWidth, pageHeight);
+        page->numImages = 0;
+        page->numPending = 0;
+        pageBytes += bytes;
+
+        bool placed = page->packer.insert(width, height, rect);
+        assert_(placed);
+        (void)placed;
+    }
+
+    page->numImages += 1;
+
+    image.texture = page->texture;
+    image.x = rect.x;
+    image.y = rect.y;
+    image.width = width;
+    image.height = height;
+
+    AtlasSpot spot = {image.texture, image.x, image.y};
+    placed[spot] = &image;
+
+    return withinBudget;
+}
+
+AtlasImage*
+Atlas::find(void* texture, U32 x, U32 y) noexcept {
+    AtlasSpot spot = {texture, x, y};
+    AtlasImage** image = placed.tryAt(spot);
+    return image ? *image : 0;
+}
+
+AtlasPage*
+Atlas::findPage(void* texture) noexcept {
+    for (AtlasPage* page = pages.begin(); page != pages.end(); page++)
+        if (page->texture == texture)
+            return page;
+    return 0;
+}
+
+void
+Atlas::prune(Time latestPermissibleUse) noexcept {
+    for (Hashmap<String, AtlasImage*>::iterator it = images.begin();
+         it != images.end(); ++it) {
+        AtlasImage& image = *it->value;
+        if (image.numUsers == 0 && image.texture &&
+            image.lastUse < latestPermissibleUse)
+            evict(it->key, image);
+    }
+}
+
+void
+Atlas::evict(StringView path, AtlasImage& image) noexcept {
+    AtlasPage* page = findPage(image.texture);
+    assert_(page);
+
+    hooks.evicted(path, image, *page);
+
+    AtlasSpot spot = {image.texture, image.x, image.y};
+    placed.erase(spot);
+
+    PackedRect rect = {image.x, image.y, image.width, image.height};
+    page->packer.release(rect);
+    image.texture = 0;
+
+    page->numImages -= 1;
+    if (page->numImages == 0)
+        destroyPage(page);
+}
+
+// Evict the least recently used image that is not used now. Images released
+// this frame may still be queued for drawing, so they stay. Returns false if
+// there is nothing to evict.
+bool
+Atlas::evictOldest(Time now) noexcept {
+    Hashmap<String, AtlasImage*>::iterator oldest = images.end();
+    for (Hashmap<String, AtlasImage*>::iterator it = images.begin();
+         it != images.end(); ++it) {
+        AtlasImage& image = *it->value;
+        if (image.numUsers > 0 || image.texture == 0 || image.lastUse >= now)
+            continue;
+        if (oldest == images.end() || image.lastUse < oldest->value->lastUse)
+            oldest = it;
+    }
+
+    if (oldest == images.end())
+        return false;
+
+    evict(oldest->key, *oldest->value);
+    return true;
+}
+
+void
+Atlas::destroyPage(AtlasPage* page) noexcept {
+    hooks.destroyTexture(page->texture);
+    pageBytes -= page->packer.width * page->packer.height * 4;
+    pages.eraseUnordered(page - pages.begin());
+}
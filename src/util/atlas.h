@@ -0,0 +1,116 @@
+#ifndef SRC_UTIL_ATLAS_H_
+#define SRC_UTIL_ATLAS_H_
+
+#include "util/compiler.h"
+#include "util/hashtable.h"
+#include "util/int.h"
+#include "util/rect-packer.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Images are packed into atlas pages of this size. An image larger than a
+// page gets a page of its own.
+#define ATLAS_SIZE 2048
+
+struct AtlasPage {
+    void* texture;
+    RectPacker packer;
+    // Number of resident images placed in the page.
+    Size numImages;
+    // Number of those whose pixels the backend has yet to copy in.
+    Size numPending;
+};
+
+// Images stay resident while anything uses them. Once unused, they stay until
+// prune() or until their space is needed to keep the atlas within its
+// budget, least recently used first.
+struct AtlasImage {
+    // Zero while not resident.
+    void* texture;
+    U32 x, y, width, height;
+
+    int numUsers;
+    Time lastUse;
+};
+
+// Where an image is placed: its page's texture and its top-left corner.
+struct AtlasSpot {
+    void* texture;
+    U32 x, y;
+};
+
+bool
+operator==(AtlasSpot a, AtlasSpot b) noexcept;
+bool
+operator!=(AtlasSpot a, AtlasSpot b) noexcept;
+
+Size
+hash_(AtlasSpot spot) noexcept;
+
+// How a graphics backend keeps the textures behind an atlas.
+struct AtlasHooks {
+    // Make a texture for a new page.
+    void* (*makeTexture)(U32 width, U32 height) noexcept;
+    // Called as a page is emptied, to free its texture.
+    void (*destroyTexture)(void* texture) noexcept;
+    // Called as an image loses its place in a page, before its space can go
+    // to another.
+    void (*evicted)(StringView path, const AtlasImage& image,
+                    AtlasPage& page) noexcept;
+};
+
+// Keeps images packed into a set of textures and decides which ones leave
+// when room is needed. Textures themselves are made and destroyed by the
+// backend's hooks.
+class Atlas {
+ public:
+    explicit Atlas(AtlasHooks hooks) noexcept;
+    ~Atlas() noexcept;
+
+    // The entry for the image at a path. New entries are not resident.
+    // Entries keep their address for the life of the atlas.
+    AtlasImage&
+    image(StringView path) noexcept;
+
+    // Find room for a non-resident image in the first page that has it. If
+    // none do, add a page, first evicting images unused since before now if
+    // a page would take the atlas over budget bytes. Returns false if images
+    // in use kept it from fitting in the budget.
+    bool
+    place(AtlasImage& image, U32 width, U32 height, Size budget,
+          Time now) noexcept;
+
+    // The resident image placed at a point, or null if there is none.
+    AtlasImage*
+    find(void* texture, U32 x, U32 y) noexcept;
+
+    // The page with a texture, or null if it is not an atlas page.
+    AtlasPage*
+    findPage(void* texture) noexcept;
+
+    // Evict unused images last used before latestPermissibleUse.
+    void
+    prune(Time latestPermissibleUse) noexcept;
+
+ private:
+    void
+    evict(StringView path, AtlasImage& image) noexcept;
+    bool
+    evictOldest(Time now) noexcept;
+    void
+    destroyPage(AtlasPage* page) noexcept;
+
+    AtlasHooks hooks;
+
+    Hashmap<String, AtlasImage*> images;
+
+    // Resident images by where they are placed, so that finding the image
+    // being released does not search every entry.
+    Hashmap<AtlasSpot, AtlasImage*> placed;
+
+    Vector<AtlasPage> pages;
+    Size pageBytes;
+};
+
+#endif  // SRC_UTIL_ATLAS_H_
@@ -0,0 +1,36 @@
+#ifndef SRC_UTIL_ATOMIC_H_
+#define SRC_UTIL_ATOMIC_H_
+
+#include "util/compiler.h"
+
+// Loads that acquire and stores that release, for handing data between
+// threads without a lock.
+
+#if CLANG || GCC
+template<typename T>
+static inline T
+atomicLoad(const T* p) noexcept {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+static inline void
+atomicStore(T* p, T value) noexcept {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+#else
+// MSVC gives volatile accesses these semantics unless /volatile:iso is set.
+template<typename T>
+static inline T
+atomicLoad(const T* p) noexcept {
+    return *static_cast<const volatile T*>(p);
+}
+
+template<typename T>
+static inline void
+atomicStore(T* p, T value) noexcept {
+    *static_cast<volatile T*>(p) = value;
+}
+#endif
+
+#endif  // SRC_UTIL_ATOMIC_H_
@@ -0,0 +1,16 @@
+#include "util/allocations.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+#ifdef HAVE_GLIBC
+// Everything, operator new included, goes through malloc.
+
+extern "C" void*
+__libc_malloc(Size) noexcept;
+
+extern "C" void*
+malloc(Size size) noexcept {
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+#endif
@@ -11,6 +11,10 @@ hash_(int i) noexcept {
 
 Size
 hash_(float d) noexcept {
-    char* bits = reinterpret_cast<char*>(&d);
-    return *reinterpret_cast<Size*>(bits);
+    return fnvHash(reinterpret_cast<char*>(&d), sizeof(float));
+}
+
+Size
+hash_(const void* p) noexcept {
+    return fnvHash(reinterpret_cast<char*>(&p), sizeof(p));
 }
@@ -14,4 +14,13 @@ hash_(int d) noexcept;
 Size
 hash_(float d) noexcept;
 
+Size
+hash_(const void* p) noexcept;
+
+template<typename T>
+inline Size
+hash_(T* p) noexcept {
+    return hash_(static_cast<const void*>(p));
+}
+
 #endif  // SRC_UTIL_HASH_H_
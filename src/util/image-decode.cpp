@@ -0,0 +1,787 @@
+#include "util/image-decode.h"
+
+#include "os/c.h"
+#include "util/compiler.h"
+#include "util/cpu.h"
+#include "util/inflate.h"
+#include "util/int.h"
+#include "util/new.h"
+
+// Larger images would not fit in a texture anyway, and limiting them keeps
+// sizes from overflowing.
+#define MAX_DIMENSION 16384
+
+#if GCC || CLANG
+// https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+typedef U8 Bytes __attribute__((vector_size(16)));
+typedef U32 Pixels __attribute__((vector_size(16)));
+#endif
+
+static U32
+read16(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8;
+}
+
+static U32
+read32(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8 |
+           static_cast<U32>(p[2]) << 16 | static_cast<U32>(p[3]) << 24;
+}
+
+static U32
+read32BE(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) << 24 | static_cast<U32>(p[1]) << 16 |
+           static_cast<U32>(p[2]) << 8 | static_cast<U32>(p[3]);
+}
+
+static inline U32
+argb(U32 r, U32 g, U32 b, U32 a) noexcept {
+    return a << 24 | r << 16 | g << 8 | b;
+}
+
+// Turn 0xAARRGGBB into 0xAABBGGRR or back.
+static void
+swapRedBlue(U32* row, Size n) noexcept {
+    Size i = 0;
+
+#if GCC || CLANG
+    Pixels zero = {};
+    Pixels keep = zero + 0xFF00FF00;
+    Pixels low = zero + 0xFF;
+    for (; i + 4 <= n; i += 4) {
+        Pixels p;
+        memcpy(&p, row + i, sizeof(p));
+        p = (p & keep) | ((p >> 16) & low) | ((p & low) << 16);
+        memcpy(row + i, &p, sizeof(p));
+    }
+#endif
+
+    for (; i < n; i++) {
+        U32 p = row[i];
+        row[i] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+    }
+}
+
+static void
+swapRows(U32* pixels, Size stride, U32 width, U32 height) noexcept {
+    for (U32 y = 0; y < height; y++)
+        swapRedBlue(pixels + y * stride, width);
+}
+
+static bool
+validSize(U32 width, U32 height) noexcept {
+    return 0 < width && width <= MAX_DIMENSION && 0 < height &&
+           height <= MAX_DIMENSION;
+}
+
+//
+// BMP decoding.
+//
+
+#define BI_RGB       0
+#define BI_BITFIELDS 3
+
+// A color channel within a pixel, as given by BI_BITFIELDS.
+struct Channel {
+    U32 mask;
+    U32 shift;
+    U32 max;
+};
+
+static Channel
+makeChannel(U32 mask) noexcept {
+    Channel c = {mask, 0, 0};
+    if (mask == 0)
+        return c;
+    while ((mask >> c.shift & 1) == 0)
+        c.shift++;
+    c.max = mask >> c.shift;
+    return c;
+}
+
+// Widened to 8 bits.
+static U32
+readChannel(U32 pixel, Channel c) noexcept {
+    if (c.max == 0)
+        return 0;
+    return ((pixel & c.mask) >> c.shift) * 255 / c.max;
+}
+
+static bool
+isBMP(const U8* data, Size size) noexcept {
+    return size >= 54 && data[0] == 'B' && data[1] == 'M';
+}
+
+static bool
+sizeBMP(const U8* data, U32* width, U32* height) noexcept {
+    I32 w = static_cast<I32>(read32(data + 18));
+    I32 h = static_cast<I32>(read32(data + 22));
+    if (h < 0)
+        h = -h;
+    if (w <= 0 || h <= 0)
+        return false;
+
+    *width = static_cast<U32>(w);
+    *height = static_cast<U32>(h);
+    return validSize(*width, *height);
+}
+
+// Decode an uncompressed BMP of 8, 24, or 32 bits per pixel, as
+// SDL_LoadBMP() would.
+static bool
+decodeBMP(const U8* data, Size size, U32* pixels, Size stride) noexcept {
+    U32 offset = read32(data + 10);
+    U32 headerSize = read32(data + 14);
+    I32 height = static_cast<I32>(read32(data + 22));
+    U32 bpp = read16(data + 28);
+    U32 compression = read32(data + 30);
+    U32 numColors = read32(data + 46);
+
+    U32 width;
+    U32 rows;
+    if (headerSize < 40 || !sizeBMP(data, &width, &rows))
+        return false;
+    if (bpp != 8 && bpp != 24 && bpp != 32)
+        return false;
+
+    // Rows are stored bottom-up unless the height is negative.
+    bool topDown = height < 0;
+
+    Channel r = makeChannel(0x00FF0000);
+    Channel g = makeChannel(0x0000FF00);
+    Channel b = makeChannel(0x000000FF);
+    Channel a = makeChannel(0xFF000000);
+
+    if (compression == BI_BITFIELDS && bpp == 32) {
+        if (size < 66)
+            return false;
+        r = makeChannel(read32(data + 54));
+        g = makeChannel(read32(data + 58));
+        b = makeChannel(read32(data + 62));
+        a = makeChannel(0);
+        if (headerSize >= 56) {
+            if (size < 70)
+                return false;
+            a = makeChannel(read32(data + 66));
+        }
+    }
+    else if (compression != BI_RGB) {
+        return false;
+    }
+
+    const U8* palette = data + 14 + headerSize;
+    if (bpp == 8) {
+        if (numColors == 0 || numColors > 256)
+            numColors = 256;
+        if (14 + headerSize + numColors * 4 > size)
+            return false;
+    }
+
+    Size rowSize = (static_cast<Size>(width) * bpp + 31) / 32 * 4;
+    if (offset > size || (size - offset) / rowSize < rows)
+        return false;
+
+    bool anyAlpha = false;
+
+    for (U32 y = 0; y < rows; y++) {
+        const U8* row = data + offset + (topDown ? y : rows - 1 - y) * rowSize;
+        U32* out = pixels + y * stride;
+
+        for (U32 x = 0; x < width; x++) {
+            if (bpp == 8) {
+                U32 index = row[x];
+                const U8* color = palette + index * 4;
+                out[x] = index < numColors
+                             ? 0xFF000000 | (read32(color) & 0x00FFFFFF)
+                             : 0xFF000000;
+            }
+            else if (bpp == 24) {
+                const U8* p = row + x * 3;
+                out[x] = argb(p[2], p[1], p[0], 0xFF);
+            }
+            else {
+                U32 p = read32(row + x * 4);
+                U32 alpha = a.mask ? readChannel(p, a) : 0xFF;
+                anyAlpha = anyAlpha || alpha != 0;
+                out[x] = argb(readChannel(p, r), readChannel(p, g),
+                              readChannel(p, b), alpha);
+            }
+        }
+    }
+
+    // Many 32-bit BMPs leave their alpha channel blank, meaning opaque.
+    if (bpp == 32 && !anyAlpha)
+        for (U32 y = 0; y < rows; y++)
+            for (U32 x = 0; x < width; x++)
+                pixels[y * stride + x] |= 0xFF000000;
+
+    return true;
+}
+
+//
+// QOI decoding.
+//
+// https://qoiformat.org/qoi-specification.pdf
+//
+
+#define QOI_HEADER_SIZE 14
+#define QOI_END_SIZE    8
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xC0
+#define QOI_OP_RGB   0xFE
+#define QOI_OP_RGBA  0xFF
+#define QOI_MASK     0xC0
+
+static bool
+isQOI(const U8* data, Size size) noexcept {
+    return size >= QOI_HEADER_SIZE + QOI_END_SIZE && data[0] == 'q' &&
+           data[1] == 'o' && data[2] == 'i' && data[3] == 'f';
+}
+
+static bool
+sizeQOI(const U8* data, U32* width, U32* height) noexcept {
+    *width = read32BE(data + 4);
+    *height = read32BE(data + 8);
+    return validSize(*width, *height);
+}
+
+static bool
+decodeQOI(const U8* data, Size size, U32* pixels, Size stride) noexcept {
+    U32 width;
+    U32 height;
+    if (!sizeQOI(data, &width, &height))
+        return false;
+
+    U32 channels = data[12];
+    if (channels != 3 && channels != 4)
+        return false;
+
+    // Colors seen before, by hash. A pixel is its U32 0xAARRGGBB.
+    U32 index[64] = {};
+
+    U32 r = 0;
+    U32 g = 0;
+    U32 b = 0;
+    U32 a = 255;
+    U32 run = 0;
+
+    const U8* p = data + QOI_HEADER_SIZE;
+    // No op is longer than five bytes, so none reads into the end marker
+    // unless the data is cut short.
+    const U8* end = data + size - QOI_END_SIZE;
+
+    for (U32 y = 0; y < height; y++) {
+        U32* out = pixels + y * stride;
+
+        for (U32 x = 0; x < width; x++) {
+            if (run > 0) {
+                run--;
+                out[x] = argb(r, g, b, a);
+                continue;
+            }
+
+            if (p >= end)
+                return false;
+
+            U32 op = *p++;
+            if (op == QOI_OP_RGB) {
+                r = p[0];
+                g = p[1];
+                b = p[2];
+                p += 3;
+            }
+            else if (op == QOI_OP_RGBA) {
+                r = p[0];
+                g = p[1];
+                b = p[2];
+                a = p[3];
+                p += 4;
+            }
+            else if ((op & QOI_MASK) == QOI_OP_INDEX) {
+                U32 color = index[op];
+                a = color >> 24;
+                r = (color >> 16) & 0xFF;
+                g = (color >> 8) & 0xFF;
+                b = color & 0xFF;
+            }
+            else if ((op & QOI_MASK) == QOI_OP_DIFF) {
+                r = (r + ((op >> 4) & 3) - 2) & 0xFF;
+                g = (g + ((op >> 2) & 3) - 2) & 0xFF;
+                b = (b + (op & 3) - 2) & 0xFF;
+            }
+            else if ((op & QOI_MASK) == QOI_OP_LUMA) {
+                U32 next = *p++;
+                U32 dg = (op & 0x3F) - 32;
+                g = (g + dg) & 0xFF;
+                r = (r + dg + ((next >> 4) & 0x0F) - 8) & 0xFF;
+                b = (b + dg + (next & 0x0F) - 8) & 0xFF;
+            }
+            else {
+                run = op & 0x3F;
+            }
+
+            U32 color = argb(r, g, b, a);
+            index[(r * 3 + g * 5 + b * 7 + a * 11) % 64] = color;
+            out[x] = color;
+        }
+    }
+
+    return true;
+}
+
+//
+// PNG decoding.
+//
+// https://www.w3.org/TR/png/
+//
+
+#define PNG_GRAY       0
+#define PNG_RGB        2
+#define PNG_PALETTE    3
+#define PNG_GRAY_ALPHA 4
+#define PNG_RGBA       6
+
+static const U8 pngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+// Where the pixels of each of the seven Adam7 passes are.
+static const U8 adam7X[7] = {0, 4, 0, 2, 0, 1, 0};
+static const U8 adam7Y[7] = {0, 0, 4, 0, 2, 0, 1};
+static const U8 adam7DX[7] = {8, 8, 4, 4, 2, 2, 1};
+static const U8 adam7DY[7] = {8, 8, 8, 4, 4, 2, 2};
+
+struct Png {
+    U32 width;
+    U32 height;
+    U32 depth;
+    U32 colorType;
+    bool interlaced;
+
+    // Samples per pixel.
+    U32 channels;
+
+    U32 palette[256];
+
+    // The raw samples of the one transparent color of a gray or RGB image.
+    bool hasKey;
+    U32 key[3];
+};
+
+static bool
+isPNG(const U8* data, Size size) noexcept {
+    return size >= 33 && memcmp(data, pngSignature, 8) == 0;
+}
+
+static bool
+sizePNG(const U8* data, U32* width, U32* height) noexcept {
+    if (memcmp(data + 12, "IHDR", 4) != 0)
+        return false;
+    *width = read32BE(data + 16);
+    *height = read32BE(data + 20);
+    return validSize(*width, *height);
+}
+
+static Size
+rowBytes(const Png& png, U32 width) noexcept {
+    return (static_cast<Size>(width) * png.channels * png.depth + 7) / 8;
+}
+
+static inline U32
+paeth(U32 a, U32 b, U32 c) noexcept {
+    I32 pa = static_cast<I32>(b) - static_cast<I32>(c);
+    I32 pb = static_cast<I32>(a) - static_cast<I32>(c);
+    I32 pc = pa + pb;
+    pa = pa < 0 ? -pa : pa;
+    pb = pb < 0 ? -pb : pb;
+    pc = pc < 0 ? -pc : pc;
+    if (pa <= pb && pa <= pc)
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+// Undo each row's filter in place. prev is the row above, all zeros for the
+// first.
+static bool
+unfilterRow(U8 filter, U8* row, const U8* prev, Size n, U32 bpp) noexcept {
+    Size i = 0;
+
+    switch (filter) {
+    case 0:
+        break;
+    case 1:
+        for (i = bpp; i < n; i++)
+            row[i] += row[i - bpp];
+        break;
+    case 2:
+#if GCC || CLANG
+        for (; i + 16 <= n; i += 16) {
+            Bytes x;
+            Bytes y;
+            memcpy(&x, row + i, 16);
+            memcpy(&y, prev + i, 16);
+            x += y;
+            memcpy(row + i, &x, 16);
+        }
+#endif
+        for (; i < n; i++)
+            row[i] += prev[i];
+        break;
+    case 3:
+        for (; i < bpp; i++)
+            row[i] += prev[i] >> 1;
+        for (; i < n; i++)
+            row[i] += (row[i - bpp] + prev[i]) >> 1;
+        break;
+    case 4:
+        for (; i < bpp; i++)
+            row[i] += prev[i];
+        for (; i < n; i++)
+            row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+// The raw value of sample i of a row.
+static inline U32
+sample(const U8* row, Size i, U32 depth) noexcept {
+    if (depth == 8)
+        return row[i];
+    if (depth == 16)
+        return static_cast<U32>(row[i * 2]) << 8 | row[i * 2 + 1];
+
+    Size bit = i * depth;
+    U32 shift = 8 - depth - static_cast<U32>(bit % 8);
+    return (row[bit / 8] >> shift) & ((1u << depth) - 1);
+}
+
+// A sample widened or narrowed to 8 bits.
+static inline U32
+scale(U32 value, U32 depth) noexcept {
+    if (depth == 8)
+        return value;
+    if (depth == 16)
+        return value >> 8;
+    return value * 255 / ((1u << depth) - 1);
+}
+
+// Write a row of width pixels to out, dx pixels apart.
+static void
+convertRow(const Png& png, const U8* row, U32 width, U32* out,
+           Size dx) noexcept {
+    U32 depth = png.depth;
+
+    switch (png.colorType) {
+    case PNG_GRAY:
+        for (U32 x = 0; x < width; x++) {
+            U32 s = sample(row, x, depth);
+            U32 v = scale(s, depth);
+            U32 alpha = png.hasKey && s == png.key[0] ? 0 : 0xFF;
+            out[x * dx] = argb(v, v, v, alpha);
+        }
+        break;
+    case PNG_RGB:
+        for (U32 x = 0; x < width; x++) {
+            U32 r = sample(row, x * 3, depth);
+            U32 g = sample(row, x * 3 + 1, depth);
+            U32 b = sample(row, x * 3 + 2, depth);
+            bool clear = png.hasKey && r == png.key[0] && g == png.key[1] &&
+                         b == png.key[2];
+            out[x * dx] = argb(scale(r, depth), scale(g, depth),
+                               scale(b, depth), clear ? 0 : 0xFF);
+        }
+        break;
+    case PNG_PALETTE:
+        for (U32 x = 0; x < width; x++)
+            out[x * dx] = png.palette[sample(row, x, depth)];
+        break;
+    case PNG_GRAY_ALPHA:
+        for (U32 x = 0; x < width; x++) {
+            U32 v = scale(sample(row, x * 2, depth), depth);
+            U32 alpha = scale(sample(row, x * 2 + 1, depth), depth);
+            out[x * dx] = argb(v, v, v, alpha);
+        }
+        break;
+    case PNG_RGBA:
+        for (U32 x = 0; x < width; x++)
+            out[x * dx] = argb(scale(sample(row, x * 4, depth), depth),
+                               scale(sample(row, x * 4 + 1, depth), depth),
+                               scale(sample(row, x * 4 + 2, depth), depth),
+                               scale(sample(row, x * 4 + 3, depth), depth));
+        break;
+    }
+}
+
+static bool
+validFormat(U32 colorType, U32 depth) noexcept {
+    switch (colorType) {
+    case PNG_GRAY:
+        return depth == 1 || depth == 2 || depth == 4 || depth == 8 ||
+               depth == 16;
+    case PNG_PALETTE:
+        return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+    case PNG_RGB:
+    case PNG_GRAY_ALPHA:
+    case PNG_RGBA:
+        return depth == 8 || depth == 16;
+    default:
+        return false;
+    }
+}
+
+static bool
+readHeader(Png& png, const U8* data) noexcept {
+    if (!sizePNG(data, &png.width, &png.height))
+        return false;
+
+    png.depth = data[24];
+    png.colorType = data[25];
+    U32 compression = data[26];
+    U32 filter = data[27];
+    U32 interlace = data[28];
+
+    if (!validFormat(png.colorType, png.depth) || compression != 0 ||
+        filter != 0 || interlace > 1)
+        return false;
+
+    png.interlaced = interlace == 1;
+
+    static const U8 channels[7] = {1, 0, 3, 1, 2, 0, 4};
+    png.channels = channels[png.colorType];
+
+    for (U32 i = 0; i < 256; i++)
+        png.palette[i] = 0xFF000000;
+    png.hasKey = false;
+
+    return true;
+}
+
+static bool
+readTransparency(Png& png, const U8* chunk, U32 length) noexcept {
+    if (png.colorType == PNG_PALETTE) {
+        if (length > 256)
+            return false;
+        for (U32 i = 0; i < length; i++)
+            png.palette[i] = (png.palette[i] & 0x00FFFFFF) |
+                             static_cast<U32>(chunk[i]) << 24;
+    }
+    else if (png.colorType == PNG_GRAY || png.colorType == PNG_RGB) {
+        U32 n = png.colorType == PNG_GRAY ? 1 : 3;
+        if (length != n * 2)
+            return false;
+        for (U32 i = 0; i < n; i++)
+            png.key[i] = static_cast<U32>(chunk[i * 2]) << 8 | chunk[i * 2 + 1];
+        png.hasKey = true;
+    }
+    return true;
+}
+
+// Where one pass of an interlaced image is, or all of an image that is not.
+struct Pass {
+    U32 x0;
+    U32 y0;
+    U32 dx;
+    U32 dy;
+    U32 width;
+    U32 height;
+};
+
+static U32
+numPasses(const Png& png) noexcept {
+    return png.interlaced ? 7 : 1;
+}
+
+// Returns false if the pass has no pixels.
+static bool
+findPass(const Png& png, U32 i, Pass& pass) noexcept {
+    pass.x0 = png.interlaced ? adam7X[i] : 0;
+    pass.y0 = png.interlaced ? adam7Y[i] : 0;
+    pass.dx = png.interlaced ? adam7DX[i] : 1;
+    pass.dy = png.interlaced ? adam7DY[i] : 1;
+    if (png.width <= pass.x0 || png.height <= pass.y0)
+        return false;
+    pass.width = (png.width - pass.x0 + pass.dx - 1) / pass.dx;
+    pass.height = (png.height - pass.y0 + pass.dy - 1) / pass.dy;
+    return true;
+}
+
+// Each row is preceded by the byte that says how it was filtered.
+static Size
+passSize(const Png& png, const Pass& pass) noexcept {
+    return pass.height * (rowBytes(png, pass.width) + 1);
+}
+
+static bool
+decodePass(const Png& png, const Pass& pass, U8* raw, const U8* zeros,
+           U32* pixels, Size stride, bool direct) noexcept {
+    Size n = rowBytes(png, pass.width);
+    U32 bpp = (png.channels * png.depth + 7) / 8;
+
+    const U8* prev = zeros;
+    for (U32 y = 0; y < pass.height; y++) {
+        U8* row = raw + y * (n + 1);
+        if (!unfilterRow(row[0], row + 1, prev, n, bpp))
+            return false;
+        prev = row + 1;
+
+        U32* out = pixels + (pass.y0 + y * pass.dy) * stride + pass.x0;
+        if (direct)
+            memcpy(out, row + 1, n);
+        else
+            convertRow(png, row + 1, pass.width, out, pass.dx);
+    }
+
+    return true;
+}
+
+static bool
+decodePNG(const U8* data, Size size, U32* pixels, Size stride,
+          PixelOrder order) noexcept {
+    Png png;
+    if (read32BE(data + 8) != 13 || !readHeader(png, data))
+        return false;
+
+    // Find the compressed data, which may be split over many IDAT chunks.
+    const U8* first = 0;
+    Size compressedSize = 0;
+    U32 numData = 0;
+    bool hasPalette = false;
+
+    const U8* p = data + 33;
+    const U8* end = data + size;
+    for (;;) {
+        if (end - p < 12)
+            return false;
+        U32 length = read32BE(p);
+        const U8* type = p + 4;
+        const U8* chunk = p + 8;
+        if (static_cast<Size>(end - chunk) < static_cast<Size>(length) + 4)
+            return false;
+        p = chunk + length + 4;
+
+        if (memcmp(type, "IDAT", 4) == 0) {
+            if (numData == 0)
+                first = chunk;
+            compressedSize += length;
+            numData += 1;
+        }
+        else if (memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length > 256 * 3)
+                return false;
+            for (U32 i = 0; i < length / 3; i++)
+                png.palette[i] = argb(chunk[i * 3], chunk[i * 3 + 1],
+                                      chunk[i * 3 + 2], 0xFF);
+            hasPalette = true;
+        }
+        else if (memcmp(type, "tRNS", 4) == 0) {
+            if (!readTransparency(png, chunk, length))
+                return false;
+        }
+        else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+    }
+
+    if (numData == 0 || (png.colorType == PNG_PALETTE && !hasPalette))
+        return false;
+
+    // Gather the data together if it is split.
+    U8* joined = 0;
+    const U8* compressed = first;
+    if (numData > 1) {
+        joined = xmalloc(U8, compressedSize);
+        Size pos = 0;
+        for (p = first - 8;; p += read32BE(p) + 12) {
+            U32 length = read32BE(p);
+            if (memcmp(p + 4, "IDAT", 4) == 0) {
+                memcpy(joined + pos, p + 8, length);
+                pos += length;
+                if (pos == compressedSize)
+                    break;
+            }
+        }
+        compressed = joined;
+    }
+
+    Pass pass;
+    Size rawSize = 0;
+    for (U32 i = 0; i < numPasses(png); i++)
+        if (findPass(png, i, pass))
+            rawSize += passSize(png, pass);
+
+    U8* raw = xmalloc(U8, rawSize);
+    bool ok = inflateZlib(compressed, compressedSize, raw, rawSize);
+
+    Size zerosSize = rowBytes(png, png.width);
+    U8* zeros = xmalloc(U8, zerosSize);
+    memset(zeros, 0, zerosSize);
+
+    // RGBA rows of images that are not interlaced can be copied straight
+    // out, as their bytes are PIXELS_ABGR pixels on little-endian machines.
+    bool direct = !BE && png.colorType == PNG_RGBA && png.depth == 8 &&
+                  !png.interlaced;
+
+    U8* next = raw;
+    for (U32 i = 0; ok && i < numPasses(png); i++) {
+        if (!findPass(png, i, pass))
+            continue;
+        ok = decodePass(png, pass, next, zeros, pixels, stride, direct);
+        next += passSize(png, pass);
+    }
+
+    free(zeros);
+    free(raw);
+    free(joined);
+
+    if (ok && (order == PIXELS_ABGR) != direct)
+        swapRows(pixels, stride, png.width, png.height);
+
+    return ok;
+}
+
+//
+// Any format.
+//
+
+bool
+decodeImageSize(const U8* data, Size size, U32* width, U32* height) noexcept {
+    if (isBMP(data, size))
+        return sizeBMP(data, width, height);
+    if (isQOI(data, size))
+        return sizeQOI(data, width, height);
+    if (isPNG(data, size))
+        return sizePNG(data, width, height);
+    return false;
+}
+
+bool
+decodeImage(const U8* data, Size size, U32* pixels, Size stride,
+            PixelOrder order) noexcept {
+    if (isPNG(data, size))
+        return decodePNG(data, size, pixels, stride, order);
+
+    // BMPs and QOIs are decoded as PIXELS_ARGB.
+    bool ok;
+    U32 width;
+    U32 height;
+    if (isBMP(data, size))
+        ok = decodeBMP(data, size, pixels, stride) &&
+             sizeBMP(data, &width, &height);
+    else if (isQOI(data, size))
+        ok = decodeQOI(data, size, pixels, stride) &&
+             sizeQOI(data, &width, &height);
+    else
+        return false;
+
+    if (ok && order == PIXELS_ABGR)
+        swapRows(pixels, stride, width, height);
+
+    return ok;
+}
@@ -0,0 +1,32 @@
+#ifndef SRC_UTIL_IMAGE_DECODE_H_
+#define SRC_UTIL_IMAGE_DECODE_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Decoders for BMP, QOI, and PNG images. They write 32-bit pixels straight
+// into memory the caller provides, such as an atlas's staging buffer, and are
+// safe to call from any thread.
+
+enum PixelOrder {
+    // Each pixel is the U32 0xAARRGGBB, as GL_BGRA and the software renderer
+    // take.
+    PIXELS_ARGB,
+    // Each pixel is the U32 0xAABBGGRR, as SDL_PIXELFORMAT_RGBA32 takes on
+    // little-endian machines.
+    PIXELS_ABGR,
+};
+
+// Read an image's size from its header. Returns false if data is not a BMP,
+// QOI, or PNG image.
+bool
+decodeImageSize(const U8* data, Size size, U32* width, U32* height) noexcept;
+
+// Decode an image into pixels, whose rows are stride pixels apart. There must
+// be room for the size decodeImageSize() gives. Returns false if the image is
+// invalid, in which case pixels may have been partly written.
+bool
+decodeImage(const U8* data, Size size, U32* pixels, Size stride,
+            PixelOrder order) noexcept;
+
+#endif  // SRC_UTIL_IMAGE_DECODE_H_
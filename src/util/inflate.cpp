@@ -0,0 +1,373 @@
+#include "util/inflate.h"
+
+#include "os/c.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+#define MAX_BITS  15
+#define FAST_BITS 9
+#define FAST_SIZE (1 << FAST_BITS)
+
+#define NUM_LITLENS 288
+#define NUM_DISTS   32
+
+static const U16 lengthBases[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const U8 lengthExtras[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const U16 distBases[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const U8 distExtras[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+// Order in which code length code lengths are stored.
+static const U8 codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+struct Huffman {
+    // Codes of up to FAST_BITS bits, indexed by the next FAST_BITS bits of
+    // input: each is its length << 9 | its symbol. Zero where the code is
+    // longer.
+    U16 fast[FAST_SIZE];
+
+    // Number of codes of each length.
+    U16 counts[MAX_BITS + 1];
+
+    // Symbols ordered by code.
+    U16 symbols[NUM_LITLENS];
+};
+
+// Input is read little-endian a byte at a time into buffer, and bits are taken
+// from its bottom. Reading past the end gives zeros, counted in padding, so
+// that a truncated stream can be told apart once it is finished.
+struct Bits {
+    const U8* in;
+    const U8* end;
+    U64 buffer;
+    U32 count;
+    U32 padding;
+};
+
+static inline void
+refill(Bits& b) noexcept {
+    while (b.count <= 56) {
+        U64 byte = 0;
+        if (b.in < b.end)
+            byte = *b.in++;
+        else
+            b.padding += 1;
+        b.buffer |= byte << b.count;
+        b.count += 8;
+    }
+}
+
+static inline U32
+take(Bits& b, U32 n) noexcept {
+    if (b.count < n)
+        refill(b);
+    U32 bits = static_cast<U32>(b.buffer & ((1ull << n) - 1));
+    b.buffer >>= n;
+    b.count -= n;
+    return bits;
+}
+
+// Whether bits have been taken from beyond the end of the input.
+static inline bool
+overrun(Bits& b) noexcept {
+    return b.padding * 8 > b.count;
+}
+
+static U32
+reverse(U32 code, U32 length) noexcept {
+    U32 r = 0;
+    for (U32 i = 0; i < length; i++) {
+        r = r << 1 | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+static bool
+build(Huffman& h, const U8* lengths, U32 n) noexcept {
+    memset(h.counts, 0, sizeof(h.counts));
+    for (U32 i = 0; i < n; i++)
+        h.counts[lengths[i]] += 1;
+    h.counts[0] = 0;
+
+    // Refuse more codes than there is room for.
+    I32 left = 1;
+    for (U32 length = 1; length <= MAX_BITS; length++) {
+        left <<= 1;
+        left -= h.counts[length];
+        if (left < 0)
+            return false;
+    }
+
+    U16 offsets[MAX_BITS + 2];
+    U32 codes[MAX_BITS + 1];
+    offsets[1] = 0;
+    codes[0] = 0;
+    for (U32 length = 1; length <= MAX_BITS; length++) {
+        offsets[length + 1] = offsets[length] + h.counts[length];
+        codes[length] = (codes[length - 1] + h.counts[length - 1]) << 1;
+    }
+
+    memset(h.fast, 0, sizeof(h.fast));
+
+    for (U32 symbol = 0; symbol < n; symbol++) {
+        U32 length = lengths[symbol];
+        if (length == 0)
+            continue;
+
+        h.symbols[offsets[length]++] = static_cast<U16>(symbol);
+
+        U32 code = codes[length]++;
+        if (length <= FAST_BITS) {
+            U16 entry = static_cast<U16>(length << 9 | symbol);
+            for (U32 i = reverse(code, length); i < FAST_SIZE; i += 1 << length)
+                h.fast[i] = entry;
+        }
+    }
+
+    return true;
+}
+
+// Returns the next symbol, or -1 if the input holds no code.
+static inline I32
+decode(Bits& b, const Huffman& h) noexcept {
+    if (b.count < MAX_BITS)
+        refill(b);
+
+    U32 entry = h.fast[b.buffer & (FAST_SIZE - 1)];
+    if (entry) {
+        U32 length = entry >> 9;
+        b.buffer >>= length;
+        b.count -= length;
+        return static_cast<I32>(entry & 0x1FF);
+    }
+
+    // Longer codes are found a bit at a time, as in zlib's puff.c.
+    I32 code = 0;
+    I32 first = 0;
+    I32 index = 0;
+    for (U32 length = 1; length <= MAX_BITS; length++) {
+        code |= static_cast<I32>((b.buffer >> (length - 1)) & 1);
+        I32 count = h.counts[length];
+        if (code - first < count) {
+            b.buffer >>= length;
+            b.count -= length;
+            return h.symbols[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static void
+buildFixed(Huffman& litlens, Huffman& dists) noexcept {
+    U8 lengths[NUM_LITLENS];
+    U32 i = 0;
+    for (; i < 144; i++)
+        lengths[i] = 8;
+    for (; i < 256; i++)
+        lengths[i] = 9;
+    for (; i < 280; i++)
+        lengths[i] = 7;
+    for (; i < NUM_LITLENS; i++)
+        lengths[i] = 8;
+    build(litlens, lengths, NUM_LITLENS);
+
+    for (i = 0; i < NUM_DISTS; i++)
+        lengths[i] = 5;
+    build(dists, lengths, NUM_DISTS);
+}
+
+static bool
+buildDynamic(Bits& b, Huffman& litlens, Huffman& dists) noexcept {
+    U32 numLitlens = take(b, 5) + 257;
+    U32 numDists = take(b, 5) + 1;
+    U32 numCodeLengths = take(b, 4) + 4;
+    if (numLitlens > 286 || numDists > 30)
+        return false;
+
+    U8 lengths[NUM_LITLENS + NUM_DISTS] = {};
+    for (U32 i = 0; i < numCodeLengths; i++)
+        lengths[codeLengthOrder[i]] = static_cast<U8>(take(b, 3));
+
+    Huffman codeLengths;
+    if (!build(codeLengths, lengths, 19))
+        return false;
+
+    U32 total = numLitlens + numDists;
+    for (U32 i = 0; i < total;) {
+        I32 symbol = decode(b, codeLengths);
+        if (symbol < 0)
+            return false;
+
+        if (symbol < 16) {
+            lengths[i++] = static_cast<U8>(symbol);
+            continue;
+        }
+
+        U8 length = 0;
+        U32 repeat;
+        if (symbol == 16) {
+            if (i == 0)
+                return false;
+            length = lengths[i - 1];
+            repeat = 3 + take(b, 2);
+        }
+        else if (symbol == 17) {
+            repeat = 3 + take(b, 3);
+        }
+        else {
+            repeat = 11 + take(b, 7);
+        }
+
+        if (i + repeat > total)
+            return false;
+        memset(lengths + i, length, repeat);
+        i += repeat;
+    }
+
+    // A block must be able to end.
+    if (lengths[256] == 0)
+        return false;
+
+    return build(litlens, lengths, numLitlens) &&
+           build(dists, lengths + numLitlens, numDists);
+}
+
+static bool
+inflateCodes(Bits& b, const Huffman& litlens, const Huffman& dists, U8* out,
+             Size& pos, Size outSize) noexcept {
+    for (;;) {
+        I32 symbol = decode(b, litlens);
+        if (symbol < 0)
+            return false;
+
+        if (symbol < 256) {
+            if (pos == outSize)
+                return false;
+            out[pos++] = static_cast<U8>(symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+        Size length = lengthBases[symbol] + take(b, lengthExtras[symbol]);
+
+        symbol = decode(b, dists);
+        if (symbol < 0 || symbol >= 30)
+            return false;
+        Size dist = distBases[symbol] + take(b, distExtras[symbol]);
+
+        if (dist > pos || length > outSize - pos)
+            return false;
+
+        U8* dst = out + pos;
+        const U8* src = dst - dist;
+        pos += length;
+
+        // Eight bytes at a time when far enough back that they do not
+        // overlap.
+        if (dist >= 8) {
+            for (; length >= 8; length -= 8, dst += 8, src += 8)
+                memcpy(dst, src, 8);
+        }
+        for (; length > 0; length--)
+            *dst++ = *src++;
+    }
+}
+
+static bool
+inflateStored(Bits& b, U8* out, Size& pos, Size outSize) noexcept {
+    // Give back whole bytes not yet used, and start at the next byte.
+    U32 buffered = b.count / 8;
+    if (buffered < b.padding)
+        return false;
+    b.in -= buffered - b.padding;
+    b.buffer = 0;
+    b.count = 0;
+    b.padding = 0;
+
+    if (b.end - b.in < 4)
+        return false;
+    U32 length = static_cast<U32>(b.in[0]) | static_cast<U32>(b.in[1]) << 8;
+    U32 check = static_cast<U32>(b.in[2]) | static_cast<U32>(b.in[3]) << 8;
+    b.in += 4;
+
+    if (length != (~check & 0xFFFF))
+        return false;
+    if (static_cast<Size>(b.end - b.in) < length || length > outSize - pos)
+        return false;
+
+    memcpy(out + pos, b.in, length);
+    b.in += length;
+    pos += length;
+    return true;
+}
+
+bool
+inflateZlib(const U8* in, Size inSize, U8* out, Size outSize) noexcept {
+    if (inSize < 2)
+        return false;
+
+    U32 cmf = in[0];
+    U32 flg = in[1];
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || (cmf << 8 | flg) % 31 != 0)
+        return false;
+    // Preset dictionaries are not used by PNG.
+    if (flg & 0x20)
+        return false;
+
+    Bits b = {in + 2, in + inSize, 0, 0, 0};
+    Size pos = 0;
+
+    Huffman litlens;
+    Huffman dists;
+
+    bool last;
+    do {
+        last = take(b, 1);
+        U32 type = take(b, 2);
+
+        bool ok;
+        if (type == 0) {
+            ok = inflateStored(b, out, pos, outSize);
+        }
+        else if (type == 1) {
+            buildFixed(litlens, dists);
+            ok = inflateCodes(b, litlens, dists, out, pos, outSize);
+        }
+        else if (type == 2) {
+            ok = buildDynamic(b, litlens, dists) &&
+                 inflateCodes(b, litlens, dists, out, pos, outSize);
+        }
+        else {
+            ok = false;
+        }
+
+        if (!ok || overrun(b))
+            return false;
+    } while (!last);
+
+    return pos == outSize;
+}
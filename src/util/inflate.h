@@ -0,0 +1,15 @@
+#ifndef SRC_UTIL_INFLATE_H_
+#define SRC_UTIL_INFLATE_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Decompress a zlib stream (RFC 1950 and 1951) into out, which must be exactly
+// the size of the decompressed data. Returns false if the stream is invalid or
+// decompresses to a different size. The Adler-32 checksum is not verified.
+//
+// Safe to call from any thread.
+bool
+inflateZlib(const U8* in, Size inSize, U8* out, Size outSize) noexcept;
+
+#endif  // SRC_UTIL_INFLATE_H_
@@ -29,7 +29,7 @@ static ConditionVariable jobAvailable;
 static ConditionVariable jobsDone;
 
 static void
-work() noexcept {
+work(void*) noexcept {
     Function fn;
 
     do {
@@ -70,8 +70,10 @@ JobsEnqueue(Function fn) noexcept {
     if (workerLimit == 0)
         workerLimit = threadHardwareConcurrency();
 
-    if (workers.size < workerLimit)
-        workers.push(Thread(fn));
+    if (workers.size < workerLimit) {
+        Function worker = {work, 0};
+        workers.push(Thread(worker));
+    }
 
     jobAvailable.notifyOne();
 }
@@ -82,8 +84,7 @@ JobsFlush() noexcept {
 
     // Wait for all jobs to finish.
     {
-        Mutex m;
-        LockGuard lock(m);
+        LockGuard lock(jobsMutex);
 
         while (jobsRunning > 0 || jobs.size > 0)
             jobsDone.wait(lock);
@@ -114,3 +115,104 @@ JobsFlush() noexcept {
     workers.clear();
     tearingDown = false;
 }
+
+struct ForTask {
+    void (*fn)(void*, U32) noexcept;
+    void* data;
+    U32 n;
+
+    Mutex mutex;
+    ConditionVariable finished;
+
+    // Guarded by mutex.
+    U32 next;  // Next i to claim.
+    U32 done;  // Calls returned.
+    U32 refs;  // Threads yet to let go of the task.
+};
+
+static void
+release(ForTask* task) noexcept {
+    bool last;
+    {
+        LockGuard lock(task->mutex);
+        task->refs -= 1;
+        last = task->refs == 0;
+    }
+    if (last)
+        delete task;
+}
+
+// Make calls until none are left to claim.
+static void
+runFor(ForTask* task) noexcept {
+    while (true) {
+        U32 i;
+        {
+            LockGuard lock(task->mutex);
+            if (task->next == task->n)
+                return;
+            i = task->next++;
+        }
+
+        task->fn(task->data, i);
+
+        {
+            LockGuard lock(task->mutex);
+            task->done += 1;
+            if (task->done == task->n)
+                task->finished.notifyAll();
+        }
+    }
+}
+
+static void
+workFor(void* data) noexcept {
+    ForTask* task = static_cast<ForTask*>(data);
+    runFor(task);
+    release(task);
+}
+
+void
+JobsFor(void (*fn)(void* data, U32 i) noexcept, void* data, U32 n) noexcept {
+    if (n == 0)
+        return;
+
+    Size limit;
+    {
+        LockGuard lock(jobsMutex);
+        if (workerLimit == 0)
+            workerLimit = threadHardwareConcurrency();
+        limit = workerLimit;
+    }
+
+    // A helper that starts after the calls are all made finds none left, so
+    // the task lives until the last thread lets go of it.
+    ForTask* task = new ForTask;
+    task->fn = fn;
+    task->data = data;
+    task->n = n;
+    task->next = 0;
+    task->done = 0;
+
+    U32 helpers = n - 1;
+    if (limit < 2)
+        helpers = 0;
+    else if (helpers > limit - 1)
+        helpers = static_cast<U32>(limit - 1);
+    task->refs = helpers + 1;
+
+    for (U32 i = 0; i < helpers; i++) {
+        Function helper = {workFor, task};
+        JobsEnqueue(helper);
+    }
+
+    runFor(task);
+
+    {
+        LockGuard lock(task->mutex);
+        while (task->done < task->n)
+            task->finished.wait(lock);
+    }
+
+    release(task);
+}
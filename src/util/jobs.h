@@ -3,10 +3,17 @@
 
 #include "util/compiler.h"
 #include "util/function.h"
+#include "util/int.h"
 
 void
 JobsEnqueue(Function fn) noexcept;
 void
 JobsFlush() noexcept;
 
+//! Call fn(data, i) for each i in [0, n), spread over the workers and the
+//! calling thread, and return once every call has. Workers busy with other
+//! jobs are not waited for: the calling thread does what they do not.
+void
+JobsFor(void (*fn)(void* data, U32 i) noexcept, void* data, U32 n) noexcept;
+
 #endif  // SRC_UTIL_JOBS_H_
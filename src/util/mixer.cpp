@@ -0,0 +1,356 @@
+#include "util/mixer.h"
+
+#include "os/c.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/math2.h"
+
+#if (GCC || CLANG) && defined(__AVX2__)
+#    define VECTOR_BYTES 32
+#elif (GCC || CLANG) && \
+    (defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#    define VECTOR_BYTES 16
+#else
+#    define VECTOR_BYTES 0
+#endif
+
+// Full volume.
+#define UNITY 256
+
+// Each voice's samples are scaled by its volume and added to a block of I32
+// sums, which are clamped to I16 once all voices are in. Interpolation and
+// scaling are done in integers so that the vector and scalar paths give the
+// same samples.
+
+#if VECTOR_BYTES
+// https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+//
+// A frame read as a U32 has its left sample in the low half and its right in
+// the high half, on little-endian machines.
+typedef U32 Frames __attribute__((vector_size(VECTOR_BYTES)));
+typedef I32 Samples __attribute__((vector_size(VECTOR_BYTES)));
+
+#    define LANES (VECTOR_BYTES / 4)
+
+// Frames need not be aligned to the vector size.
+template<typename V>
+static inline V
+load(const void* p) noexcept {
+    V v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template<typename V>
+static inline void
+store(void* p, V v) noexcept {
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline Samples
+leftOf(Frames v) noexcept {
+    return (Samples)(v << 16) >> 16;
+}
+
+static inline Samples
+rightOf(Frames v) noexcept {
+    return (Samples)v >> 16;
+}
+
+static inline Samples
+clamp(Samples v) noexcept {
+    Samples lo = {};
+    Samples hi = {};
+    lo += -32768;
+    hi += 32767;
+    Samples under = (Samples)(v < lo);
+    Samples over = (Samples)(v > hi);
+    v = (v & ~under) | (lo & under);
+    return (v & ~over) | (hi & over);
+}
+#endif
+
+// Unpack frames into the block.
+static void
+split(const I16* frames, I32* left, I32* right, U32 n) noexcept {
+    U32 i = 0;
+
+#if VECTOR_BYTES
+    for (; i + LANES <= n; i += LANES) {
+        Frames v = load<Frames>(frames + 2 * i);
+        store(left + i, leftOf(v));
+        store(right + i, rightOf(v));
+    }
+#endif
+
+    for (; i < n; i++) {
+        left[i] = frames[2 * i];
+        right[i] = frames[2 * i + 1];
+    }
+}
+
+// Pack the block into frames.
+static void
+join(const I32* left, const I32* right, I16* frames, U32 n) noexcept {
+    U32 i = 0;
+
+#if VECTOR_BYTES
+    for (; i + LANES <= n; i += LANES) {
+        Frames l = (Frames)clamp(load<Samples>(left + i));
+        Frames r = (Frames)clamp(load<Samples>(right + i));
+        store(frames + 2 * i, (l & 0xFFFF) | (r << 16));
+    }
+#endif
+
+    for (; i < n; i++) {
+        frames[2 * i] = static_cast<I16>(bound(left[i], -32768, 32767));
+        frames[2 * i + 1] = static_cast<I16>(bound(right[i], -32768, 32767));
+    }
+}
+
+// Add n frames, played at their own rate, to the block.
+static void
+mixSameRate(const I16* frames, I32 volume, I32* left, I32* right,
+            U32 n) noexcept {
+    U32 i = 0;
+
+#if VECTOR_BYTES
+    for (; i + LANES <= n; i += LANES) {
+        Frames v = load<Frames>(frames + 2 * i);
+        Samples l = load<Samples>(left + i) + ((leftOf(v) * volume) >> 8);
+        Samples r = load<Samples>(right + i) + ((rightOf(v) * volume) >> 8);
+        store(left + i, l);
+        store(right + i, r);
+    }
+#endif
+
+    for (; i < n; i++) {
+        left[i] += (frames[2 * i] * volume) >> 8;
+        right[i] += (frames[2 * i + 1] * volume) >> 8;
+    }
+}
+
+// Add n frames, interpolated between the voice's frames, to the block.
+static void
+mixResampled(const MixerVoice& voice, I32* left, I32* right, U32 n) noexcept {
+    const I16* frames = voice.frames;
+    U32 last = voice.numFrames - 1;
+    U64 position = voice.position;
+    U32 step = voice.step;
+    I32 volume = voice.volume;
+
+    U32 i = 0;
+
+#if VECTOR_BYTES
+    for (; i + LANES <= n; i += LANES) {
+        // Gathered a lane at a time, then interpolated together.
+        U32 as[LANES];
+        U32 bs[LANES];
+        I32 fs[LANES];
+        for (U32 lane = 0; lane < LANES; lane++) {
+            U32 index = static_cast<U32>(position >> 16);
+            U32 next = index < last ? index + 1 : last;
+            memcpy(&as[lane], frames + 2 * index, 4);
+            memcpy(&bs[lane], frames + 2 * next, 4);
+            fs[lane] = static_cast<I32>((position >> 1) & 0x7FFF);
+            position += step;
+        }
+
+        Frames a = load<Frames>(as);
+        Frames b = load<Frames>(bs);
+        Samples f = load<Samples>(fs);
+
+        // Fractions are 15 bits so that the products fit in an I32.
+        Samples la = leftOf(a);
+        Samples ra = rightOf(a);
+        Samples l = la + (((leftOf(b) - la) * f) >> 15);
+        Samples r = ra + (((rightOf(b) - ra) * f) >> 15);
+
+        store(left + i, load<Samples>(left + i) + ((l * volume) >> 8));
+        store(right + i, load<Samples>(right + i) + ((r * volume) >> 8));
+    }
+#endif
+
+    for (; i < n; i++) {
+        U32 index = static_cast<U32>(position >> 16);
+        U32 next = index < last ? index + 1 : last;
+        I32 f = static_cast<I32>((position >> 1) & 0x7FFF);
+        position += step;
+
+        I32 la = frames[2 * index];
+        I32 ra = frames[2 * index + 1];
+        I32 l = la + (((frames[2 * next] - la) * f) >> 15);
+        I32 r = ra + (((frames[2 * next + 1] - ra) * f) >> 15);
+
+        left[i] += (l * volume) >> 8;
+        right[i] += (r * volume) >> 8;
+    }
+}
+
+Mixer::Mixer() noexcept {
+    reset(44100);
+}
+
+void
+Mixer::reset(U32 rate_) noexcept {
+    rate = rate_;
+
+    // Hand out low voices first.
+    for (U32 i = 0; i < MIXER_VOICES; i++)
+        freeVoices[i] = static_cast<I32>(MIXER_VOICES - 1 - i);
+    numFreeVoices = MIXER_VOICES;
+
+    commands.clear();
+    done.clear();
+
+    numPlaying = 0;
+}
+
+static U32
+stepOf(float speed, U32 from, U32 to) noexcept {
+    float step = speed * static_cast<float>(from) / static_cast<float>(to) *
+                 65536.0f;
+    return static_cast<U32>(bound(step, 1.0f, 16.0f * 65536.0f));
+}
+
+I32
+Mixer::play(const I16* frames, U32 numFrames, U32 rate_) noexcept {
+    if (numFreeVoices == 0)
+        return -1;
+
+    I32 voice = freeVoices[--numFreeVoices];
+    voiceRates[voice] = rate_;
+
+    MixerCommand command;
+    command.type = MixerCommand::PLAY;
+    command.voice = voice;
+    command.frames = frames;
+    command.numFrames = numFrames;
+    command.step = stepOf(1.0f, rate_, rate);
+    command.volume = UNITY;
+
+    if (!commands.push(command)) {
+        freeVoices[numFreeVoices++] = voice;
+        return -1;
+    }
+
+    return voice;
+}
+
+void
+Mixer::stop(I32 voice) noexcept {
+    MixerCommand command = {};
+    command.type = MixerCommand::STOP;
+    command.voice = voice;
+    commands.push(command);
+}
+
+void
+Mixer::volume(I32 voice, float volume) noexcept {
+    MixerCommand command = {};
+    command.type = MixerCommand::VOLUME;
+    command.voice = voice;
+    command.volume = static_cast<I32>(bound(volume, 0.0f, 1.0f) * UNITY);
+    commands.push(command);
+}
+
+void
+Mixer::speed(I32 voice, float speed) noexcept {
+    MixerCommand command = {};
+    command.type = MixerCommand::SPEED;
+    command.voice = voice;
+    command.step = stepOf(speed, voiceRates[voice], rate);
+    commands.push(command);
+}
+
+bool
+Mixer::finished(I32& voice) noexcept {
+    if (!done.pop(voice))
+        return false;
+
+    freeVoices[numFreeVoices++] = voice;
+    return true;
+}
+
+void
+Mixer::apply(const MixerCommand& command) noexcept {
+    MixerVoice& voice = voices[command.voice];
+
+    switch (command.type) {
+    case MixerCommand::PLAY:
+        voice.frames = command.frames;
+        voice.numFrames = command.numFrames;
+        voice.position = 0;
+        voice.step = command.step;
+        voice.volume = command.volume;
+        playing[numPlaying++] = command.voice;
+        break;
+    case MixerCommand::STOP:
+        for (U32 i = 0; i < numPlaying; i++) {
+            if (playing[i] == command.voice) {
+                playing[i] = playing[--numPlaying];
+                bool ok = done.push(command.voice);
+                assert_(ok);
+                (void)ok;
+                break;
+            }
+        }
+        break;
+    case MixerCommand::VOLUME:
+        voice.volume = command.volume;
+        break;
+    case MixerCommand::SPEED:
+        voice.step = command.step;
+        break;
+    }
+}
+
+void
+Mixer::mix(I16* out, U32 numFrames) noexcept {
+    MixerCommand command;
+    while (commands.pop(command))
+        apply(command);
+
+    while (numFrames > 0) {
+        U32 n = min(numFrames, static_cast<U32>(MIXER_BLOCK));
+
+        split(out, left, right, n);
+
+        for (U32 i = 0; i < numPlaying;) {
+            I32 id = playing[i];
+            MixerVoice& voice = voices[id];
+
+            U64 end = static_cast<U64>(voice.numFrames) << 16;
+            U64 remaining = voice.position < end ? end - voice.position : 0;
+            U32 count = static_cast<U32>(
+                min(static_cast<U64>(n),
+                    (remaining + voice.step - 1) / voice.step));
+
+            if (voice.step == 0x10000 && (voice.position & 0xFFFF) == 0) {
+                mixSameRate(voice.frames + 2 * (voice.position >> 16),
+                            voice.volume, left, right, count);
+            }
+            else {
+                mixResampled(voice, left, right, count);
+            }
+
+            voice.position += static_cast<U64>(count) * voice.step;
+
+            if (voice.position >= end) {
+                playing[i] = playing[--numPlaying];
+                bool ok = done.push(id);
+                assert_(ok);
+                (void)ok;
+                continue;
+            }
+
+            i++;
+        }
+
+        join(left, right, out, n);
+
+        out += 2 * n;
+        numFrames -= n;
+    }
+}
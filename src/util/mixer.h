@@ -0,0 +1,162 @@
+#ifndef SRC_UTIL_MIXER_H_
+#define SRC_UTIL_MIXER_H_
+
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Most sounds that can play at once.
+#define MIXER_VOICES 256
+
+// Most commands that can wait for the next mix. A power of two.
+#define MIXER_COMMANDS 1024
+
+// Frames mixed at a time.
+#define MIXER_BLOCK 256
+
+// A ring buffer that one thread pushes to and another pops from without
+// either taking a lock. N is a power of two.
+template<typename T, U32 N>
+class MixerRing {
+ public:
+    MixerRing() noexcept : head(0), tail(0) { }
+
+    void
+    clear() noexcept {
+        head = 0;
+        tail = 0;
+    }
+
+    // Returns false if the ring is full.
+    bool
+    push(T item) noexcept {
+        U32 t = tail;
+        if (t - atomicLoad(&head) == N)
+            return false;
+        items[t & (N - 1)] = item;
+        atomicStore(&tail, t + 1);
+        return true;
+    }
+
+    // Returns false if the ring is empty.
+    bool
+    pop(T& item) noexcept {
+        U32 h = head;
+        if (h == atomicLoad(&tail))
+            return false;
+        item = items[h & (N - 1)];
+        atomicStore(&head, h + 1);
+        return true;
+    }
+
+ private:
+    T items[N];
+    U32 head;
+    U32 tail;
+};
+
+struct MixerCommand {
+    enum Type { PLAY, STOP, VOLUME, SPEED } type;
+    I32 voice;
+
+    const I16* frames;
+    U32 numFrames;
+    U32 step;
+    I32 volume;
+};
+
+struct MixerVoice {
+    const I16* frames;
+    U32 numFrames;
+
+    // In frames, as 48.16 fixed point.
+    U64 position;
+    // Frames advanced per frame mixed, as 16.16 fixed point.
+    U32 step;
+    // Between 0 and 256.
+    I32 volume;
+};
+
+// Mixes many sounds into one stereo stream of 16-bit samples.
+//
+// The game's thread starts and changes voices, and an audio thread, such as
+// an audio device's callback, mixes them. Neither waits on the other: the
+// game's thread sends commands through one ring buffer and the audio thread
+// sends back the voices that have finished through another, so the audio
+// thread never takes a lock.
+//
+// Sounds are interleaved stereo frames, which must stay alive until their
+// voices finish. A sound at a different rate than the mixer's, or a voice at
+// a different speed, is resampled with linear interpolation.
+class Mixer {
+ public:
+    Mixer() noexcept;
+
+    // Forget all voices and start over at rate frames per second. Neither
+    // thread may be using the mixer.
+    void
+    reset(U32 rate) noexcept;
+
+    //
+    // Game thread
+    //
+
+    // Start playing a sound. Returns its voice, or -1 if too many sounds are
+    // playing.
+    I32
+    play(const I16* frames, U32 numFrames, U32 rate) noexcept;
+
+    // These are dropped if MIXER_COMMANDS are already waiting for the audio
+    // thread.
+    void
+    stop(I32 voice) noexcept;
+
+    // Between 0.0 (silence) and 1.0 (full).
+    void
+    volume(I32 voice, float volume) noexcept;
+
+    // 1.0 is normal speed.
+    void
+    speed(I32 voice, float speed) noexcept;
+
+    // Take a voice that has finished or been stopped since the last call.
+    // Returns false if there is none. A voice can be returned by play() again
+    // only after it has been taken here.
+    bool
+    finished(I32& voice) noexcept;
+
+    //
+    // Audio thread
+    //
+
+    // Mix numFrames frames of the playing voices into out, adding to the
+    // samples already there.
+    void
+    mix(I16* out, U32 numFrames) noexcept;
+
+ private:
+    void
+    apply(const MixerCommand& command) noexcept;
+
+ public:
+    U32 rate;
+
+ private:
+    // Owned by the game's thread.
+    I32 freeVoices[MIXER_VOICES];
+    U32 numFreeVoices;
+    U32 voiceRates[MIXER_VOICES];
+
+    MixerRing<MixerCommand, MIXER_COMMANDS> commands;
+    MixerRing<I32, MIXER_VOICES> done;
+
+    // Owned by the audio thread.
+    MixerVoice voices[MIXER_VOICES];
+    I32 playing[MIXER_VOICES];
+    U32 numPlaying;
+
+    I32 left[MIXER_BLOCK];
+    I32 right[MIXER_BLOCK];
+};
+
+#endif  // SRC_UTIL_MIXER_H_
@@ -7,6 +7,14 @@
 void
 initRandom() noexcept;
 
+//! Start the sequence over from a state given by randomState().
+void
+seedRandom(U32 seed) noexcept;
+
+//! The generator's state, from which the rest of the sequence follows.
+U32
+randomState() noexcept;
+
 //! Produce a random integer.
 /*!
     @param min Minimum value.
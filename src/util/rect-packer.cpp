@@ -0,0 +1,171 @@
+#include "util/rect-packer.h"
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/math2.h"
+
+static bool
+overlaps(PackedRect a, PackedRect b) noexcept {
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static bool
+contains(PackedRect outer, PackedRect inner) noexcept {
+    return outer.x <= inner.x && outer.y <= inner.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+RectPacker::RectPacker() noexcept : width(0), height(0) { }
+
+void
+RectPacker::reset(U32 w, U32 h) noexcept {
+    width = w;
+    height = h;
+
+    PackedRect all = {0, 0, width, height};
+    spaces.clear();
+    spaces.push(all);
+}
+
+bool
+RectPacker::insert(U32 w, U32 h, PackedRect& placed) noexcept {
+    Size best = SIZE_MAX;
+    U32 bestShort = UINT32_MAX;
+    U32 bestLong = UINT32_MAX;
+
+    for (Size i = 0; i < spaces.size; i++) {
+        PackedRect space = spaces[i];
+        if (space.width < w || space.height < h)
+            continue;
+
+        U32 leftoverX = space.width - w;
+        U32 leftoverY = space.height - h;
+        U32 shortSide = min(leftoverX, leftoverY);
+        U32 longSide = max(leftoverX, leftoverY);
+
+        if (shortSide < bestShort ||
+            (shortSide == bestShort && longSide < bestLong)) {
+            best = i;
+            bestShort = shortSide;
+            bestLong = longSide;
+        }
+    }
+
+    if (best == SIZE_MAX)
+        return false;
+
+    placed.x = spaces[best].x;
+    placed.y = spaces[best].y;
+    placed.width = w;
+    placed.height = h;
+
+    // Every free rectangle the new one overlaps gives way to the parts of it
+    // that remain free.
+    for (Size i = 0; i < spaces.size;) {
+        if (overlaps(spaces[i], placed)) {
+            split(spaces[i], placed);
+            spaces.eraseUnordered(i);
+        }
+        else {
+            i++;
+        }
+    }
+
+    for (Size i = 0; i < pieces.size; i++)
+        spaces.push(pieces[i]);
+    pieces.clear();
+
+    prune();
+
+    return true;
+}
+
+void
+RectPacker::release(PackedRect placed) noexcept {
+    spaces.push(placed);
+    merge();
+    prune();
+}
+
+void
+RectPacker::split(PackedRect space, PackedRect placed) noexcept {
+    U32 spaceRight = space.x + space.width;
+    U32 spaceBottom = space.y + space.height;
+    U32 placedRight = placed.x + placed.width;
+    U32 placedBottom = placed.y + placed.height;
+
+    if (space.x < placed.x) {
+        PackedRect left = {space.x, space.y, placed.x - space.x, space.height};
+        pieces.push(left);
+    }
+    if (placedRight < spaceRight) {
+        PackedRect right = {placedRight, space.y, spaceRight - placedRight,
+                            space.height};
+        pieces.push(right);
+    }
+    if (space.y < placed.y) {
+        PackedRect top = {space.x, space.y, space.width, placed.y - space.y};
+        pieces.push(top);
+    }
+    if (placedBottom < spaceBottom) {
+        PackedRect bottom = {space.x, placedBottom, space.width,
+                             spaceBottom - placedBottom};
+        pieces.push(bottom);
+    }
+}
+
+void
+RectPacker::merge() noexcept {
+    // Join pairs of free rectangles that together form a larger one, until
+    // there are none left.
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (Size i = 0; i < spaces.size && !merged; i++) {
+            for (Size j = i + 1; j < spaces.size && !merged; j++) {
+                PackedRect& a = spaces[i];
+                PackedRect b = spaces[j];
+
+                if (a.x == b.x && a.width == b.width &&
+                    (a.y + a.height == b.y || b.y + b.height == a.y)) {
+                    a.y = min(a.y, b.y);
+                    a.height += b.height;
+                    merged = true;
+                }
+                else if (a.y == b.y && a.height == b.height &&
+                         (a.x + a.width == b.x || b.x + b.width == a.x)) {
+                    a.x = min(a.x, b.x);
+                    a.width += b.width;
+                    merged = true;
+                }
+
+                if (merged)
+                    spaces.eraseUnordered(j);
+            }
+        }
+    }
+}
+
+void
+RectPacker::prune() noexcept {
+    // A free rectangle within another adds nothing.
+    for (Size i = 0; i < spaces.size;) {
+        bool redundant = false;
+        for (Size j = 0; j < spaces.size; j++) {
+            if (i == j || !contains(spaces[j], spaces[i]))
+                continue;
+            // Of two identical rectangles, keep the later one.
+            if (contains(spaces[i], spaces[j]) && i > j)
+                continue;
+            redundant = true;
+            break;
+        }
+
+        if (redundant)
+            spaces.eraseUnordered(i);
+        else
+            i++;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef SRC_UTIL_RECT_PACKER_H_
+#define SRC_UTIL_RECT_PACKER_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+struct PackedRect {
+    U32 x, y, width, height;
+};
+
+// Places rectangles within a larger one without overlap, such as images
+// within a texture atlas.
+//
+// Uses the MaxRects algorithm: the free space is kept as the list of largest
+// free rectangles, which may overlap each other, and each new rectangle goes
+// in the free rectangle it fits most snugly along its shorter side.
+//
+// Released rectangles become free again and are merged with free neighbors
+// they share a whole edge with. Space freed this way can stay split into
+// smaller pieces than a fresh packer would have, so callers should reset()
+// once everything is released.
+class RectPacker {
+ public:
+    RectPacker() noexcept;
+
+    // Forget all placed rectangles and start over with an empty area.
+    void
+    reset(U32 width, U32 height) noexcept;
+
+    // Returns false if there is no room.
+    bool
+    insert(U32 width, U32 height, PackedRect& placed) noexcept;
+
+    // Free a rectangle returned by insert().
+    void
+    release(PackedRect placed) noexcept;
+
+ private:
+    void
+    split(PackedRect space, PackedRect placed) noexcept;
+    void
+    merge() noexcept;
+    void
+    prune() noexcept;
+
+ public:
+    U32 width;
+    U32 height;
+
+    Vector<PackedRect> spaces;
+
+ private:
+    // Scratch space for insert().
+    Vector<PackedRect> pieces;
+};
+
+#endif  // SRC_UTIL_RECT_PACKER_H_
@@ -108,7 +108,7 @@ class Vector {
         // FIXME: Does not call move constructors.
         assert_(i <= size);
         grow();
-        memmove(data + i, data + i + 1, sizeof(X) * (size - i));
+        memmove(data + i + 1, data + i, sizeof(X) * (size - i));
         new (data + i) X(x);
         size++;
     }
@@ -117,7 +117,7 @@ class Vector {
         // FIXME: Does not call move constructors.
         assert_(i <= size);
         grow();
-        memmove(data + i, data + i + 1, sizeof(X) * (size - i));
+        memmove(data + i + 1, data + i, sizeof(X) * (size - i));
         new (data + i) X(static_cast<X&&>(x));
         size++;
     }
@@ -146,11 +146,9 @@ class Vector {
     void
     eraseUnordered(Size i) noexcept {
         assert_(i < size);
-        data[i].~X();
-        if (i < size - 1) {
+        if (i < size - 1)
             data[i] = static_cast<X&&>(data[size - 1]);
-            pop();
-        }
+        pop();
     }
 
     // Calls move constructors (which empties the old objects), but not call
@@ -0,0 +1,138 @@
+#include "util/wav.h"
+
+#include "os/c.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+struct Format {
+    U32 channels;
+    U32 rate;
+    const U8* samples;
+    U32 numFrames;
+};
+
+static U32
+read16(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8;
+}
+
+static U32
+read32(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8 |
+           static_cast<U32>(p[2]) << 16 | static_cast<U32>(p[3]) << 24;
+}
+
+static void
+write16(U8* p, U32 x) noexcept {
+    p[0] = static_cast<U8>(x);
+    p[1] = static_cast<U8>(x >> 8);
+}
+
+static void
+write32(U8* p, U32 x) noexcept {
+    p[0] = static_cast<U8>(x);
+    p[1] = static_cast<U8>(x >> 8);
+    p[2] = static_cast<U8>(x >> 16);
+    p[3] = static_cast<U8>(x >> 24);
+}
+
+// Walk the file's chunks for its format and its samples.
+static bool
+parse(const U8* data, Size size, Format& format) noexcept {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 ||
+        memcmp(data + 8, "WAVE", 4) != 0)
+        return false;
+
+    bool haveFormat = false;
+
+    Size pos = 12;
+    while (size - pos >= 8) {
+        const U8* chunk = data + pos;
+        Size length = read32(chunk + 4);
+        pos += 8;
+        if (length > size - pos)
+            return false;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (length < 16)
+                return false;
+            U32 tag = read16(chunk + 8);
+            format.channels = read16(chunk + 10);
+            format.rate = read32(chunk + 12);
+            U32 bits = read16(chunk + 22);
+            if (tag != 1 || bits != 16 || format.rate == 0 ||
+                (format.channels != 1 && format.channels != 2))
+                return false;
+            haveFormat = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                return false;
+            format.samples = chunk + 8;
+            format.numFrames =
+                static_cast<U32>(length / (2 * format.channels));
+            return true;
+        }
+
+        // Chunks are padded to an even length.
+        pos += length + (length & 1);
+        if (pos > size)
+            return false;
+    }
+
+    return false;
+}
+
+bool
+decodeWavSize(const U8* data, Size size, U32* numFrames, U32* rate) noexcept {
+    Format format;
+    if (!parse(data, size, format))
+        return false;
+
+    *numFrames = format.numFrames;
+    *rate = format.rate;
+    return true;
+}
+
+bool
+decodeWav(const U8* data, Size size, I16* frames) noexcept {
+    Format format;
+    if (!parse(data, size, format))
+        return false;
+
+    const U8* in = format.samples;
+    if (format.channels == 2) {
+        for (U32 i = 0; i < format.numFrames * 2; i++, in += 2)
+            frames[i] = static_cast<I16>(read16(in));
+    }
+    else {
+        for (U32 i = 0; i < format.numFrames; i++, in += 2) {
+            I16 sample = static_cast<I16>(read16(in));
+            frames[2 * i] = sample;
+            frames[2 * i + 1] = sample;
+        }
+    }
+
+    return true;
+}
+
+void
+encodeWavHeader(U8* header, U32 numFrames, U32 rate) noexcept {
+    U32 bytes = numFrames * 4;
+
+    memcpy(header, "RIFF", 4);
+    write32(header + 4, 36 + bytes);
+    memcpy(header + 8, "WAVE", 4);
+
+    memcpy(header + 12, "fmt ", 4);
+    write32(header + 16, 16);
+    write16(header + 20, 1);         // PCM
+    write16(header + 22, 2);         // Channels
+    write32(header + 24, rate);      // Frames per second
+    write32(header + 28, rate * 4);  // Bytes per second
+    write16(header + 32, 4);         // Bytes per frame
+    write16(header + 34, 16);        // Bits per sample
+
+    memcpy(header + 36, "data", 4);
+    write32(header + 40, bytes);
+}
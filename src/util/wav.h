@@ -0,0 +1,27 @@
+#ifndef SRC_UTIL_WAV_H_
+#define SRC_UTIL_WAV_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Reading and writing WAV files of 16-bit samples, as the mixer takes and
+// gives them.
+
+#define WAV_HEADER_SIZE 44
+
+// Read a WAV file's length in frames and its frames per second from its
+// header. Returns false if data is not 16-bit mono or stereo PCM.
+bool
+decodeWavSize(const U8* data, Size size, U32* numFrames, U32* rate) noexcept;
+
+// Decode a WAV file into interleaved stereo frames. There must be room for
+// the number of frames decodeWavSize() gives. Mono files are played on both
+// sides.
+bool
+decodeWav(const U8* data, Size size, I16* frames) noexcept;
+
+// Write the header of a stereo WAV file that numFrames frames will follow.
+void
+encodeWavHeader(U8* header, U32 numFrames, U32 rate) noexcept;
+
+#endif  // SRC_UTIL_WAV_H_
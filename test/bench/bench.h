@@ -0,0 +1,17 @@
+#ifndef TEST_BENCH_BENCH_H_
+#define TEST_BENCH_BENCH_H_
+
+#include "os/chrono.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+// Prints the time taken per operation.
+void
+benchReport(StringView name, Nanoseconds elapsed, Size ops) noexcept;
+
+// Keeps a computed value alive so that the compiler cannot discard the work
+// that produced it.
+extern volatile U32 benchSink;
+
+#endif  // TEST_BENCH_BENCH_H_
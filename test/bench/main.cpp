@@ -0,0 +1,28 @@
+#include "bench.h"
+
+#include "util/compiler.h"
+#include "util/io.h"
+
+volatile U32 benchSink;
+
+void
+benchReport(StringView name, Nanoseconds elapsed, Size ops) noexcept {
+    sout << name << ": " << static_cast<float>(elapsed) / ops << " ns/op ("
+         << ops << " ops in " << ns_to_s_d(elapsed) << " s)\n";
+}
+
+void
+benchPathfinder() noexcept;
+void
+benchTileGrid() noexcept;
+
+I32
+main() noexcept {
+    Flusher f1(sout);
+    Flusher f2(serr);
+
+    benchPathfinder();
+    benchTileGrid();
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "bench.h"
+
+#include "tiles/entity-grid.h"
+#include "tiles/pathfinder.h"
+#include "tiles/tile-grid.h"
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+#define MAP_SIZE 512
+#define AGENTS   1000
+#define QUERIES  1000
+#define TICKS    200
+#define CHANGES  100
+
+static U32 seed = 1;
+
+static I32
+random(I32 n) noexcept {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<I32>((seed >> 8) % static_cast<U32>(n));
+}
+
+static ivec3
+randomOpenTile(TileGrid& grid) noexcept {
+    while (true) {
+        ivec3 tile = {random(MAP_SIZE), random(MAP_SIZE), 0};
+        if (!grid.flags.contains(tile))
+            return tile;
+    }
+}
+
+// A 512x512 map with a fifth of its tiles walls, and a crowd of 1000 NPCs.
+void
+benchPathfinder() noexcept {
+    TileGrid grid;
+    grid.dim.x = MAP_SIZE;
+    grid.dim.y = MAP_SIZE;
+    grid.tileDim.x = 16;
+    grid.tileDim.y = 16;
+    grid.allocateLayer(TileGrid::TILE_LAYER);
+    grid.setLayerDepth(0, 0.0f);
+
+    for (I32 i = 0; i < MAP_SIZE * MAP_SIZE / 5; i++) {
+        ivec3 tile = {random(MAP_SIZE), random(MAP_SIZE), 0};
+        grid.flags[tile] = TILE_NOWALK;
+    }
+
+    EntityGrid entities(grid);
+    PathFinder paths(grid, entities);
+
+    ivec3 goal = randomOpenTile(grid);
+    ivec3 agents[AGENTS];
+    for (I32 i = 0; i < AGENTS; i++)
+        agents[i] = randomOpenTile(grid);
+
+    U32 sum = 0;
+    Vector<ivec2> steps;
+
+    // Every NPC plans its own route to the same tile.
+    Nanoseconds start = chronoNow();
+    for (I32 i = 0; i < QUERIES; i++) {
+        steps.clear();
+        if (paths.findPath(agents[i % AGENTS], goal, TILE_NOWALK, steps))
+            sum += static_cast<U32>(steps.size);
+    }
+    benchReport("PathFinder::findPath", chronoNow() - start, QUERIES);
+
+    // Every NPC follows one shared flow field to the same tile instead.
+    start = chronoNow();
+    for (I32 tick = 0; tick < TICKS; tick++) {
+        for (I32 i = 0; i < AGENTS; i++) {
+            ivec2 d = paths.flowStep(agents[i], goal, TILE_NOWALK);
+            agents[i].x += d.x;
+            agents[i].y += d.y;
+        }
+    }
+    benchReport("PathFinder::flowStep", chronoNow() - start, TICKS * AGENTS);
+
+    // A wall is toggled somewhere, then the crowd takes another step.
+    start = chronoNow();
+    for (I32 i = 0; i < CHANGES; i++) {
+        ivec3 tile = randomOpenTile(grid);
+        grid.flags[tile] = TILE_NOWALK;
+        paths.invalidate(tile);
+        grid.flags.erase(tile);
+        paths.invalidate(tile);
+        sum += paths.flowStep(agents[i], goal, TILE_NOWALK).x;
+    }
+    benchReport("PathFinder::invalidate + rebuild", chronoNow() - start,
+                CHANGES);
+
+    benchSink = sum;
+}
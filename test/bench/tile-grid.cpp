@@ -0,0 +1,70 @@
+#include "bench.h"
+
+#include "tiles/tile-grid.h"
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+#define LAYERS   6
+#define ENTITIES 1024
+#define ROUNDS   10000
+
+// Positions of a crowd of entities spread over every layer, converted to tile
+// coordinates the way getTileCoords_i() and inBounds() do each tick.
+void
+benchTileGrid() noexcept {
+    TileGrid grid;
+    grid.dim.x = 256;
+    grid.dim.y = 256;
+    grid.tileDim.x = 16;
+    grid.tileDim.y = 16;
+    for (I32 z = 0; z < LAYERS; z++) {
+        grid.allocateLayer(TileGrid::TILE_LAYER);
+        grid.setLayerDepth(z, -1.0f + 0.5f * static_cast<float>(z));
+    }
+
+    fvec3 positions[ENTITIES];
+    I32 layers[ENTITIES];
+    U32 seed = 1;
+    for (I32 i = 0; i < ENTITIES; i++) {
+        seed = seed * 1103515245 + 12345;
+        I32 z = static_cast<I32>((seed >> 16) % LAYERS);
+        positions[i].x = static_cast<float>((seed >> 4) % 4096);
+        positions[i].y = static_cast<float>((seed >> 8) % 4096);
+        positions[i].z = grid.indexDepth(z);
+        layers[i] = z;
+    }
+
+    U32 sum = 0;
+    Nanoseconds start = chronoNow();
+    for (I32 round = 0; round < ROUNDS; round++) {
+        for (I32 i = 0; i < ENTITIES; i++) {
+            ivec3 phys = grid.virt2phys(positions[i]);
+            sum += phys.x + phys.y + phys.z;
+        }
+    }
+    benchReport("TileGrid::virt2phys(fvec3)", chronoNow() - start,
+                ROUNDS * ENTITIES);
+
+    // With the layer index carried alongside the position, as Entity does.
+    start = chronoNow();
+    for (I32 round = 0; round < ROUNDS; round++) {
+        for (I32 i = 0; i < ENTITIES; i++) {
+            fvec3 r = positions[i];
+            ivec3 phys = {static_cast<I32>(r.x) / grid.tileDim.x,
+                          static_cast<I32>(r.y) / grid.tileDim.y, layers[i]};
+            sum += phys.x + phys.y + phys.z;
+        }
+    }
+    benchReport("Entity layer index", chronoNow() - start, ROUNDS * ENTITIES);
+
+    start = chronoNow();
+    for (I32 round = 0; round < ROUNDS; round++) {
+        for (I32 i = 0; i < ENTITIES; i++)
+            sum += grid.depthIndex(positions[i].z);
+    }
+    benchReport("TileGrid::depthIndex", chronoNow() - start,
+                ROUNDS * ENTITIES);
+
+    benchSink = sum;
+}
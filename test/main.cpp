@@ -1,6 +1,14 @@
 #include "util/compiler.h"
 #include "util/io.h"
 
+void
+testUtilAtlas() noexcept;
+void
+testUtilImageDecode() noexcept;
+void
+testUtilMixer() noexcept;
+void
+testUtilRectPacker() noexcept;
 void
 testUtilString2() noexcept;
 void
@@ -11,6 +19,10 @@ main() noexcept {
     Flusher f1(sout);
     Flusher f2(serr);
 
+    testUtilAtlas();
+    testUtilImageDecode();
+    testUtilMixer();
+    testUtilRectPacker();
     testUtilString2();
     testUtilStringView();
 
@@ -0,0 +1,81 @@
+#include "util/assert.h"
+#include "util/atlas.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+static Size texturesMade = 0;
+static Size texturesDestroyed = 0;
+static Size imagesEvicted = 0;
+
+static void*
+makeTexture(U32, U32) noexcept {
+    texturesMade += 1;
+    return reinterpret_cast<void*>(texturesMade);
+}
+
+static void
+destroyTexture(void*) noexcept {
+    texturesDestroyed += 1;
+}
+
+static void
+evicted(StringView, const AtlasImage&, AtlasPage&) noexcept {
+    imagesEvicted += 1;
+}
+
+void
+testUtilAtlas() noexcept {
+    AtlasHooks hooks = {makeTexture, destroyTexture, evicted};
+    Atlas atlas(hooks);
+
+    Size page = ATLAS_SIZE * ATLAS_SIZE * 4;
+
+    //
+    // Shares pages
+    //
+    AtlasImage& a = atlas.image("a");
+    AtlasImage& b = atlas.image("b");
+    assert_(atlas.place(a, 16, 16, page, 0));
+    assert_(atlas.place(b, 16, 16, page, 0));
+    assert_(a.texture == b.texture);
+    assert_(texturesMade == 1);
+    assert_(atlas.find(b.texture, b.x, b.y) == &b);
+    a.numUsers = 1;
+    b.numUsers = 1;
+
+    //
+    // Goes over budget only for images in use
+    //
+    AtlasImage& c = atlas.image("c");
+    assert_(!atlas.place(c, ATLAS_SIZE, ATLAS_SIZE, page, 1));
+    assert_(texturesMade == 2);
+    assert_(imagesEvicted == 0);
+
+    //
+    // Evicts the least recently used, but not what was released now
+    //
+    c.lastUse = 1;
+    b.numUsers = 0;
+    b.lastUse = 2;
+    AtlasImage& d = atlas.image("d");
+    assert_(atlas.place(d, ATLAS_SIZE, ATLAS_SIZE, page * 2, 2));
+    assert_(c.texture == 0);
+    assert_(b.texture != 0);
+    assert_(imagesEvicted == 1);
+    assert_(texturesDestroyed == 1);
+    assert_(atlas.find(d.texture, 0, 0) == &d);
+    assert_(atlas.findPage(d.texture)->packer.width == ATLAS_SIZE);
+
+    //
+    // Prunes unused images
+    //
+    d.numUsers = 1;
+    atlas.prune(3);
+    assert_(b.texture == 0);
+    assert_(a.texture != 0);
+    assert_(atlas.find(a.texture, b.x, b.y) == 0);
+    assert_(atlas.find(a.texture, a.x, a.y) == &a);
+    assert_(imagesEvicted == 2);
+    assert_(texturesDestroyed == 1);
+}
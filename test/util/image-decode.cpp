@@ -0,0 +1,81 @@
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/image-decode.h"
+#include "util/int.h"
+
+// 3x2 RGB, the first row filtered with Sub and the second with Up.
+static const U8 png[] = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x02,
+    0x08, 0x02, 0x00, 0x00, 0x00, 0x12, 0x16, 0xF1, 0x4D, 0x00, 0x00, 0x00,
+    0x19, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0xFC, 0xCF, 0xC0, 0xC0,
+    0x08, 0xC6, 0x4C, 0x0C, 0xFF, 0xFF, 0x33, 0x30, 0x32, 0x34, 0x38, 0x28,
+    0x02, 0x00, 0x3E, 0x42, 0x05, 0xE3, 0x0D, 0x7C, 0x3B, 0x95, 0x00, 0x00,
+    0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82,
+};
+
+// 2x2 RGBA, one pixel of each of the RGB, DIFF, INDEX, and RGBA ops.
+static const U8 qoi[] = {
+    'q',  'o',  'i',  'f',  0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x04, 0x00, 0xFE, 10,   20,   30,   0x79, 0x09, 0xFF, 1,    2,    3,
+    4,    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+};
+
+// 1x1 32-bit BITFIELDS with a 56-byte header, cut off before its alpha mask.
+// The pixel overlaps the blue mask.
+static const U8 bmpNoAlphaMask[] = {
+    'B',  'M',  68,   0,    0,    0,    0,    0,    0,    0,    64,   0,
+    0,    0,    56,   0,    0,    0,    1,    0,    0,    0,    1,    0,
+    0,    0,    1,    0,    32,   0,    3,    0,    0,    0,    4,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0x00, 0x00, 0xFF, 0x00, 0x00, 0xFF,
+    0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+void
+testUtilImageDecode() noexcept {
+    U32 width;
+    U32 height;
+    U32 pixels[8];
+
+    //
+    // PNG
+    //
+    assert_(decodeImageSize(png, sizeof(png), &width, &height));
+    assert_(width == 3 && height == 2);
+
+    // Rows a pixel wider than the image, as in an atlas.
+    assert_(decodeImage(png, sizeof(png), pixels, 4, PIXELS_ARGB));
+    assert_(pixels[0] == 0xFFFF0000);
+    assert_(pixels[1] == 0xFF00FF00);
+    assert_(pixels[2] == 0xFF0000FF);
+    assert_(pixels[4] == 0xFFFFFFFF);
+    assert_(pixels[5] == 0xFF000000);
+    assert_(pixels[6] == 0xFF804020);
+
+    assert_(decodeImage(png, sizeof(png), pixels, 3, PIXELS_ABGR));
+    assert_(pixels[0] == 0xFF0000FF);
+    assert_(pixels[5] == 0xFF204080);
+
+    assert_(!decodeImage(png, sizeof(png) - 20, pixels, 3, PIXELS_ARGB));
+
+    //
+    // QOI
+    //
+    assert_(decodeImageSize(qoi, sizeof(qoi), &width, &height));
+    assert_(width == 2 && height == 2);
+
+    assert_(decodeImage(qoi, sizeof(qoi), pixels, 2, PIXELS_ARGB));
+    assert_(pixels[0] == 0xFF0A141E);
+    assert_(pixels[1] == 0xFF0B141D);
+    assert_(pixels[2] == 0xFF0A141E);
+    assert_(pixels[3] == 0x04010203);
+
+    assert_(!decodeImage(qoi, 20, pixels, 2, PIXELS_ARGB));
+
+    //
+    // BMP
+    //
+    assert_(!decodeImage(bmpNoAlphaMask, sizeof(bmpNoAlphaMask), pixels, 1,
+                         PIXELS_ARGB));
+}
@@ -0,0 +1,101 @@
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/mixer.h"
+
+static Mixer mixer;
+
+static I16 ramp[600];
+static I16 out[600];
+
+static void
+clear() noexcept {
+    for (I32 i = 0; i < 600; i++)
+        out[i] = 0;
+}
+
+void
+testUtilMixer() noexcept {
+    I32 voice;
+
+    // Left rises and right falls, frame by frame.
+    for (I32 i = 0; i < 300; i++) {
+        ramp[2 * i] = static_cast<I16>(i * 100);
+        ramp[2 * i + 1] = static_cast<I16>(-i * 100);
+    }
+
+    mixer.reset(44100);
+
+    //
+    // Same rate, across more than one block.
+    //
+    clear();
+    assert_(mixer.play(ramp, 300, 44100) == 0);
+    assert_(!mixer.finished(voice));
+    mixer.mix(out, 300);
+    assert_(out[2 * 3] == 300 && out[2 * 3 + 1] == -300);
+    assert_(out[2 * 299] == 29900 && out[2 * 299 + 1] == -29900);
+    assert_(mixer.finished(voice) && voice == 0);
+    assert_(!mixer.finished(voice));
+
+    //
+    // Mixing adds and clamps.
+    //
+    for (I32 i = 0; i < 600; i++)
+        out[i] = 30000;
+    voice = mixer.play(ramp, 300, 44100);
+    mixer.volume(voice, 0.5f);
+    mixer.mix(out, 300);
+    assert_(out[2 * 10] == 30500 && out[2 * 10 + 1] == 29500);
+    assert_(out[2 * 299] == 32767);
+    assert_(out[2 * 299 + 1] == 30000 - 14950);
+    assert_(mixer.finished(voice));
+
+    //
+    // Resampling.
+    //
+    clear();
+    voice = mixer.play(ramp, 300, 44100);
+    mixer.speed(voice, 2.0f);
+    mixer.mix(out, 300);
+    assert_(out[2 * 7] == 1400 && out[2 * 7 + 1] == -1400);
+    assert_(out[2 * 149] == 29800);
+    assert_(out[2 * 150] == 0);
+    assert_(mixer.finished(voice));
+
+    // Half speed interpolates between frames, and the last is held.
+    clear();
+    voice = mixer.play(ramp, 300, 22050);
+    mixer.mix(out, 300);
+    assert_(out[2 * 9] == 450 && out[2 * 9 + 1] == -450);
+    assert_(!mixer.finished(voice));
+    clear();
+    mixer.mix(out, 300);
+    assert_(out[2 * 299] == 29900);
+    assert_(mixer.finished(voice));
+
+    //
+    // Stopping.
+    //
+    clear();
+    voice = mixer.play(ramp, 300, 44100);
+    mixer.mix(out, 4);
+    mixer.stop(voice);
+    assert_(!mixer.finished(voice));
+    mixer.mix(out + 8, 4);
+    assert_(out[2 * 3] == 300 && out[2 * 4] == 0);
+    assert_(mixer.finished(voice));
+
+    //
+    // Many voices at once.
+    //
+    clear();
+    for (I32 i = 0; i < MIXER_VOICES; i++)
+        assert_(mixer.play(ramp, 300, 44100) != -1);
+    assert_(mixer.play(ramp, 300, 44100) == -1);
+    mixer.mix(out, 300);
+    assert_(out[2 * 2] == 32767 && out[2 * 2 + 1] == -32768);
+    for (I32 i = 0; i < MIXER_VOICES; i++)
+        assert_(mixer.finished(voice));
+    assert_(mixer.play(ramp, 300, 44100) != -1);
+}
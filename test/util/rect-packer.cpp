@@ -0,0 +1,58 @@
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/rect-packer.h"
+
+static bool
+disjoint(PackedRect a, PackedRect b) noexcept {
+    return a.x + a.width <= b.x || b.x + b.width <= a.x ||
+           a.y + a.height <= b.y || b.y + b.height <= a.y;
+}
+
+void
+testUtilRectPacker() noexcept {
+    RectPacker packer;
+    PackedRect placed[20];
+
+    //
+    // Fills the whole area exactly
+    //
+    packer.reset(64, 64);
+    for (U32 i = 0; i < 16; i++)
+        assert_(packer.insert(16, 16, placed[i]));
+    assert_(!packer.insert(1, 1, placed[16]));
+    for (U32 i = 0; i < 16; i++)
+        for (U32 j = 0; j < i; j++)
+            assert_(disjoint(placed[i], placed[j]));
+
+    //
+    // Uses space under wide images
+    //
+    packer.reset(64, 64);
+    assert_(packer.insert(64, 16, placed[0]));
+    assert_(packer.insert(32, 48, placed[1]));
+    assert_(packer.insert(32, 48, placed[2]));
+    assert_(disjoint(placed[1], placed[2]));
+    assert_(placed[1].y == 16 && placed[2].y == 16);
+
+    //
+    // Reuses released space
+    //
+    packer.reset(64, 64);
+    for (U32 i = 0; i < 4; i++)
+        assert_(packer.insert(32, 32, placed[i]));
+    packer.release(placed[1]);
+    packer.release(placed[3]);
+    assert_(packer.insert(32, 32, placed[4]));
+    assert_(packer.insert(32, 32, placed[5]));
+    assert_(!packer.insert(1, 1, placed[6]));
+    for (U32 i = 0; i < 4; i++)
+        packer.release(i == 1 ? placed[4] : i == 3 ? placed[5] : placed[i]);
+    assert_(packer.insert(64, 64, placed[0]));
+
+    //
+    // Too big
+    //
+    packer.reset(64, 64);
+    assert_(!packer.insert(65, 1, placed[0]));
+    assert_(packer.insert(64, 64, placed[0]));
+}